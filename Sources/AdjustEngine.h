@@ -0,0 +1,85 @@
+// =======================================================================================
+// AdjustEngine.h : Time based continuous camera adjustment for held keys and buttons.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <Orbitersdk.h>
+
+// Turns a held key or button into a continuous adjustment which doesn't depend on the frame rate.
+// The adjustment starts after a short delay (the first step is done by the key press itself),
+// then accelerates linearly the longer the key is held, up to a maximum factor.
+class AdjustEngine
+{
+public:
+	static constexpr double holdDelay = 0.3;    // The time before the continuous adjustment starts, in seconds
+	static constexpr double acceleration = 1.5; // The rate factor increase per second
+	static constexpr double maxFactor = 4;      // The maximum rate factor
+
+	// Holds the passed key at the passed system time. Call it once per frame while the key is held.
+	// Returns the time to apply the base adjustment rate for since the last call, scaled by the acceleration.
+	// Returns 0 for the first call of a key, and for other calls in the same frame.
+	double Hold(DWORD key, double sysTime)
+	{
+		if (key != heldKey)
+		{
+			heldKey = key;
+			holdTime = 0;
+			lastTime = sysTime;
+
+			return 0;
+		}
+
+		double dt = sysTime - lastTime;
+
+		if (dt <= 0)
+			return 0;
+
+		lastTime = sysTime;
+
+		double adjustTime = integral(holdTime + dt) - integral(holdTime);
+		holdTime += dt;
+
+		return adjustTime;
+	}
+
+	void Release() { heldKey = 0; }
+
+	bool IsHeld() const { return heldKey != 0; }
+
+private:
+	DWORD heldKey = 0;
+	double holdTime = 0;
+	double lastTime = 0;
+
+	// The integral of the rate factor from the key press to the passed hold time
+	static double integral(double time)
+	{
+		if (time <= holdDelay)
+			return 0;
+
+		double rampTime = (maxFactor - 1) / acceleration;
+		double activeTime = time - holdDelay;
+
+		if (activeTime <= rampTime)
+			return activeTime + acceleration * activeTime * activeTime / 2;
+
+		return rampTime + acceleration * rampTime * rampTime / 2 + maxFactor * (activeTime - rampTime);
+	}
+};
@@ -0,0 +1,205 @@
+// =======================================================================================
+// Bench.cpp : The entry point of the Camera MFD benchmarks.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+// Usage: CameraMFD_Bench [-n iterations] [filter...]
+// Runs every registered benchmark whose name contains one of the filters (or all of them).
+
+#include "Bench.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Counts the heap allocations of each thread, to check code which shouldn't allocate, while the background threads of the MFD allocate.
+// All the forms of operator new and delete are replaced, so every block is allocated and freed by the same pair.
+static thread_local uint64_t allocations = 0;
+
+// Returns nullptr if the allocation fails. An over-aligned block is allocated larger, with the malloc block kept before it.
+static void *allocate(size_t size, size_t alignment)
+{
+	allocations++;
+
+	if (alignment <= alignof(std::max_align_t))
+		return malloc(size ? size : 1);
+
+	void *block = malloc(size + alignment + sizeof(void*));
+
+	if (!block)
+		return nullptr;
+
+	uintptr_t aligned = (uintptr_t(block) + sizeof(void*) + alignment - 1) & ~uintptr_t(alignment - 1);
+	reinterpret_cast<void**>(aligned)[-1] = block;
+
+	return reinterpret_cast<void*>(aligned);
+}
+
+static void deallocate(void *block, size_t alignment)
+{
+	if (block && alignment > alignof(std::max_align_t))
+		block = reinterpret_cast<void**>(block)[-1];
+
+	free(block);
+}
+
+static void *allocateOrThrow(size_t size, size_t alignment)
+{
+	if (void *block = allocate(size, alignment))
+		return block;
+
+	throw std::bad_alloc();
+}
+
+const size_t defaultAlignment = alignof(std::max_align_t);
+
+void *operator new(size_t size) { return allocateOrThrow(size, defaultAlignment); }
+void *operator new[](size_t size) { return allocateOrThrow(size, defaultAlignment); }
+void *operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, defaultAlignment); }
+void *operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, defaultAlignment); }
+
+void *operator new(size_t size, std::align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, size_t(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, size_t(alignment)); }
+
+void operator delete(void *block) noexcept { deallocate(block, defaultAlignment); }
+void operator delete[](void *block) noexcept { deallocate(block, defaultAlignment); }
+void operator delete(void *block, size_t) noexcept { deallocate(block, defaultAlignment); }
+void operator delete[](void *block, size_t) noexcept { deallocate(block, defaultAlignment); }
+void operator delete(void *block, const std::nothrow_t&) noexcept { deallocate(block, defaultAlignment); }
+void operator delete[](void *block, const std::nothrow_t&) noexcept { deallocate(block, defaultAlignment); }
+
+void operator delete(void *block, std::align_val_t alignment) noexcept { deallocate(block, size_t(alignment)); }
+void operator delete[](void *block, std::align_val_t alignment) noexcept { deallocate(block, size_t(alignment)); }
+void operator delete(void *block, size_t, std::align_val_t alignment) noexcept { deallocate(block, size_t(alignment)); }
+void operator delete[](void *block, size_t, std::align_val_t alignment) noexcept { deallocate(block, size_t(alignment)); }
+void operator delete(void *block, std::align_val_t alignment, const std::nothrow_t&) noexcept { deallocate(block, size_t(alignment)); }
+void operator delete[](void *block, std::align_val_t alignment, const std::nothrow_t&) noexcept { deallocate(block, size_t(alignment)); }
+
+namespace Bench
+{
+	struct Entry
+	{
+		const char *name;
+		Function func;
+	};
+
+	// Function-local so the registrars of other translation units can run before main
+	static std::vector<Entry> &GetEntries()
+	{
+		static std::vector<Entry> entries;
+		return entries;
+	}
+
+	static bool failed = false;
+
+	Registrar::Registrar(const char *name, Function func) { GetEntries().push_back({ name, func }); }
+
+	Histogram::Histogram(std::string name) : name(std::move(name)) { }
+
+	void Histogram::Print()
+	{
+		if (samples.empty())
+			return;
+
+		std::sort(samples.begin(), samples.end());
+
+		uint64_t total = 0;
+		for (uint64_t sample : samples)
+			total += sample;
+
+		auto percentile = [this](double p) { return samples[std::min(samples.size() - 1, size_t(p * samples.size()))]; };
+
+		printf("%-40s %9zu samples  mean %9.1f ns  p50 %7llu  p90 %7llu  p99 %7llu  max %9llu\n", name.c_str(), samples.size(),
+			double(total) / samples.size(), (unsigned long long)percentile(0.5), (unsigned long long)percentile(0.9),
+			(unsigned long long)percentile(0.99), (unsigned long long)samples.back());
+
+		// Log2 buckets, from the fastest to the slowest sample
+		size_t sampleIndex = 0;
+
+		for (uint64_t bucket = 1; sampleIndex < samples.size(); bucket <<= 1)
+		{
+			size_t count = 0;
+
+			while (sampleIndex < samples.size() && samples[sampleIndex] < bucket)
+			{
+				count++;
+				sampleIndex++;
+			}
+
+			if (count == 0)
+				continue;
+
+			int bar = int(60 * count / samples.size());
+			printf("    < %9llu ns %9zu |%.*s\n", (unsigned long long)bucket, count, bar,
+				"############################################################");
+		}
+	}
+
+	uint64_t Allocations() { return allocations; }
+
+	void Fail(const char *format, ...)
+	{
+		failed = true;
+
+		va_list args;
+		va_start(args, format);
+		printf("FAILED: ");
+		vprintf(format, args);
+		printf("\n");
+		va_end(args);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = 100000;
+	std::vector<const char*> filters;
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (!strcmp(argv[arg], "-n") && arg + 1 < argc)
+			iterations = std::max(1, atoi(argv[++arg]));
+		else
+			filters.push_back(argv[arg]);
+	}
+
+	for (const auto &entry : Bench::GetEntries())
+	{
+		bool selected = filters.empty();
+
+		for (const char *filter : filters)
+			selected |= strstr(entry.name, filter) != nullptr;
+
+		if (!selected)
+			continue;
+
+		printf("== %s\n", entry.name);
+		entry.func(iterations);
+		printf("\n");
+	}
+
+	return Bench::failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
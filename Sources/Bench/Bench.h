@@ -0,0 +1,108 @@
+// =======================================================================================
+// Bench.h : Timing and histogram helpers of the Camera MFD benchmarks.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Collects call latencies and prints their percentiles and a log2 histogram
+	class Histogram
+	{
+	public:
+		Histogram(std::string name);
+
+		void Add(uint64_t ns) { samples.push_back(ns); }
+		void Print();
+
+	private:
+		std::string name;
+		std::vector<uint64_t> samples;
+	};
+
+	// Times every call of func(iteration) and prints the histogram
+	template <typename Func>
+	void Time(const char *name, int iterations, Func &&func)
+	{
+		Histogram histogram(name);
+
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			auto start = Clock::now();
+			func(iteration);
+			auto end = Clock::now();
+
+			histogram.Add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+		}
+
+		histogram.Print();
+	}
+
+	// Times batches of calls for functions too fast for the clock, and prints the histogram of the average call time per batch
+	template <typename Func>
+	void Time(const char *name, int iterations, int batch, Func &&func)
+	{
+		Histogram histogram(name);
+
+		for (int iteration = 0; iteration < iterations; iteration += batch)
+		{
+			auto start = Clock::now();
+
+			for (int call = iteration; call < iteration + batch; call++)
+				func(call);
+
+			auto end = Clock::now();
+
+			histogram.Add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / batch);
+		}
+
+		histogram.Print();
+	}
+
+	// Keeps the compiler from optimizing away a computed value
+	template <typename T>
+	inline void Keep(const T &value) { asm volatile("" : : "m"(value) : "memory"); }
+
+	// Returns the count of heap allocations made by operator new so far, on the calling thread
+	uint64_t Allocations();
+
+	// Prints a failed check. The benchmark executable will return a non-zero exit code.
+	void Fail(const char *format, ...);
+
+	typedef void (*Function)(int iterations);
+
+	struct Registrar
+	{
+		Registrar(const char *name, Function func);
+	};
+}
+
+// Defines a benchmark function which is run by the benchmark executable
+#define BENCHMARK(name) \
+	static void name(int iterations); \
+	static Bench::Registrar name##Registrar(#name, name); \
+	static void name(int iterations)
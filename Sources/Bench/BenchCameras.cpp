@@ -0,0 +1,330 @@
+// =======================================================================================
+// BenchCameras.cpp : Benchmarks of the camera storage with many cameras.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+
+#include <malloc.h>
+#include <map>
+#include <random>
+
+template <typename Map>
+static void benchStorage(const char *name, int cameraCount, int iterations)
+{
+	Map cameras;
+	InternalData camData = { };
+	camData.label = "Camera";
+
+	for (int cam = 0; cam < cameraCount; cam++)
+	{
+		camData.pos = _V(cam, cam, cam);
+		cameras[cam * 2] = camData;
+	}
+
+	std::mt19937 random(1357);
+	std::vector<int> keys(4096);
+
+	for (int &key : keys)
+		key = int(random() % cameraCount) * 2;
+
+	std::string suffix = std::string(" (") + name + ", " + std::to_string(cameraCount) + " cameras)";
+
+	Bench::Time(("Lookup" + suffix).c_str(), iterations, 100, [&](int iteration)
+	{
+		Bench::Keep(cameras.at(keys[iteration % keys.size()]).pos);
+	});
+
+	int cam = 0;
+
+	Bench::Time(("Next camera" + suffix).c_str(), iterations, 100, [&](int)
+	{
+		auto nextCam = cameras.upper_bound(cam);
+		cam = nextCam == cameras.end() ? 0 : nextCam->first;
+		Bench::Keep(cam);
+	});
+
+	Bench::Time(("Iterate" + suffix).c_str(), iterations / 100 + 1, [&](int)
+	{
+		double sum = 0;
+
+		for (auto &&camera : cameras)
+			sum += camera.second.pos.x;
+
+		Bench::Keep(sum);
+	});
+}
+
+BENCHMARK(Cameras_Storage)
+{
+	// Check the FlatMap lookups against std::map, with keys around and between the stored ones
+	std::map<int, int> map;
+	FlatMap<int, int> flatMap;
+
+	for (int count = 0; count < 40; count++)
+	{
+		for (int key = -2; key <= 2 * count + 2; key++)
+		{
+			if (map.lower_bound(key) == map.end() ? flatMap.lower_bound(key) != flatMap.end() : map.lower_bound(key)->first != flatMap.lower_bound(key)->first)
+				Bench::Fail("FlatMap::lower_bound(%d) with %d keys", key, count);
+
+			if (map.upper_bound(key) == map.end() ? flatMap.upper_bound(key) != flatMap.end() : map.upper_bound(key)->first != flatMap.upper_bound(key)->first)
+				Bench::Fail("FlatMap::upper_bound(%d) with %d keys", key, count);
+
+			if ((map.find(key) == map.end()) != (flatMap.find(key) == flatMap.end()))
+				Bench::Fail("FlatMap::find(%d) with %d keys", key, count);
+		}
+
+		map[2 * count] = flatMap[2 * count] = count;
+	}
+
+	for (int cameraCount : { 500, 2000 })
+	{
+		benchStorage<std::map<int, InternalData>>("std::map", cameraCount, iterations);
+		benchStorage<FlatMap<int, InternalData>>("FlatMap", cameraCount, iterations);
+	}
+}
+
+BENCHMARK(Cameras_MFD)
+{
+	MFDFixture fixture;
+
+	const int cameraCount = 500;
+	CameraMFD::CameraData cameraData = fixture.mfd->GetCameraData(0);
+
+	// Switch to page 1 for the camera buttons
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_P);
+
+	for (int cam = 10; cam < 10 + cameraCount; cam++)
+	{
+		cameraData.label = "Camera " + std::to_string(cam);
+		cameraData.pos = _V(cam, 0, 0);
+		fixture.mfd->AddCamera(cam, cameraData);
+	}
+
+	Bench::Time("CM+/CM- (500 cameras)", iterations, [&](int iteration)
+	{
+		if (!fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_C))
+			fixture.mfd->SetCurrentCamera(0);
+	});
+
+	FILEHANDLE scn = Headless::CreateScenario();
+
+	Bench::Time("WriteStatus (500 cameras)", std::min(iterations, 1000), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->WriteStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+
+	Bench::Time("DeleteCamera (500 cameras)", cameraCount, [&](int cam) { fixture.mfd->DeleteCamera(10 + cam); });
+
+	if (fixture.mfd->GetCameraCount() != 7)
+		Bench::Fail("%d cameras left after deleting the added ones, expected 7", fixture.mfd->GetCameraCount());
+}
+
+// Returns the heap bytes in use, including the C allocations which aren't counted by Bench::Allocations
+static size_t heapInUse() { return mallinfo2().uordblks; }
+
+// Returns the count of the lines of a scenario which start with the passed item
+static size_t countItems(const std::string &status, const std::string &item)
+{
+	size_t count = 0;
+
+	for (size_t pos = status.find("  " + item + " "); pos != std::string::npos; pos = status.find("  " + item + " ", pos + 1))
+		if (pos == 0 || status[pos - 1] == '\n')
+			count++;
+
+	return count;
+}
+
+BENCHMARK(Cameras_Status)
+{
+	MFDFixture fixture;
+
+	const int cameraCount = 1000;
+	CameraMFD::CameraData cameraData = fixture.mfd->GetCameraData(0);
+
+	for (int cam = 10; cam < 10 + cameraCount; cam++)
+	{
+		cameraData.label = "Camera " + std::to_string(cam);
+		cameraData.pos = _V(cam * 0.25, -cam * 0.5, 1.125);
+		cameraData.pitchAngle = cam % 90;
+		cameraData.yawAngle = -(cam % 45);
+		cameraData.rotAngle = cam % 30 * 0.5;
+		cameraData.fov = 20 + cam % 40;
+		fixture.mfd->AddCamera(cam, cameraData);
+	}
+
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	std::string legacy = Headless::GetScenario(scn);
+
+	Bench::Time("WriteStatus (1000 cameras)", std::min(iterations, 500), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->WriteStatus(scn);
+	});
+
+	// The output keeps its capacity, so the heap in use changes only by leaks
+	size_t heap = heapInUse();
+
+	for (int save = 0; save < 10; save++)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->WriteStatus(scn);
+	}
+
+	if (heapInUse() > heap)
+		Bench::Fail("10 saves leaked %zu bytes", heapInUse() - heap);
+
+	// The compact format, switched on by its item
+	fixture.ReadStatus("CCOMPACT 1\n" + legacy + "END_MFD\n");
+
+	Headless::RewindScenario(scn);
+	fixture.mfd->WriteStatus(scn);
+
+	std::string compact = Headless::GetScenario(scn);
+
+	if (countItems(compact, "CAM") != size_t(fixture.mfd->GetCameraCount()) || countItems(compact, "CCAM") != 0)
+		Bench::Fail("the compact status has %zu CAM and %zu CCAM lines, expected %d and 0", countItems(compact, "CAM"), countItems(compact, "CCAM"), fixture.mfd->GetCameraCount());
+
+	Bench::Time("WriteStatus (1000 cameras, compact)", std::min(iterations, 500), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->WriteStatus(scn);
+	});
+
+	printf("Status: %zu bytes, %zu bytes compact (%.1f%%)\n", legacy.size(), compact.size(), 100.0 * compact.size() / legacy.size());
+
+	Headless::CloseScenario(scn);
+
+	// A save into an output with the capacity for it doesn't allocate
+	scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+	Headless::RewindScenario(scn);
+
+	uint64_t allocations = Bench::Allocations();
+	fixture.mfd->WriteStatus(scn);
+
+	if (Bench::Allocations() != allocations)
+		Bench::Fail("a compact save made %llu allocations", (unsigned long long)(Bench::Allocations() - allocations));
+
+	Headless::CloseScenario(scn);
+
+	// Both formats read back into the same cameras
+	std::vector<CameraMFD::CameraData> expected;
+
+	for (int cam = 10; cam < 10 + cameraCount; cam++)
+		expected.push_back(fixture.mfd->GetCameraData(cam));
+
+	for (const std::string *status : { &legacy, &compact })
+	{
+		fixture.ReadStatus(*status + "END_MFD\n");
+
+		for (int cam = 10; cam < 10 + cameraCount; cam++)
+		{
+			CameraMFD::CameraData read = fixture.mfd->GetCameraData(cam);
+			const CameraMFD::CameraData &original = expected[cam - 10];
+
+			double error = std::max({ length(read.pos - original.pos), fabs(read.pitchAngle - original.pitchAngle), fabs(read.yawAngle - original.yawAngle),
+				fabs(read.rotAngle - original.rotAngle), fabs(read.fov - original.fov) });
+
+			if (read.label != original.label || error > 1e-6)
+			{
+				Bench::Fail("camera %d was read back from the %s status as '%s', off by %g", cam, status == &legacy ? "legacy" : "compact", read.label.c_str(), error);
+				break;
+			}
+		}
+	}
+
+	scn = Headless::OpenScenario(compact + "END_MFD\n");
+
+	Bench::Time("ReadStatus (1000 cameras, compact)", std::min(iterations, 500), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->ReadStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+
+	scn = Headless::OpenScenario(legacy + "END_MFD\n");
+
+	Bench::Time("ReadStatus (1000 cameras)", std::min(iterations, 500), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->ReadStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+}
+
+BENCHMARK(Cameras_Batch)
+{
+	MFDFixture fixture;
+
+	const int cameraCount = 40;
+	CameraMFD::CameraData cameraData = fixture.mfd->GetCameraData(0);
+
+	// Sets up the cameras as a vessel does in clbkGeneric, then deletes them
+	auto setupCameras = [&](bool batch)
+	{
+		if (batch)
+			fixture.mfd->BeginUpdate();
+
+		for (int cam = 10; cam < 10 + cameraCount; cam++)
+		{
+			cameraData.pos = _V(cam, 0, 0);
+			fixture.mfd->AddCamera(cam, cameraData);
+		}
+
+		fixture.mfd->SetCurrentCamera(10);
+
+		for (int cam = 10; cam < 10 + cameraCount; cam++)
+			fixture.mfd->DeleteCamera(cam);
+
+		if (batch)
+			fixture.mfd->EndUpdate();
+	};
+
+	for (bool batch : { false, true })
+	{
+		Headless::ResetCounters();
+		Headless::Step(0.02);
+
+		setupCameras(batch);
+		fixture.mfd->Update(&fixture.skp);
+
+		// The changes are committed by the frame update
+		if (Headless::counters.setupCustomCamera != 1 || Headless::counters.invalidateButtons != 1)
+			Bench::Fail("%zu camera setups and %zu button updates for %d cameras%s, expected 1", Headless::counters.setupCustomCamera,
+				Headless::counters.invalidateButtons, cameraCount, batch ? " in a batch" : "");
+
+		if (batch && Headless::counters.invalidateDisplay != 1)
+			Bench::Fail("%zu display updates for %d cameras in a batch, expected 1", Headless::counters.invalidateDisplay, cameraCount);
+
+		Bench::Time(batch ? "Add and delete 40 cameras (batch)" : "Add and delete 40 cameras", std::min(iterations, 10000), [&](int) { setupCameras(batch); });
+	}
+
+	if (fixture.mfd->GetCameraCount() != 7)
+		Bench::Fail("%d cameras left after deleting the added ones, expected 7", fixture.mfd->GetCameraCount());
+}
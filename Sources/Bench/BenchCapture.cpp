@@ -0,0 +1,389 @@
+// =======================================================================================
+// BenchCapture.cpp : Benchmarks of the frame capture and its encoders.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+#include "../FrameCapture.h"
+
+#include <filesystem>
+#include <thread>
+
+namespace
+{
+	const DWORD width = 512;
+	const DWORD height = 384;
+
+	// Fills a frame with the headless read back pattern
+	std::vector<uint8_t> syntheticFrame(uint32_t content)
+	{
+		std::vector<uint8_t> pixels(size_t(width) * height * 4);
+
+		for (DWORD y = 0; y < height; y++)
+		{
+			for (DWORD x = 0; x < width; x++)
+			{
+				uint8_t *px = &pixels[(size_t(y) * width + x) * 4];
+
+				px[0] = uint8_t(x + content);
+				px[1] = uint8_t(y + content * 2);
+				px[2] = uint8_t(((x / 8) ^ (y / 8)) * 16);
+				px[3] = 0;
+			}
+		}
+
+		return pixels;
+	}
+
+	uint32_t readBE32(const uint8_t *data) { return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3]; }
+
+	uint32_t crc32(const uint8_t *data, size_t size)
+	{
+		uint32_t crc = 0xFFFFFFFF;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			crc ^= data[i];
+
+			for (int k = 0; k < 8; k++)
+				crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+		}
+
+		return ~crc;
+	}
+
+	// Decodes a QOI image into RGB. Returns false if it's malformed.
+	bool decodeQOI(const std::vector<uint8_t> &qoi, std::vector<uint8_t> &rgb)
+	{
+		if (qoi.size() < 22 || memcmp(qoi.data(), "qoif", 4) != 0)
+			return false;
+
+		size_t count = size_t(readBE32(&qoi[4])) * readBE32(&qoi[8]);
+		uint8_t index[64][4] = {};
+		uint8_t px[4] = { 0, 0, 0, 255 };
+		size_t pos = 14;
+
+		rgb.clear();
+
+		while (rgb.size() < count * 3 && pos < qoi.size() - 8)
+		{
+			uint8_t b1 = qoi[pos++];
+			int run = 1;
+
+			if (b1 == 0xFE)
+			{
+				px[0] = qoi[pos++];
+				px[1] = qoi[pos++];
+				px[2] = qoi[pos++];
+			}
+			else if ((b1 & 0xC0) == 0x00)
+				memcpy(px, index[b1], 4);
+
+			else if ((b1 & 0xC0) == 0x40)
+			{
+				px[0] += ((b1 >> 4) & 3) - 2;
+				px[1] += ((b1 >> 2) & 3) - 2;
+				px[2] += (b1 & 3) - 2;
+			}
+			else if ((b1 & 0xC0) == 0x80)
+			{
+				uint8_t b2 = qoi[pos++];
+				int dg = (b1 & 0x3F) - 32;
+
+				px[0] += dg - 8 + ((b2 >> 4) & 0x0F);
+				px[1] += dg;
+				px[2] += dg - 8 + (b2 & 0x0F);
+			}
+			else
+				run = (b1 & 0x3F) + 1;
+
+			memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+
+			for (int i = 0; i < run; i++)
+				rgb.insert(rgb.end(), px, px + 3);
+		}
+
+		return rgb.size() == count * 3;
+	}
+
+	// Reads the scanlines of a PNG with stored deflate blocks. Returns false if a chunk CRC or the structure is wrong.
+	bool readPNG(const std::vector<uint8_t> &png, std::vector<uint8_t> &raw)
+	{
+		if (png.size() < 8 || memcmp(png.data(), "\x89PNG\r\n\x1A\n", 8) != 0)
+			return false;
+
+		std::vector<uint8_t> zlib;
+
+		for (size_t pos = 8; pos + 12 <= png.size();)
+		{
+			uint32_t length = readBE32(&png[pos]);
+
+			if (pos + 12 + length > png.size() || crc32(&png[pos + 4], length + 4) != readBE32(&png[pos + 8 + length]))
+				return false;
+
+			if (!memcmp(&png[pos + 4], "IDAT", 4))
+				zlib.insert(zlib.end(), &png[pos + 8], &png[pos + 8 + length]);
+
+			pos += 12 + length;
+		}
+
+		raw.clear();
+
+		for (size_t pos = 2; pos + 5 <= zlib.size() - 4;)
+		{
+			bool final = zlib[pos] & 1;
+			size_t length = zlib[pos + 1] | zlib[pos + 2] << 8;
+
+			raw.insert(raw.end(), &zlib[pos + 5], &zlib[pos + 5 + length]);
+			pos += 5 + length;
+
+			if (final)
+				break;
+		}
+
+		return true;
+	}
+
+	size_t countFiles(const std::string &folder)
+	{
+		size_t count = 0;
+
+		for (auto &entry : std::filesystem::directory_iterator(folder))
+			count += entry.is_regular_file();
+
+		return count;
+	}
+}
+
+BENCHMARK(Capture_Encoders)
+{
+	std::vector<uint8_t> pixels = syntheticFrame(7);
+	std::vector<uint8_t> out;
+
+	int encodes = std::max(1, iterations / 1000);
+	double frameMB = width * height * 3 / 1e6;
+
+	// Round trip the QOI frame
+	FrameCapture::EncodeQOI(pixels.data(), width, height, out);
+
+	std::vector<uint8_t> rgb, expected;
+
+	for (size_t i = 0; i < pixels.size(); i += 4)
+		expected.insert(expected.end(), { pixels[i + 2], pixels[i + 1], pixels[i] });
+
+	if (!decodeQOI(out, rgb) || rgb != expected)
+		Bench::Fail("the QOI frame doesn't decode to the captured pixels");
+
+	printf("QOI: %zu bytes, %.1f%% of the RGB frame\n", out.size(), 100.0 * out.size() / expected.size());
+
+	// Read back the PNG scanlines
+	out.clear();
+	FrameCapture::EncodePNG(pixels.data(), width, height, out);
+
+	std::vector<uint8_t> raw, scanlines;
+
+	for (DWORD y = 0; y < height; y++)
+	{
+		scanlines.push_back(0);
+		scanlines.insert(scanlines.end(), &expected[size_t(y) * width * 3], &expected[size_t(y + 1) * width * 3]);
+	}
+
+	if (!readPNG(out, raw) || raw != scanlines)
+		Bench::Fail("the PNG frame doesn't read back to the captured pixels");
+
+	printf("PNG: %zu bytes\n", out.size());
+
+	// A gray frame has the gray luma and neutral chroma
+	out.clear();
+	std::vector<uint8_t> gray(pixels.size(), 200);
+	FrameCapture::EncodeY4MFrame(gray.data(), width, height, out);
+
+	size_t frameSize = 6 + size_t(width) * height * 3 / 2;
+
+	if (out.size() != frameSize || out[6] != 200 || out[6 + width * height] != 128 || out.back() != 128)
+		Bench::Fail("the Y4M gray frame is %zu bytes with luma %d and chroma %d, expected %zu bytes, 200 and 128", out.size(), out[6], out.back(), frameSize);
+
+	const char *names[] = { "EncodePNG", "EncodeQOI", "EncodeY4MFrame" };
+	void (*encoders[])(const uint8_t*, DWORD, DWORD, std::vector<uint8_t>&) = { FrameCapture::EncodePNG, FrameCapture::EncodeQOI, FrameCapture::EncodeY4MFrame };
+
+	for (int format = 0; format < FrameCapture::FORMAT_COUNT; format++)
+	{
+		auto start = Bench::Clock::now();
+
+		Bench::Time((std::string(names[format]) + " 512x384").c_str(), encodes, [&](int)
+		{
+			out.clear();
+			encoders[format](pixels.data(), width, height, out);
+		});
+
+		double seconds = std::chrono::duration<double>(Bench::Clock::now() - start).count();
+		printf("%s: %.0f MB/s of RGB frames\n", names[format], frameMB * encodes / seconds);
+	}
+}
+
+BENCHMARK(Capture_Ring)
+{
+	SetupOrbiterRoot();
+
+	SURFHANDLE hSurf = oapiCreateSurfaceEx(width, height, OAPISURFACE_RENDERTARGET);
+	size_t ringSize = FrameCapture::defaultRingSize;
+
+	for (int format = 0; format < FrameCapture::FORMAT_COUNT; format++)
+	{
+		const char *name = FrameCapture::FormatName(format);
+		std::string folder = std::string("Images/Bench/") + name;
+
+		// Frames paced at 250 fps. Only the capture calls are timed; the drops depend on the encoder and disk speed, so they're only reported.
+		FrameCapture *capture = new FrameCapture(folder + "_paced", FrameCapture::Format(format), width, height, 60);
+		Bench::Histogram histogram(std::string("Capture (") + name + ", paced)");
+
+		for (int frame = 0; frame < 100; frame++)
+		{
+			auto start = Bench::Clock::now();
+			capture->Capture(hSurf, width, height);
+			histogram.Add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Bench::Clock::now() - start).count()));
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(4));
+		}
+
+		histogram.Print();
+
+		FrameCapture::Stats stats = capture->GetStats();
+		delete capture;
+
+		printf("%s paced: %zu captured, %zu dropped (%.1f%%), max queue %zu\n", name, stats.captured, stats.dropped,
+			100.0 * stats.dropped / (stats.captured + stats.dropped), stats.maxQueueDepth);
+
+		// A burst faster than the workers fills the ring, and the frames over it are dropped
+		capture = new FrameCapture(folder + "_burst", FrameCapture::Format(format), width, height, 60);
+
+		int frames = 300;
+
+		for (int frame = 0; frame < frames; frame++)
+			capture->Capture(hSurf, width, height);
+
+		stats = capture->GetStats();
+
+		// Stopping with a full ring leaves the frames to the workers
+		auto stopStart = Bench::Clock::now();
+		FrameCapture::Finish(std::unique_ptr<FrameCapture>(capture));
+		double stopTime = std::chrono::duration<double, std::micro>(Bench::Clock::now() - stopStart).count();
+
+		FrameCapture::DeleteFinished(true);
+
+		printf("%s burst: %zu captured, %zu dropped, max queue %zu, stopped in %.1f us\n", name, stats.captured, stats.dropped, stats.maxQueueDepth, stopTime);
+
+		if (stats.captured + stats.dropped != size_t(frames) || stats.maxQueueDepth > ringSize)
+			Bench::Fail("%s burst: %zu captured and %zu dropped of %d frames, max queue %zu of %zu", name, stats.captured, stats.dropped, frames, stats.maxQueueDepth, ringSize);
+
+		// Check the written frames
+		for (const char *run : { "_paced", "_burst" })
+		{
+			std::string runFolder = folder + run;
+
+			if (format == FrameCapture::FORMAT_Y4M)
+			{
+				size_t headerSize = FrameCapture::Y4MHeader(width, height, 60).size();
+				size_t fileSize = size_t(std::filesystem::file_size(runFolder + "/capture.y4m"));
+				size_t frameCount = (fileSize - headerSize) / (6 + size_t(width) * height * 3 / 2);
+
+				if ((fileSize - headerSize) % (6 + size_t(width) * height * 3 / 2) != 0)
+					Bench::Fail("the %s Y4M file size %zu isn't whole frames", run, fileSize);
+
+				printf("%s%s: %zu frames in the video\n", name, run, frameCount);
+			}
+			else
+			{
+				size_t files = countFiles(runFolder);
+				printf("%s%s: %zu files\n", name, run, files);
+
+				if (!strcmp(run, "_burst") && files != stats.captured)
+					Bench::Fail("%zu %s files written of %zu burst frames captured", files, name, stats.captured);
+			}
+		}
+	}
+
+	oapiDestroySurface(hSurf);
+}
+
+BENCHMARK(Capture_MFD)
+{
+	MFDFixture fixture;
+
+	// Switch to the layout and capture page
+	while (std::string(fixture.mfd->ButtonLabel(7)) != "REC")
+	{
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_P);
+		fixture.Frame(1.0 / 60);
+	}
+
+	for (int count = 0; count < FrameCapture::FORMAT_COUNT; count++)
+	{
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_Y);
+		const FrameCapture *capture = fixture.mfd->GetCapture();
+
+		if (!capture)
+		{
+			Bench::Fail("the capture didn't start");
+			return;
+		}
+
+		int format = capture->GetFormat();
+
+		std::string folder = capture->GetFolder();
+
+		Headless::ResetCounters();
+		Bench::Time((std::string("Frame (capturing ") + FrameCapture::FormatName(format) + ")").c_str(), 120, [&](int) { fixture.Frame(1.0 / 60); });
+
+		FrameCapture::Stats stats = capture->GetStats();
+		size_t renders = Headless::counters.cameraRenders;
+
+		auto stopStart = Bench::Clock::now();
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_Y);
+		double stopTime = std::chrono::duration<double, std::micro>(Bench::Clock::now() - stopStart).count();
+
+		if (fixture.mfd->GetCapture())
+			Bench::Fail("the capture didn't stop");
+
+		if (FrameCapture::GetFinishingCount() > 1)
+			Bench::Fail("%zu captures finishing after stopping one", FrameCapture::GetFinishingCount());
+
+		// The next frames delete the capture once its workers are done
+		for (int wait = 0; wait < 10000 && FrameCapture::GetFinishingCount(); wait++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			fixture.Frame(0);
+		}
+
+		if (FrameCapture::GetFinishingCount())
+			Bench::Fail("the stopped capture wasn't deleted");
+
+		size_t written = format == FrameCapture::FORMAT_Y4M ? (std::filesystem::file_size(folder + "/capture.y4m") - FrameCapture::Y4MHeader(512, 512, 60).size()) /
+			(6 + 512 * 512 * 3 / 2) : countFiles(folder);
+
+		printf("%s: %zu frames captured, %zu dropped, %zu written to %s, stopped in %.1f us\n", FrameCapture::FormatName(format), stats.captured, stats.dropped, written, folder.c_str(), stopTime);
+
+		if (stats.captured + stats.dropped != renders || written != stats.captured)
+			Bench::Fail("%zu captured and %zu dropped frames of %zu renders, %zu written", stats.captured, stats.dropped, renders, written);
+
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_F);
+		fixture.Frame(1.0 / 60);
+	}
+}
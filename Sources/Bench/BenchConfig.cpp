@@ -0,0 +1,498 @@
+// =======================================================================================
+// BenchConfig.cpp : Benchmarks the loading of the vessel configuration files.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+#include "../ConfigCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+DLLCLBK void opcOpenRenderViewport(HWND hRenderWnd, DWORD width, DWORD height, BOOL fullscreen);
+DLLCLBK void opcDeleteVessel(OBJHANDLE hVessel);
+
+// Writes a configuration file with the given camera count
+static void writeConfig(const std::string &name, int cameraCount)
+{
+	std::ofstream file(SetupOrbiterRoot() / "Config" / "CameraMFD" / (name + ".cfg"));
+
+	file << "CADJ 1\nCPG 0\nCINF 2\n\n";
+
+	for (int cam = 0; cam < cameraCount; cam++)
+	{
+		file << "CCAM " << cam << "\n";
+		file << "CLBL " << (cam % 3 ? "Cabin Camera" : "Wing Camera " + std::to_string(cam)) << "\n";
+		file << "CPOS " << cam * 0.01 << " 1.25 -3.50\n";
+		file << "CPIT " << cam % 90 << ".50\nCYAW " << cam % 180 << ".25\nCROT 10.00\nCFOV 40.00\n";
+
+		// A path on some cameras
+		if (cam % 100 == 0)
+		{
+			for (int key = 0; key < 4; key++)
+				file << "CKEY " << key * 2.5 << " " << cam * 0.01 << " 1.25 " << key - 3.5 << " " << key * 5 << " 0 0 " << 40 + key << "\n";
+
+			if (cam % 200 == 0)
+				file << "CLOOP 0\n";
+		}
+
+		file << "\n";
+	}
+
+	file << "CURCAM " << cameraCount / 2 << "\n";
+}
+
+static std::string writeStatus(Camera_MFD *mfd)
+{
+	FILEHANDLE scn = Headless::CreateScenario();
+	mfd->WriteStatus(scn);
+
+	std::string status = Headless::GetScenario(scn);
+	Headless::CloseScenario(scn);
+
+	return status;
+}
+
+BENCHMARK(Config_Load)
+{
+	SetupOrbiterRoot();
+
+	for (int cameraCount : { 1000, 10000 })
+	{
+		std::string name = "Bench" + std::to_string(cameraCount);
+		std::string configFile = "CameraMFD/" + name + ".cfg";
+		std::string suffix = " (" + std::to_string(cameraCount) + " cameras)";
+
+		writeConfig(name, cameraCount);
+
+		Headless::Vessel vessel{ name.c_str() };
+		Camera_MFD mfd(512, 512, &vessel, 0);
+
+		// The MFD loads the file by the CCFG scenario line
+		FILEHANDLE scn = Headless::OpenScenario("CCFG " + name + "\nEND_MFD\n");
+		int loadCount = std::max(1, std::min(iterations, 200000 / cameraCount));
+
+		ConfigCache::enabled = false;
+
+		Bench::Time(("Text parse" + suffix).c_str(), loadCount, [&](int)
+		{
+			Headless::RewindScenario(scn);
+			mfd.ReadStatus(scn);
+		});
+
+		std::string textStatus = writeStatus(&mfd);
+
+		ConfigCache::enabled = true;
+
+		// Compile the cache
+		Headless::RewindScenario(scn);
+		mfd.ReadStatus(scn);
+
+		if (!std::filesystem::exists(ConfigCache::GetCachePath(configFile)))
+			Bench::Fail("%s wasn't compiled into a cache", configFile.c_str());
+
+		Headless::ResetCounters();
+
+		Bench::Time(("Cache load" + suffix).c_str(), loadCount, [&](int)
+		{
+			Headless::RewindScenario(scn);
+			mfd.ReadStatus(scn);
+		});
+
+		if (Headless::counters.openFile != 0)
+			Bench::Fail("%s was read as text %d times with an up to date cache", configFile.c_str(), Headless::counters.openFile);
+
+		if (writeStatus(&mfd) != textStatus)
+			Bench::Fail("The MFD status differs between the text and the cache loads of %s", configFile.c_str());
+
+		// Changing the file should rebuild the cache
+		writeConfig(name, cameraCount + 1);
+
+		Headless::RewindScenario(scn);
+		mfd.ReadStatus(scn);
+
+		if (mfd.GetCameraCount() != cameraCount + 1)
+			Bench::Fail("%d cameras loaded after changing %s, expected %d", mfd.GetCameraCount(), configFile.c_str(), cameraCount + 1);
+
+		Headless::ResetCounters();
+		Headless::RewindScenario(scn);
+		mfd.ReadStatus(scn);
+
+		if (Headless::counters.openFile != 0 || mfd.GetCameraCount() != cameraCount + 1)
+			Bench::Fail("The cache of %s wasn't rebuilt after changing it", configFile.c_str());
+
+		Headless::CloseScenario(scn);
+	}
+
+	opcCloseRenderViewport();
+}
+
+BENCHMARK(Config_Delta)
+{
+	const int cameraCount = 1000;
+
+	writeConfig("Delta", cameraCount);
+	std::ofstream(SetupOrbiterRoot() / "Config" / "CameraMFD" / "Delta.cfg", std::ios::app) << "CDELTA 1\n";
+
+	MFDFixture fixture;
+	fixture.ReadStatus("CCFG Delta\nEND_MFD\n");
+
+	// A session which changes a few cameras: moved and zoomed by the user, a new path, one deleted and one added
+	const int movedCameras[] = { 10, 250, 499, 998 };
+
+	for (int cam : movedCameras)
+	{
+		fixture.mfd->SetCurrentCamera(cam);
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_A);
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_Z);
+		fixture.Frame(0.02);
+	}
+
+	CameraMFD::CameraKey keys[2] = { { 0, _V(1, 2, 3), 0, 0, 0, 40 }, { 5, _V(-1, 2, 3), 10, 20, 0, 50 } };
+	fixture.mfd->SetCameraPath(300, keys, 2, false);
+
+	fixture.mfd->DeleteCamera(500);
+	fixture.mfd->AddCamera(cameraCount + 10, fixture.mfd->GetCameraData(20));
+	fixture.mfd->SetCurrentCamera(250);
+	fixture.Frame(0.02);
+
+	std::string delta = writeStatus(fixture.mfd);
+
+	if (delta.find("CBASE Delta") > delta.find("CADJ"))
+		Bench::Fail("the delta status doesn't start with its configuration file: %.20s", delta.c_str());
+
+	// The views of the changed cameras and the API data of all the cameras, to check the delta status reads back into them
+	auto views = [&]
+	{
+		std::vector<Headless::Camera> cameras;
+
+		for (int cam : movedCameras)
+		{
+			fixture.mfd->SetCurrentCamera(cam);
+			fixture.Frame(0);
+			cameras.push_back(Headless::lastCamera);
+		}
+
+		fixture.mfd->SetCurrentCamera(250);
+		fixture.Frame(0);
+
+		return cameras;
+	};
+
+	std::vector<CameraMFD::CameraData> expected;
+
+	for (int cam = 0; cam <= cameraCount + 10; cam++)
+		expected.push_back(fixture.mfd->GetCameraData(cam));
+
+	// The same MFD written in full, by switching the delta mode off after the configuration file is loaded
+	fixture.ReadStatus(delta.substr(0, delta.find('\n') + 1) + "CDELTA 0\n" + delta.substr(delta.find('\n') + 1) + "END_MFD\n");
+	std::string full = writeStatus(fixture.mfd);
+
+	// The directions are set from the angles sums when they are read, so the views are compared with the full status views
+	std::vector<Headless::Camera> expectedViews = views();
+
+	printf("Status: %zu bytes, %zu bytes delta (%.1f%%)\n", full.size(), delta.size(), 100.0 * delta.size() / full.size());
+
+	if (delta.size() * 10 > full.size())
+		Bench::Fail("the delta status of 7 changed cameras is %zu bytes, over 10%% of the full status (%zu bytes)", delta.size(), full.size());
+
+	fixture.ReadStatus(delta + "END_MFD\n");
+
+	if (fixture.mfd->GetCameraCount() != cameraCount || fixture.mfd->GetCurrentCamera() != 250)
+		Bench::Fail("%d cameras read from the delta status with camera %d selected, expected %d and 250", fixture.mfd->GetCameraCount(), fixture.mfd->GetCurrentCamera(), cameraCount);
+
+	for (int cam = 0; cam <= cameraCount + 10; cam++)
+	{
+		CameraMFD::CameraData read = fixture.mfd->GetCameraData(cam);
+		const CameraMFD::CameraData &original = expected[cam];
+
+		double error = std::max({ length(read.pos - original.pos), fabs(read.pitchAngle - original.pitchAngle), fabs(read.yawAngle - original.yawAngle),
+			fabs(read.rotAngle - original.rotAngle), fabs(read.fov - original.fov) });
+
+		if (read.label != original.label || error > 1e-6)
+		{
+			Bench::Fail("camera %d was read back from the delta status as '%s', off by %g", cam, read.label.c_str(), error);
+			break;
+		}
+	}
+
+	std::vector<Headless::Camera> readViews = views();
+
+	for (size_t index = 0; index < readViews.size(); index++)
+	{
+		double error = std::max({ length(readViews[index].pos - expectedViews[index].pos), length(readViews[index].dir - expectedViews[index].dir),
+			fabs(readViews[index].fov - expectedViews[index].fov) });
+
+		if (error > 1e-5)
+			Bench::Fail("the view of camera %d was read back from the delta status off by %g", movedCameras[index], error);
+	}
+
+	if (writeStatus(fixture.mfd) != delta)
+		Bench::Fail("the delta status changed after reading it back");
+
+	FILEHANDLE scn = Headless::OpenScenario(delta + "END_MFD\n");
+
+	Bench::Time("ReadStatus (1000 cameras, delta)", std::min(iterations, 500), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->ReadStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+
+	scn = Headless::OpenScenario(full + "END_MFD\n");
+
+	Bench::Time("ReadStatus (1000 cameras, full)", std::min(iterations, 500), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->ReadStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+}
+
+BENCHMARK(Config_Reload)
+{
+	const int cameraCount = 1000;
+
+	writeConfig("Reload", cameraCount);
+
+	ConfigWatcher::interval = 0.01;
+
+	MFDFixture fixture;
+	fixture.ReadStatus("CCFG Reload\nEND_MFD\n");
+
+	const ConfigWatcher *watcher = Camera_MFD::GetConfigWatcher();
+
+	if (!watcher || watcher->GetFileCount() == 0)
+	{
+		Bench::Fail("the loaded configuration file isn't watched");
+		return;
+	}
+
+	// A user offset, which the reload keeps
+	fixture.mfd->SetCurrentCamera(10);
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_A);
+	fixture.Frame(0.02);
+
+	size_t reloads = watcher->GetReloads();
+
+	std::ofstream(SetupOrbiterRoot() / "Config" / "CameraMFD" / "Reload.cfg", std::ios::app) << "CCAM 10\nCLBL Tuned Camera\nCPOS 5 6 7\nCPIT 1\nCYAW 2\nCROT 3\n";
+
+	for (int wait = 0; wait < 400 && watcher->GetReloads() == reloads; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	if (watcher->GetReloads() == reloads)
+	{
+		Bench::Fail("the changed configuration file wasn't parsed again in 2 seconds");
+		return;
+	}
+
+	// The snapshot is adopted by the next update, without reading the file on the simulation thread
+	Headless::ResetCounters();
+	fixture.Frame(0.02);
+
+	if (Headless::counters.openFile != 0)
+		Bench::Fail("the MFD update opened %d files to adopt the changed configuration", Headless::counters.openFile);
+
+	CameraMFD::CameraData camera = fixture.mfd->GetCameraData(10);
+
+	if (camera.label != "Tuned Camera" || length(camera.pos - _V(5, 6, 7)) > 1e-9 || camera.pitchAngle != 1 || camera.yawAngle != 2 || camera.rotAngle != 3)
+		Bench::Fail("camera 10 is '%s' at (%g, %g, %g) after the reload, expected 'Tuned Camera' at (5, 6, 7)", camera.label.c_str(), camera.pos.x, camera.pos.y, camera.pos.z);
+
+	std::string status = writeStatus(fixture.mfd);
+
+	if (status.find("CUYAW 0.500000") == std::string::npos)
+		Bench::Fail("the user offset of camera 10 was lost by the reload");
+
+	if (fixture.mfd->GetCameraCount() != cameraCount)
+		Bench::Fail("%d cameras after the reload, expected %d", fixture.mfd->GetCameraCount(), cameraCount);
+
+	Bench::Time("LoadConfig (1000 cameras)", std::min(iterations, 200), [&](int)
+	{
+		Camera_MFD::LoadConfig("Reload");
+	});
+
+	Bench::Time("Update (watched, unchanged)", iterations, [&](int)
+	{
+		fixture.Frame(0.02);
+	});
+
+	// The files which include another file (CCFG) are parsed again when the included file changes,
+	// for a file read by the MFD (Outer) and a file loaded by the watcher (the vessel class ReloadAsync)
+	std::filesystem::path configFolder = SetupOrbiterRoot() / "Config" / "CameraMFD";
+
+	writeConfig("ReloadInner", 10);
+	std::ofstream(configFolder / "ReloadOuter.cfg") << "CCFG ReloadInner\n";
+	std::ofstream(configFolder / "ReloadAsync.cfg") << "CCFG ReloadInner\n";
+
+	fixture.ReadStatus("CCFG ReloadOuter\nEND_MFD\n");
+
+	Headless::Vessel asyncVessel{ "ReloadAsync" };
+	Camera_MFD *asyncMFD = new Camera_MFD(512, 512, &asyncVessel, 0);
+
+	for (int wait = 0; wait < 2000 && (asyncMFD->Update(&fixture.skp), asyncMFD->IsConfigPending()); wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	reloads = watcher->GetReloads();
+
+	std::ofstream(configFolder / "ReloadInner.cfg", std::ios::app) << "CCAM 3\nCLBL Included Camera\n";
+
+	for (int wait = 0; wait < 400 && watcher->GetReloads() < reloads + 2; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	fixture.Frame(0.02);
+	asyncMFD->Update(&fixture.skp);
+
+	if (fixture.mfd->GetCameraData(3).label != "Included Camera")
+		Bench::Fail("the MFD didn't reload its configuration file after the file it includes changed");
+
+	if (asyncMFD->GetCameraData(3).label != "Included Camera")
+		Bench::Fail("the loaded vessel configuration file wasn't parsed again after the file it includes changed");
+
+	delete asyncMFD;
+
+	// A camera deleted from the file, which is the current camera, and a target set in the file
+	Headless::Vessel target{ "ReloadTarget" };
+
+	std::ofstream(configFolder / "ReloadDelete.cfg") << "CDELTA 1\n\nCCAM 0\nCLBL First\n\nCCAM 1\nCLBL Second\n\nCCAM 2\nCLBL Third\n\nCURCAM 2\n";
+	fixture.ReadStatus("CCFG ReloadDelete\nEND_MFD\n");
+
+	reloads = watcher->GetReloads();
+
+	std::ofstream(configFolder / "ReloadDelete.cfg") << "CDELTA 1\n\nCCAM 0\nCLBL First\n\nCCAM 1\nCLBL Second\nCTRACK ReloadTarget\n\nCURCAM 2\n";
+
+	for (int wait = 0; wait < 400 && watcher->GetReloads() == reloads; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	fixture.Frame(0.02);
+	fixture.Frame(0.02);
+
+	if (fixture.mfd->GetCameraCount() != 2 || fixture.mfd->GetCurrentCamera() != 1)
+		Bench::Fail("%d cameras and camera %d current after a camera was deleted from the file, expected 2 and camera 1",
+			fixture.mfd->GetCameraCount(), fixture.mfd->GetCurrentCamera());
+
+	if (fixture.mfd->GetCameraTarget(1) != target.GetHandle())
+		Bench::Fail("the target set in the file wasn't tracked after the reload");
+
+	// The delta scenario is written against the file as it's now, so the deleted camera isn't written back
+	status = writeStatus(fixture.mfd);
+
+	if (status.find("CCAM 2") != std::string::npos || status.find("CDEL") != std::string::npos)
+		Bench::Fail("the camera deleted from the file was written into the delta scenario");
+
+	ConfigWatcher::interval = 1;
+}
+
+BENCHMARK(Config_Async)
+{
+	const int cameraCount = 1000;
+
+	writeConfig("Async", cameraCount);
+
+	Headless::Vessel vessel{ "Async" };
+	Headless::Sketchpad skp;
+
+	// The first update shows the default camera, without reading the file
+	Headless::ResetCounters();
+
+	Camera_MFD *mfd = new Camera_MFD(512, 512, &vessel, 0);
+	mfd->Update(&skp);
+
+	if (Headless::counters.openFile != 0)
+		Bench::Fail("the first update opened %d files", Headless::counters.openFile);
+
+	for (int wait = 0; wait < 2000 && mfd->IsConfigPending(); wait++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		mfd->Update(&skp);
+	}
+
+	if (mfd->IsConfigPending() || mfd->GetCameraCount() != cameraCount)
+		Bench::Fail("%d cameras after loading the configuration file, expected %d", mfd->GetCameraCount(), cameraCount);
+
+	// The same data as a synchronous load
+	std::string status = writeStatus(mfd);
+
+	Headless::Vessel syncVessel{ "Async" };
+	Camera_MFD *syncMFD = new Camera_MFD(512, 512, &syncVessel, 0);
+
+	FILEHANDLE scn = Headless::OpenScenario("CCFG Async\nEND_MFD\n");
+	syncMFD->ReadStatus(scn);
+
+	if (writeStatus(syncMFD) != status)
+		Bench::Fail("the MFD status differs between the asynchronous and the synchronous loads");
+
+	Bench::Time("CCFG load (1000 cameras, cached)", std::min(iterations, 500), [&](int)
+	{
+		Headless::RewindScenario(scn);
+		syncMFD->ReadStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+	delete syncMFD;
+	delete mfd;
+
+	// The file is loaded once, so the MFDs opened later adopt it in their first update
+	Bench::Time("Open and first update (1000 cameras, loaded)", std::min(iterations, 500), [&](int)
+	{
+		mfd = new Camera_MFD(512, 512, &vessel, 0);
+		mfd->Update(&skp);
+
+		if (mfd->IsConfigPending())
+			Bench::Fail("an MFD opened after the file was loaded waits for it");
+
+		delete mfd;
+		opcDeleteVessel(vessel.GetHandle());
+	});
+
+	// A vessel which controls the MFD drops the load
+	Headless::Vessel controlVessel{ "Async", true };
+	mfd = new Camera_MFD(512, 512, &controlVessel, 0);
+
+	for (int frame = 0; frame < 3; frame++)
+		mfd->Update(&skp);
+
+	if (mfd->IsConfigPending() || mfd->GetCameraCount() != 1)
+		Bench::Fail("the MFD controlled by its vessel has %d cameras, expected the default camera", mfd->GetCameraCount());
+
+	delete mfd;
+
+	// The files of the vessels in the scenario are loaded when the render viewport opens
+	writeConfig("Preload", cameraCount);
+
+	Headless::Vessel preloadVessel{ "Preload" };
+	size_t reloads = Camera_MFD::GetConfigWatcher()->GetReloads();
+
+	opcOpenRenderViewport(nullptr, 1280, 720, false);
+
+	for (int wait = 0; wait < 2000 && Camera_MFD::GetConfigWatcher()->GetReloads() == reloads; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	mfd = new Camera_MFD(512, 512, &preloadVessel, 0);
+	mfd->Update(&skp);
+
+	if (mfd->IsConfigPending() || mfd->GetCameraCount() != cameraCount)
+		Bench::Fail("%d cameras in the first update of a preloaded vessel class, expected %d", mfd->GetCameraCount(), cameraCount);
+
+	delete mfd;
+	opcCloseRenderViewport();
+}
@@ -0,0 +1,600 @@
+// =======================================================================================
+// BenchMFD.cpp : Benchmarks of the Camera_MFD entry points.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+#include "../SurfacePool.h"
+
+#include <algorithm>
+#include <memory>
+
+extern MFD_Registry mfdRegistry;
+
+BENCHMARK(MFD_Update)
+{
+	for (int camInfo = 0; camInfo <= 2; camInfo++)
+	{
+		MFDFixture fixture(camInfo);
+
+		size_t formats = OverlayText::formats;
+		Bench::Time(("Update (info mode " + std::to_string(camInfo) + ")").c_str(), iterations, [&](int) { fixture.mfd->Update(&fixture.skp); });
+
+		// The overlay texts are formatted on the first update only, as nothing changes
+		if (OverlayText::formats - formats > 8)
+			Bench::Fail("the overlay was formatted %zu times in info mode %d", OverlayText::formats - formats, camInfo);
+	}
+
+	// A moving camera, so its position text is formatted on every update
+	for (int camInfo : { 0, 2 })
+	{
+		MFDFixture fixture(camInfo);
+
+		size_t formats = OverlayText::formats;
+		Bench::Time(("Update (info mode " + std::to_string(camInfo) + ", camera moving)").c_str(), iterations, [&](int)
+		{
+			fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_A);
+			fixture.mfd->Update(&fixture.skp);
+		});
+
+		printf("Info mode %d: %.2f texts formatted per update\n", camInfo, double(OverlayText::formats - formats) / iterations);
+	}
+}
+
+BENCHMARK(MFD_ConsumeKeyBuffered)
+{
+	MFDFixture fixture;
+
+	const char *modes[] = { "position", "direction", "rotation" };
+
+	for (const char *mode : modes)
+	{
+		Bench::Time((std::string("ConsumeKeyBuffered (") + mode + " A/D)").c_str(), iterations,
+			[&](int iteration) { fixture.mfd->ConsumeKeyBuffered(iteration % 2 ? OAPI_KEY_D : OAPI_KEY_A); });
+
+		if (strcmp(mode, "rotation"))
+			Bench::Time((std::string("ConsumeKeyBuffered (") + mode + " W/S)").c_str(), iterations,
+				[&](int iteration) { fixture.mfd->ConsumeKeyBuffered(iteration % 2 ? OAPI_KEY_S : OAPI_KEY_W); });
+
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_J);
+	}
+
+	Bench::Time("ConsumeKeyBuffered (zoom Z/X)", iterations,
+		[&](int iteration) { fixture.mfd->ConsumeKeyBuffered(iteration % 2 ? OAPI_KEY_X : OAPI_KEY_Z); });
+
+	// Rapid input pushes the camera once per frame
+	Headless::ResetCounters();
+
+	for (int frame = 0; frame < 100; frame++)
+	{
+		Headless::Step(0.02);
+
+		for (DWORD key : { OAPI_KEY_A, OAPI_KEY_W, OAPI_KEY_Z, OAPI_KEY_C, OAPI_KEY_V, OAPI_KEY_Q })
+			fixture.mfd->ConsumeKeyBuffered(key);
+
+		fixture.mfd->Update(&fixture.skp);
+	}
+
+	if (Headless::counters.maxFrameCameraSetups != 1 || Headless::counters.setupCustomCamera != Headless::counters.frames)
+		Bench::Fail("%zu camera setups in %zu frames (at most %zu in a frame), expected one per frame", Headless::counters.setupCustomCamera,
+			Headless::counters.frames, Headless::counters.maxFrameCameraSetups);
+}
+
+BENCHMARK(MFD_SetButtons)
+{
+	MFDFixture fixture;
+
+	// setButtons is private, so it's timed through the page switch which only rebuilds the buttons, committed by the frame update
+	Bench::Time("setButtons (page switch, update)", iterations, [&](int)
+	{
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_P);
+		fixture.mfd->Update(&fixture.skp);
+	});
+
+	// Switching the camera rebuilds the buttons and sets the custom camera
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_P);
+
+	Bench::Time("setButtons (camera switch, update)", iterations, [&](int iteration)
+	{
+		fixture.mfd->ConsumeKeyBuffered(iteration % 2 ? OAPI_KEY_V : OAPI_KEY_C);
+		fixture.mfd->Update(&fixture.skp);
+	});
+}
+
+BENCHMARK(MFD_Status)
+{
+	MFDFixture fixture;
+
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	std::string status = Headless::GetScenario(scn) + "END_MFD\n";
+	Headless::CloseScenario(scn);
+
+	scn = Headless::CreateScenario();
+
+	Bench::Time("WriteStatus", iterations, [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->WriteStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+
+	scn = Headless::OpenScenario(status);
+
+	Bench::Time("ReadStatus", iterations, [&](int)
+	{
+		Headless::RewindScenario(scn);
+		fixture.mfd->ReadStatus(scn);
+	});
+
+	Headless::CloseScenario(scn);
+}
+
+BENCHMARK(MFD_HeldKey)
+{
+	const double holdTime = 2;
+	const int frameRates[] = { 50, 100, 200 };
+
+	const char *modes[] = { "position", "direction" };
+	char kstate[256] = { };
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		double firstResult = 0;
+
+		for (int frameRate : frameRates)
+		{
+			MFDFixture fixture;
+
+			for (int adj = 0; adj < mode; adj++)
+				fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_J);
+
+			fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_R);
+			fixture.mfd->Update(&fixture.skp);
+
+			Headless::ResetCounters();
+			VECTOR3 startPos = Headless::lastCamera.pos, startDir = Headless::lastCamera.dir;
+
+			kstate[OAPI_KEY_A] = char(0x80);
+			// The hold starts at the first frame the key is down
+			int frames = int(holdTime * frameRate) + 1;
+
+			// A frame handles the keys, then updates the MFD
+			Bench::Time((std::string("Held key frame (") + modes[mode] + " A, " + std::to_string(frameRate) + " fps)").c_str(), frames, [&](int)
+			{
+				Headless::Step(1.0 / frameRate);
+				fixture.mfd->ConsumeKeyImmediate(kstate);
+				fixture.mfd->Update(&fixture.skp);
+			});
+
+			kstate[OAPI_KEY_A] = 0;
+			fixture.mfd->ConsumeKeyImmediate(kstate);
+
+			if (Headless::counters.maxFrameCameraSetups > 1)
+				Bench::Fail("%zu camera setups in a frame while holding a key", Headless::counters.maxFrameCameraSetups);
+
+			double result = mode == 0 ? length(Headless::lastCamera.pos - startPos) : acos(min(1.0, dotp(Headless::lastCamera.dir, startDir))) * DEG;
+
+			printf("Held for %g s: moved %.4f %s with %zu camera setups (%.1f per second)\n", holdTime, result, mode == 0 ? "m" : "deg",
+				Headless::counters.setupCustomCamera, Headless::counters.setupCustomCamera / holdTime);
+
+			if (firstResult == 0)
+				firstResult = result;
+
+			else if (fabs(result - firstResult) > 0.01 * firstResult)
+				Bench::Fail("held %s adjustment depends on the frame rate (%g against %g)", modes[mode], result, firstResult);
+		}
+	}
+}
+
+BENCHMARK(MFD_RenderRate)
+{
+	MFDFixture fixture;
+
+	// Runs frames for the passed time, and returns the custom camera render rate
+	auto renderRate = [&](double frameTime, double time)
+	{
+		Headless::ResetCounters();
+
+		for (int frame = 0; frame < int(time / frameTime + 0.5); frame++)
+			fixture.Frame(frameTime);
+
+		return Headless::counters.cameraRenders / time;
+	};
+
+	fixture.ReadStatus("CCAM 0\nCLBL Front\nCRATE 10\n\nCURCAM 0\nEND_MFD\n");
+
+	double rate = renderRate(1.0 / 60, 10);
+	printf("CRATE 10 at 60 fps: %.1f renders per second, %zu camera switches\n", rate, Headless::counters.customCameraOnOff);
+
+	if (fabs(rate - 10) > 0.2)
+		Bench::Fail("the camera rendered %.1f times per second, expected 10", rate);
+
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	if (Headless::GetScenario(scn).find("CRATE 10") == std::string::npos)
+		Bench::Fail("the render rate wasn't saved");
+
+	Headless::CloseScenario(scn);
+
+	Bench::Time("Frame (CRATE 10)", iterations, [&](int) { fixture.Frame(1.0 / 60); });
+
+	fixture.ReadStatus("CCAM 0\nCLBL Front\n\nCURCAM 0\nEND_MFD\n");
+
+	rate = renderRate(1.0 / 60, 10);
+	printf("No rate at 60 fps: %.1f renders per second\n", rate);
+
+	if (fabs(rate - 60) > 0.2)
+		Bench::Fail("the camera without a rate rendered %.1f times per second, expected 60", rate);
+
+	// The rate and scale before the first camera are the defaults of the cameras which don't set them
+	fixture.ReadStatus("CRATE 10\nCSCALE 0.5\n\nCCAM 0\nCLBL Front\n\nCCAM 1\nCLBL Back\nCRATE 30\n\nCURCAM 0\nEND_MFD\n");
+	fixture.mfd->AddCamera(2);
+
+	MFD_Data *data = mfdRegistry.Find(fixture.vessel.GetHandle(), 0);
+
+	rate = renderRate(1.0 / 60, 10);
+	printf("Default CRATE 10 and CSCALE 0.5 at 60 fps: %.1f renders per second, camera rates %g, %g and %g\n",
+		rate, data->camMap.at(0).rate, data->camMap.at(1).rate, data->camMap.at(2).rate);
+
+	if (fabs(rate - 10) > 0.2)
+		Bench::Fail("the camera with the default rate rendered %.1f times per second, expected 10", rate);
+
+	if (data->camMap.at(0).scale != 0.5 || data->camMap.at(2).rate != 10 || data->camMap.at(2).scale != 0.5)
+		Bench::Fail("the cameras didn't take the default rate and scale");
+
+	if (data->camMap.at(1).rate != 30 || data->camMap.at(1).scale != 0.5)
+		Bench::Fail("the camera rate of 30 was replaced by the default");
+
+	scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+	std::string scenario = Headless::GetScenario(scn);
+	Headless::CloseScenario(scn);
+
+	fixture.ReadStatus(scenario + "END_MFD\n");
+
+	if (data->defaultRate != 10 || data->defaultScale != 0.5 || data->camMap.at(0).rate != 10 || data->camMap.at(1).rate != 30)
+		Bench::Fail("the default rate and scale weren't saved");
+
+	// A 10 ms budget, with frames over it then under it
+	fixture.ReadStatus("CBUDGET 10\n\nCCAM 0\nCLBL Front\n\nCURCAM 0\nEND_MFD\n");
+
+	renderRate(0.02, 5);
+	double slowRate = renderRate(0.02, 1);
+
+	renderRate(0.005, 15);
+	double fastRate = renderRate(0.005, 1);
+
+	printf("CBUDGET 10: %.1f renders per second after 6 s at 50 fps, %.1f after 16 s at 200 fps\n", slowRate, fastRate);
+
+	if (slowRate > 5)
+		Bench::Fail("the render rate wasn't scaled down over the frame budget (%.1f renders per second)", slowRate);
+
+	if (fastRate < 150)
+		Bench::Fail("the render rate wasn't scaled up under the frame budget (%.1f renders per second)", fastRate);
+}
+
+BENCHMARK(MFD_RenderScale)
+{
+	MFDFixture fixture;
+
+	// Returns the size of the surface the custom camera renders to
+	auto renderSize = []()
+	{
+		const Headless::Surface *surface = static_cast<const Headless::Surface*>(Headless::lastCamera.hSurf);
+		return std::to_string(surface->width) + "x" + std::to_string(surface->height);
+	};
+
+	fixture.ReadStatus("CCAM 0\nCLBL Front\nCSCALE 0.5\n\nCURCAM 0\nEND_MFD\n");
+	Headless::ResetCounters();
+	fixture.Frame(1.0 / 60);
+
+	printf("CSCALE 0.5 on a 512x512 MFD: %s render target, %zu stretched and %zu copied blits\n",
+		renderSize().c_str(), Headless::counters.stretchRect, Headless::counters.copyRect);
+
+	if (renderSize() != "256x256" || Headless::counters.stretchRect != 1)
+		Bench::Fail("CSCALE 0.5 rendered to a %s surface with %zu stretched blits, expected 256x256 and 1", renderSize().c_str(), Headless::counters.stretchRect);
+
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	if (Headless::GetScenario(scn).find("CSCALE 0.5") == std::string::npos)
+		Bench::Fail("the render scale wasn't saved");
+
+	Headless::CloseScenario(scn);
+
+	Bench::Time("Update (CSCALE 0.5)", iterations, [&](int) { fixture.mfd->Update(&fixture.skp); });
+
+	// The dynamic mode lowers the resolution over the frame budget before the render rate
+	fixture.ReadStatus("CBUDGET 10\nCMINSCALE 0.25\n\nCCAM 0\nCLBL Front\nCSCALE 0.5\n\nCURCAM 0\nEND_MFD\n");
+	Headless::ResetCounters();
+
+	for (int frame = 0; frame < 125; frame++)
+		fixture.Frame(0.02);
+
+	std::string slowSize = renderSize();
+	size_t slowSetups = Headless::counters.setupCustomCamera;
+
+	for (int frame = 0; frame < 4000; frame++)
+		fixture.Frame(0.005);
+
+	std::string fastSize = renderSize();
+
+	printf("CMINSCALE 0.25: %s after 2.5 s at 50 fps (%zu camera setups), %s after 20 s at 200 fps\n", slowSize.c_str(), slowSetups, fastSize.c_str());
+
+	if (slowSize != "64x64")
+		Bench::Fail("the resolution scaled down to %s over the frame budget, expected 64x64", slowSize.c_str());
+
+	if (fastSize != "256x256")
+		Bench::Fail("the resolution scaled up to %s under the frame budget, expected 256x256", fastSize.c_str());
+}
+
+extern SurfacePool surfacePool;
+
+BENCHMARK(MFD_Layouts)
+{
+	MFDFixture fixture;
+
+	std::string scenario;
+
+	for (int cam = 0; cam < 12; cam++)
+		scenario += "CCAM " + std::to_string(cam) + "\nCLBL Camera " + std::to_string(cam) + "\nCPOS 0 0 " + std::to_string(cam) + "\n\n";
+
+	fixture.ReadStatus(scenario + "CURCAM 0\nEND_MFD\n");
+
+	const MFD_Data *data = mfdRegistry.Find(fixture.vessel.GetHandle(), 0);
+	const char *names[] = { "single", "PiP", "2x2", "3x3" };
+	const size_t tileCounts[] = { 1, 2, 4, 9 };
+	const int frames = 60;
+
+	for (int layout = CameraMFD::LAYOUT_SINGLE; layout <= CameraMFD::LAYOUT_3X3; layout++)
+	{
+		fixture.mfd->SetLayout(layout);
+		fixture.Frame(1.0 / 60);
+
+		Headless::ResetCounters();
+
+		// The frames until each tile has rendered once
+		std::vector<int> firstRender(data->tiles.size(), -1);
+
+		for (int frame = 0; frame < frames; frame++)
+		{
+			fixture.Frame(1.0 / 60);
+
+			for (size_t tile = 0; tile < data->tiles.size(); tile++)
+				if (data->tiles[tile].on && firstRender[tile] < 0)
+					firstRender[tile] = frame;
+		}
+
+		int refreshFrames = firstRender.empty() ? 0 : *std::max_element(firstRender.begin(), firstRender.end()) + 1;
+		size_t blits = Headless::counters.copyRect + Headless::counters.stretchRect;
+
+		printf("%s layout: %zu tiles, %.1f renders and %.1f blits per frame, all tiles refreshed in %d frames, %zu camera setups\n", names[layout],
+			data->tiles.size() + 1, double(Headless::counters.cameraRenders) / frames, double(blits) / frames, refreshFrames, Headless::counters.setupCustomCamera);
+
+		if (data->tiles.size() + 1 != tileCounts[layout])
+			Bench::Fail("the %s layout has %zu tiles, expected %zu", names[layout], data->tiles.size() + 1, tileCounts[layout]);
+
+		if (Headless::counters.cameraRenders > frames * 3)
+			Bench::Fail("the %s layout rendered %zu cameras in %d frames, expected at most 3 per frame", names[layout], Headless::counters.cameraRenders, frames);
+
+		if (std::count(firstRender.begin(), firstRender.end(), -1) || refreshFrames > int(data->tiles.size() + 1) / 2)
+			Bench::Fail("the %s layout tiles weren't all refreshed in %zu frames", names[layout], (data->tiles.size() + 1) / 2);
+
+		if (blits != frames * (data->tiles.size() + 1))
+			Bench::Fail("the %s layout blitted %zu views in %d frames, expected %zu per frame", names[layout], blits, frames, data->tiles.size() + 1);
+
+		if (Headless::counters.setupCustomCamera)
+			Bench::Fail("the %s layout set up %zu cameras without changes", names[layout], Headless::counters.setupCustomCamera);
+
+		Bench::Time((std::string("Frame (") + names[layout] + " layout)").c_str(), iterations, [&](int) { fixture.Frame(1.0 / 60); });
+	}
+
+	// The layout page cycles the layouts
+	while (fixture.mfd->GetLayout() != CameraMFD::LAYOUT_SINGLE || std::string(fixture.mfd->ButtonLabel(6)) != "LYT")
+	{
+		// The buttons are updated by the next frame
+		fixture.mfd->ConsumeKeyBuffered(std::string(fixture.mfd->ButtonLabel(6)) == "LYT" ? OAPI_KEY_K : OAPI_KEY_P);
+		fixture.Frame(1.0 / 60);
+	}
+
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_K);
+	fixture.Frame(1.0 / 60);
+
+	if (fixture.mfd->GetLayout() != CameraMFD::LAYOUT_PIP || data->tiles.size() != 1)
+		Bench::Fail("the layout button set layout %d with %zu tiles, expected the PiP layout", fixture.mfd->GetLayout(), data->tiles.size());
+
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	if (Headless::GetScenario(scn).find("CLAYOUT 1") == std::string::npos)
+		Bench::Fail("the layout wasn't saved");
+
+	Headless::CloseScenario(scn);
+}
+
+
+BENCHMARK(MFD_Reopen)
+{
+	SetupOrbiterRoot();
+	Headless::Vessel vessel{ "Deltaglider" };
+	Headless::Sketchpad skp;
+
+	// Reopens the MFD as an MFD mode switch does
+	auto reopen = [&](int) { delete new Camera_MFD(512, 512, &vessel, 0); };
+
+	// Measure the surface pool without parked cameras, which would keep the surface
+	mfdRegistry.SetMaxParked(0);
+
+	for (bool pooled : { false, true })
+	{
+		surfacePool.enabled = pooled;
+		Headless::ResetCounters();
+
+		int reopens = std::min(iterations, 10000);
+		Bench::Time(pooled ? "Camera_MFD reopen (surface pool)" : "Camera_MFD reopen (no pool)", reopens, reopen);
+
+		printf("%zu surfaces created for %d reopens\n", Headless::counters.createSurface, reopens);
+	}
+
+	const SurfacePool::Stats &stats = surfacePool.GetStats();
+	printf("Pool: %zu created, %zu reused, %zu destroyed, %zu in use, %zu idle\n", stats.created, stats.reused, stats.destroyed, stats.inUse, stats.idle);
+
+	if (Headless::counters.createSurface > 1)
+		Bench::Fail("%zu surfaces created by reopening the MFD with the pool, expected at most 1", Headless::counters.createSurface);
+
+	// A resized MFD needs another surface, and the idle ones are destroyed after the timeout
+	delete new Camera_MFD(256, 256, &vessel, 0);
+
+	if (stats.idle != 2)
+		Bench::Fail("%zu idle surfaces after resizing the MFD, expected 2", stats.idle);
+
+	Headless::Step(SurfacePool::idleTimeout + 1);
+	opcPreStep(0, 0, 0);
+
+	if (stats.idle != 0)
+		Bench::Fail("%zu idle surfaces after the idle timeout, expected 0", stats.idle);
+
+	// Reopen an MFD which has rendered, with and without parking its camera
+	for (size_t maxParked : { size_t(0), size_t(4) })
+	{
+		mfdRegistry.SetMaxParked(maxParked);
+
+		Camera_MFD *mfd = new Camera_MFD(512, 512, &vessel, 0);
+		mfd->Update(&skp);
+
+		// The configuration file is adopted before the reopens, so its camera setup isn't counted with them
+		for (int wait = 0; wait < 2000 && mfd->IsConfigPending(); wait++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			mfd->Update(&skp);
+		}
+
+		delete mfd;
+
+		Headless::ResetCounters();
+
+		int reopens = std::min(iterations, 10000);
+		Bench::Time(maxParked ? "Camera_MFD reopen and update (parked camera)" : "Camera_MFD reopen and update (no parking)", reopens, [&](int)
+		{
+			Camera_MFD *mfd = new Camera_MFD(512, 512, &vessel, 0);
+			mfd->Update(&skp);
+			delete mfd;
+		});
+
+		printf("%zu camera setups and %zu deletes for %d reopens\n", Headless::counters.setupCustomCamera, Headless::counters.deleteCustomCamera, reopens);
+
+		if (maxParked && (Headless::counters.setupCustomCamera || Headless::counters.deleteCustomCamera))
+			Bench::Fail("%zu camera setups and %zu deletes by reopening the MFD with a parked camera, expected 0",
+				Headless::counters.setupCustomCamera, Headless::counters.deleteCustomCamera);
+	}
+
+	// A parked camera is switched off, and switched back on by reopening its MFD
+	Headless::ResetCounters();
+	Headless::Step(0.02);
+
+	if (Headless::counters.cameraRenders)
+		Bench::Fail("%zu renders of a parked camera, expected 0", Headless::counters.cameraRenders);
+
+	Camera_MFD *mfd = new Camera_MFD(512, 512, &vessel, 0);
+	Headless::Step(0.02);
+
+	if (Headless::counters.cameraRenders != 1)
+		Bench::Fail("%zu renders after reopening the MFD, expected 1", Headless::counters.cameraRenders);
+
+	delete mfd;
+
+	// Closing the MFDs of more vessels than the cap releases the least recently parked cameras
+	std::vector<std::unique_ptr<Headless::Vessel>> vessels;
+	Headless::ResetCounters();
+
+	for (int i = 0; i < 10; i++)
+	{
+		vessels.push_back(std::make_unique<Headless::Vessel>("Deltaglider"));
+
+		Camera_MFD *mfd = new Camera_MFD(512, 512, vessels.back().get(), 0);
+		mfd->Update(&skp);
+		delete mfd;
+	}
+
+	// The first vessel camera was parked before the others
+	size_t evicted = 11 - mfdRegistry.GetMaxParked();
+
+	if (mfdRegistry.ParkedCount() != mfdRegistry.GetMaxParked() || Headless::counters.deleteCustomCamera != evicted)
+		Bench::Fail("%zu parked cameras and %zu deletes after closing 11 MFDs, expected %zu and %zu",
+			mfdRegistry.ParkedCount(), Headless::counters.deleteCustomCamera, mfdRegistry.GetMaxParked(), evicted);
+
+	// Reads the cap by the CMAXPARK item, and returns the status written back
+	auto readMaxParked = [&](const std::string &value)
+	{
+		Camera_MFD *mfd = new Camera_MFD(512, 512, &vessel, 0);
+
+		FILEHANDLE scn = Headless::OpenScenario("CMAXPARK " + value + "\nEND_MFD\n");
+		mfd->ReadStatus(scn);
+		Headless::CloseScenario(scn);
+
+		scn = Headless::CreateScenario();
+		mfd->WriteStatus(scn);
+
+		std::string status = Headless::GetScenario(scn);
+		Headless::CloseScenario(scn);
+
+		delete mfd;
+		return status;
+	};
+
+	// A cap below and above the default. Lowering the cap releases the parked cameras over it at once.
+	for (size_t maxParked : { size_t(2), size_t(8) })
+	{
+		readMaxParked(std::to_string(maxParked));
+
+		if (mfdRegistry.GetMaxParked() != maxParked || mfdRegistry.ParkedCount() > maxParked)
+			Bench::Fail("%zu parked cameras and a cap of %zu after reading CMAXPARK %zu", mfdRegistry.ParkedCount(), mfdRegistry.GetMaxParked(), maxParked);
+
+		for (auto &parkedVessel : vessels)
+		{
+			Camera_MFD *mfd = new Camera_MFD(512, 512, parkedVessel.get(), 0);
+			mfd->Update(&skp);
+			delete mfd;
+		}
+
+		if (mfdRegistry.ParkedCount() != maxParked)
+			Bench::Fail("%zu parked cameras after closing 10 MFDs with CMAXPARK %zu", mfdRegistry.ParkedCount(), maxParked);
+	}
+
+	// The cap is limited, and a negative cap is ignored
+	std::string status = readMaxParked("1000");
+
+	if (mfdRegistry.GetMaxParked() != MFD_Registry::parkLimit || status.find("CMAXPARK " + std::to_string(MFD_Registry::parkLimit)) == std::string::npos)
+		Bench::Fail("a cap of %zu after reading CMAXPARK 1000, expected %zu", mfdRegistry.GetMaxParked(), MFD_Registry::parkLimit);
+
+	status = readMaxParked("-1");
+
+	if (mfdRegistry.GetMaxParked() != MFD_Registry::parkLimit || status.find("CMAXPARK") != std::string::npos)
+		Bench::Fail("a cap of %zu after reading CMAXPARK -1, expected it unchanged", mfdRegistry.GetMaxParked());
+
+	opcCloseRenderViewport();
+
+	if (mfdRegistry.GetMaxParked() != MFD_Registry::defaultMaxParked)
+		Bench::Fail("a cap of %zu after closing the render viewport, expected the default", mfdRegistry.GetMaxParked());
+}
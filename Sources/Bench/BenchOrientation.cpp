@@ -0,0 +1,199 @@
+// =======================================================================================
+// BenchOrientation.cpp : Benchmarks of the quaternion camera orientation against the matrix one.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "../Orientation.h"
+
+#include <random>
+
+// The matrix orientation the MFD used before the quaternion one
+namespace MatrixPath
+{
+	MATRIX3 yaw(double angle) { double s = sin(angle), c = cos(angle); return { c, 0, -s, 0, 1, 0, s, 0, c }; }
+	MATRIX3 pitch(double angle) { double s = sin(angle), c = cos(angle); return { 1, 0, 0, 0, c, s, 0, -s, c }; }
+	MATRIX3 roll(double angle) { double s = sin(angle), c = cos(angle); return { c, -s, 0, s, c, 0, 0, 0, 1 }; }
+
+	void leveledYaw(MATRIX3 &dir, double angle, double pitchAngle)
+	{
+		dir = mul(dir, pitch(-pitchAngle));
+		dir = mul(dir, yaw(angle));
+		dir = mul(dir, pitch(pitchAngle));
+	}
+
+	void setCamData(MATRIX3 &dir, double pitchAngle, double yawAngle, double rotAngle)
+	{
+		dir = mul(dir, yaw(yawAngle));
+		dir = mul(dir, pitch(pitchAngle));
+		dir = mul(dir, roll(rotAngle));
+	}
+}
+
+const double step = 0.5 * RAD;
+
+static double orthonormalError(const MATRIX3 &m)
+{
+	MATRIX3 mtm = mul(MATRIX3{ m.m11, m.m21, m.m31, m.m12, m.m22, m.m32, m.m13, m.m23, m.m33 }, m);
+	double error = 0;
+
+	for (int i = 0; i < 9; i++)
+		error = std::max(error, fabs(mtm.data[i] - (i % 4 == 0 ? 1 : 0)));
+
+	return error;
+}
+
+static double matrixDifference(const MATRIX3 &a, const MATRIX3 &b)
+{
+	double error = 0;
+
+	for (int i = 0; i < 9; i++)
+		error = std::max(error, fabs(a.data[i] - b.data[i]));
+
+	return error;
+}
+
+BENCHMARK(Orientation_Steps)
+{
+	MATRIX3 mat = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+	Quaternion quat = identityQuaternion;
+
+	double pitch = 10 * RAD;
+	double halfCos = cos(step / 2), halfSin = sin(step / 2);
+	Quaternion stepUp = pitchRotation(step);
+
+	Bench::Time("Yaw step (matrix)", iterations, 100, [&](int) { MatrixPath::leveledYaw(mat, step, pitch); Bench::Keep(mat); });
+	Bench::Time("Yaw step (quaternion)", iterations, 100, [&](int) { quat = quat * leveledYawRotation(halfCos, halfSin, pitch); renormalise(quat); Bench::Keep(quat); });
+
+	Bench::Time("Pitch step (matrix)", iterations, 100, [&](int) { mat = mul(mat, MatrixPath::pitch(step)); Bench::Keep(mat); });
+	Bench::Time("Pitch step (quaternion)", iterations, 100, [&](int) { quat = quat * stepUp; renormalise(quat); Bench::Keep(quat); });
+
+	Bench::Time("setCamData (matrix)", iterations, 100, [&](int iteration)
+	{
+		mat = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+		MatrixPath::setCamData(mat, iteration * 0.1, iteration * 0.2, iteration * 0.3);
+		Bench::Keep(mat);
+	});
+
+	Bench::Time("setCamData (quaternion)", iterations, 100, [&](int iteration)
+	{
+		quat = identityQuaternion * yawRotation(iteration * 0.2) * pitchRotation(iteration * 0.1) * rollRotation(iteration * 0.3);
+		renormalise(quat);
+		Bench::Keep(quat);
+	});
+
+	Bench::Time("Camera vectors (matrix)", iterations, 100, [&](int)
+	{
+		Bench::Keep(mat);
+
+		VECTOR3 dir = mul(mat, _V(0, 0, 1)); normalise(dir);
+		VECTOR3 rot = mul(mat, _V(0, 1, 0)); normalise(rot);
+		Bench::Keep(dir);
+		Bench::Keep(rot);
+	});
+
+	Bench::Time("Camera vectors (quaternion)", iterations, 100, [&](int)
+	{
+		Bench::Keep(quat);
+
+		MATRIX3 m = toMatrix(quat);
+		VECTOR3 dir = _V(m.m13, m.m23, m.m33);
+		VECTOR3 rot = _V(m.m12, m.m22, m.m32);
+
+		Bench::Keep(dir);
+		Bench::Keep(rot);
+	});
+}
+
+BENCHMARK(Orientation_Drift)
+{
+	const int adjustments = 1000000;
+
+	std::mt19937 random(1357);
+	double halfCos = cos(step / 2), halfSin = sin(step / 2);
+
+	// Yaw and pitch only, so the expected orientation can be rebuilt from the accumulated angles
+	{
+		MATRIX3 mat = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+		Quaternion quat = identityQuaternion;
+		double pitch = 0, yaw = 0;
+
+		for (int adjustment = 0; adjustment < adjustments; adjustment++)
+		{
+			switch (random() % 4)
+			{
+			case 0: MatrixPath::leveledYaw(mat, step, pitch); quat = quat * leveledYawRotation(halfCos, halfSin, pitch); yaw += step; break;
+			case 1: MatrixPath::leveledYaw(mat, -step, pitch); quat = quat * leveledYawRotation(halfCos, -halfSin, pitch); yaw -= step; break;
+			case 2: mat = mul(mat, MatrixPath::pitch(step)); quat = quat * pitchRotation(step); pitch += step; break;
+			case 3: mat = mul(mat, MatrixPath::pitch(-step)); quat = quat * pitchRotation(-step); pitch -= step; break;
+			}
+
+			renormalise(quat);
+		}
+
+		MATRIX3 expected = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+		MatrixPath::setCamData(expected, pitch, yaw, 0);
+
+		double matrixError = matrixDifference(mat, expected);
+		double quatError = matrixDifference(toMatrix(quat), expected);
+
+		printf("Yaw/pitch drift after %d adjustments: matrix %.3e, quaternion %.3e\n", adjustments, matrixError, quatError);
+
+		if (quatError > 1e-9)
+			Bench::Fail("quaternion yaw/pitch drift %.3e", quatError);
+	}
+
+	// All the adjustments, checking the orientation stays a rotation and both paths agree
+	{
+		MATRIX3 mat = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+		Quaternion quat = identityQuaternion;
+		double pitch = 0;
+		double maxDifference = 0;
+
+		for (int adjustment = 0; adjustment < adjustments; adjustment++)
+		{
+			switch (random() % 6)
+			{
+			case 0: MatrixPath::leveledYaw(mat, step, pitch); quat = quat * leveledYawRotation(halfCos, halfSin, pitch); break;
+			case 1: MatrixPath::leveledYaw(mat, -step, pitch); quat = quat * leveledYawRotation(halfCos, -halfSin, pitch); break;
+			case 2: mat = mul(mat, MatrixPath::pitch(step)); quat = quat * pitchRotation(step); pitch += step; break;
+			case 3: mat = mul(mat, MatrixPath::pitch(-step)); quat = quat * pitchRotation(-step); pitch -= step; break;
+			case 4: mat = mul(mat, MatrixPath::roll(step)); quat = quat * rollRotation(step); break;
+			case 5: mat = mul(mat, MatrixPath::roll(-step)); quat = quat * rollRotation(-step); break;
+			}
+
+			renormalise(quat);
+
+			if (adjustment < 1000)
+				maxDifference = std::max(maxDifference, matrixDifference(mat, toMatrix(quat)));
+		}
+
+		double quatNorm = sqrt(quat.w * quat.w + quat.x * quat.x + quat.y * quat.y + quat.z * quat.z);
+
+		printf("Orthonormality error after %d adjustments: matrix %.3e, quaternion %.3e (norm error %.3e)\n", adjustments,
+			orthonormalError(mat), orthonormalError(toMatrix(quat)), fabs(quatNorm - 1));
+		printf("Matrix/quaternion difference over the first 1000 adjustments: %.3e\n", maxDifference);
+
+		if (maxDifference > 1e-9)
+			Bench::Fail("quaternion path differs from the matrix path by %.3e", maxDifference);
+
+		if (orthonormalError(toMatrix(quat)) > 1e-12)
+			Bench::Fail("quaternion orientation isn't orthonormal (%.3e)", orthonormalError(toMatrix(quat)));
+	}
+}
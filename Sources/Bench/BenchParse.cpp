@@ -0,0 +1,322 @@
+// =======================================================================================
+// BenchParse.cpp : Benchmarks and fuzzes the scenario and configuration file parsing.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+#include "../ScenarioTokenizer.h"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+// The reads ReadStatus does after the tag of a line
+enum ReadPattern
+{
+	READ_INT,     // CADJ, CPG, CINF, CCAM, CURCAM
+	READ_DOUBLE,  // CPIT, CYAW, CROT, CUPIT, CUYAW, CUROT, CFOV, CUFOV
+	READ_VECTOR,  // CPOS, CUPOS
+	READ_REST     // CCFG, CLBL
+};
+
+// The results of reading a line by a pattern
+struct LineRead
+{
+	std::string tag;
+	bool failed;
+	int intValue = 12345;
+	double values[3] = { 1.5, 2.5, 3.5 };
+	std::string rest;
+
+	bool operator==(const LineRead &other) const
+	{
+		return tag == other.tag && failed == other.failed && intValue == other.intValue &&
+		       !memcmp(values, other.values, sizeof(values)) && rest == other.rest;
+	}
+};
+
+// Reads a line as the std::istringstream ReadStatus did
+static LineRead streamRead(const std::string &line, ReadPattern pattern)
+{
+	LineRead read;
+	std::istringstream ss(line);
+
+	ss >> read.tag;
+
+	switch (pattern)
+	{
+	case READ_INT:
+		ss >> read.intValue;
+		break;
+
+	case READ_DOUBLE:
+		ss >> read.values[0];
+		break;
+
+	case READ_VECTOR:
+		ss >> read.values[0]; ss >> read.values[1]; ss >> read.values[2];
+		break;
+
+	case READ_REST:
+		// A failed std::getline kept the previous text, so a bare label item is read as empty
+		if (std::getline(ss, read.rest))
+			read.rest.erase(0, 1);
+		break;
+	}
+
+	read.failed = ss.fail();
+
+	return read;
+}
+
+static LineRead tokenizerRead(const std::string &line, ReadPattern pattern)
+{
+	LineRead read;
+	ScenarioTokenizer tokens(line);
+
+	read.tag = tokens.Next();
+
+	switch (pattern)
+	{
+	case READ_INT:
+		tokens.Read(read.intValue);
+		break;
+
+	case READ_DOUBLE:
+		tokens.Read(read.values[0]);
+		break;
+
+	case READ_VECTOR:
+		tokens.Read(read.values[0]); tokens.Read(read.values[1]); tokens.Read(read.values[2]);
+		break;
+
+	case READ_REST:
+		read.rest = tokens.Rest();
+		break;
+	}
+
+	read.failed = tokens.Failed();
+
+	return read;
+}
+
+// Returns the lines of Deltaglider.cfg and the number formats which the stream parsing accepts or rejects
+static std::vector<std::string> seedCorpus()
+{
+	std::vector<std::string> corpus;
+
+	std::ifstream file(std::string(CAMERAMFD_CONFIG_DIR) + "/CameraMFD/Deltaglider.cfg");
+	std::string line;
+
+	while (std::getline(file, line))
+		if (!line.empty())
+			corpus.push_back(line);
+
+	if (corpus.empty())
+		Bench::Fail("Deltaglider.cfg wasn't found for the fuzz corpus");
+
+	for (const char *number : { "0", "-0", "+7", "007", "-12.5", "+.5", "5.", ".", "-", "+", "+-1", "1e3", "1E-3", "2.5e+2", "1e",
+	                            "1e+", "1.2.3", "1e5.3", ".e5", "0x1A", "inf", "nan", "1,5", "2147483647", "2147483648", "-2147483649",
+	                            "1e400", "-1e400", "1e-400", "99999999999999999999", "3.14abc", "\t42\t", "12 34 56", "" })
+	{
+		for (const char *tag : { "CADJ ", "CPOS ", "CPOS 1 ", "CPOS 1 2 ", "CFOV\t", "CLBL " })
+			corpus.push_back(tag + std::string(number));
+	}
+
+	return corpus;
+}
+
+// Mutates a line by replacing, inserting, deleting or duplicating characters, or truncating it
+static std::string mutate(std::string line, std::mt19937 &random)
+{
+	static const char alphabet[] = " \t\v+-.eE0123456789xaC";
+	std::uniform_int_distribution<int> charDist(0, int(sizeof(alphabet)) - 2);
+
+	int mutations = 1 + random() % 3;
+
+	for (int mutation = 0; mutation < mutations; mutation++)
+	{
+		size_t index = line.empty() ? 0 : random() % (line.size() + 1);
+		char c = alphabet[charDist(random)];
+
+		switch (random() % 5)
+		{
+		case 0:
+			if (index < line.size())
+				line[index] = c;
+			break;
+
+		case 1:
+			line.insert(index, 1, c);
+			break;
+
+		case 2:
+			if (index < line.size())
+				line.erase(index, 1);
+			break;
+
+		case 3:
+			line.insert(index, line.substr(index, random() % 4));
+			break;
+
+		case 4:
+			line.resize(index);
+			break;
+		}
+	}
+
+	return line;
+}
+
+BENCHMARK(Parse_Fuzz)
+{
+	std::vector<std::string> corpus = seedCorpus();
+	std::mt19937 random(2020);
+
+	int lineCount = std::max(iterations, 10000);
+	int mismatches = 0;
+
+	for (int lineIndex = 0; lineIndex < lineCount; lineIndex++)
+	{
+		const std::string &seed = corpus[lineIndex % corpus.size()];
+		std::string line = lineIndex < int(corpus.size()) ? seed : mutate(seed, random);
+
+		for (ReadPattern pattern : { READ_INT, READ_DOUBLE, READ_VECTOR, READ_REST })
+		{
+			if (streamRead(line, pattern) == tokenizerRead(line, pattern))
+				continue;
+
+			if (++mismatches <= 10)
+				Bench::Fail("The tokenizer read \"%s\" (pattern %d) unlike the stream parsing", line.c_str(), int(pattern));
+		}
+	}
+
+	printf("%d lines fuzzed, %d mismatches\n", lineCount, mismatches);
+
+	// Whole mutated files shouldn't break the MFD
+	Headless::Vessel vessel{ "Fuzz" };
+	Camera_MFD *mfd = new Camera_MFD(512, 512, &vessel, 0);
+
+	for (int fileIndex = 0; fileIndex < 500; fileIndex++)
+	{
+		std::string text;
+
+		for (const std::string &line : corpus)
+			text += (random() % 4 ? line : mutate(line, random)) + "\n";
+
+		FILEHANDLE scn = Headless::OpenScenario(text);
+		mfd->ReadStatus(scn);
+		Headless::CloseScenario(scn);
+
+		// Drawing the MFD uses the current camera and the buttons
+		Headless::Sketchpad skp;
+		mfd->Update(&skp);
+
+		for (int button = 0; button < 12; button++)
+			Bench::Keep(mfd->ButtonLabel(button));
+	}
+
+	delete mfd;
+	opcCloseRenderViewport();
+}
+
+BENCHMARK(Parse_Throughput)
+{
+	// A scenario with 10000 cameras, with labels short enough to be stored without allocating
+	const int cameraCount = 10000;
+	std::string text = "CADJ 1\nCPG 0\nCINF 2\n\n";
+
+	for (int cam = 0; cam < cameraCount; cam++)
+	{
+		char camera[512];
+		sprintf(camera, "CCAM %d\nCLBL Camera %d\nCPOS %.2f 1.25 -3.50\nCUPOS 0.00 0.00 0.00\nCUPIT 0.00\nCUYAW 0.00\nCUROT %.2f\nCFOV 40.00\n\n",
+			cam, cam, cam * 0.01, cam % 90 + 0.5);
+		text += camera;
+	}
+
+	text += "CURCAM 0\nEND_MFD\n";
+
+	std::vector<std::string> lines;
+	std::istringstream textStream(text);
+
+	for (std::string line; std::getline(textStream, line); )
+		lines.push_back(line);
+
+	double megabytes = text.size() / 1e6;
+	int passCount = std::max(1, std::min(iterations / 1000, 100));
+
+	auto printRate = [megabytes](const char *name, double seconds) { printf("%-40s %9.1f MB/s\n", name, megabytes / seconds); };
+
+	// The line reading alone, by the stream parsing and by the tokenizer
+	for (bool tokenizer : { false, true })
+	{
+		auto start = Bench::Clock::now();
+
+		for (int pass = 0; pass < passCount; pass++)
+		{
+			for (const std::string &line : lines)
+			{
+				ReadPattern pattern = line.compare(0, 4, "CPOS") && line.compare(0, 5, "CUPOS") ? line.compare(0, 4, "CLBL") ? READ_DOUBLE : READ_REST : READ_VECTOR;
+				Bench::Keep(tokenizer ? tokenizerRead(line, pattern).values[0] : streamRead(line, pattern).values[0]);
+			}
+		}
+
+		std::chrono::duration<double> time = Bench::Clock::now() - start;
+		printRate(tokenizer ? "Tokenizer line reads" : "Stream line reads", time.count() / passCount);
+	}
+
+	// ReadStatus as a whole
+	Headless::Vessel vessel{ "Parse" };
+	Camera_MFD *mfd = new Camera_MFD(512, 512, &vessel, 0);
+
+	FILEHANDLE scn = Headless::OpenScenario(text);
+	mfd->ReadStatus(scn);
+
+	auto start = Bench::Clock::now();
+
+	Bench::Time("ReadStatus (10000 cameras)", passCount, [&](int)
+	{
+		Headless::RewindScenario(scn);
+		mfd->ReadStatus(scn);
+	});
+
+	std::chrono::duration<double> time = Bench::Clock::now() - start;
+	printRate("ReadStatus", time.count() / passCount);
+
+	// Reading the scenario again shouldn't allocate, as the cameras fit in the allocated storage
+	uint64_t allocations = Bench::Allocations();
+
+	Headless::RewindScenario(scn);
+	mfd->ReadStatus(scn);
+
+	allocations = Bench::Allocations() - allocations;
+
+	if (allocations != 0)
+		Bench::Fail("ReadStatus made %llu allocations for %zu lines", (unsigned long long)allocations, lines.size());
+
+	if (mfd->GetCameraCount() != cameraCount)
+		Bench::Fail("ReadStatus read %d cameras, expected %d", mfd->GetCameraCount(), cameraCount);
+
+	Headless::CloseScenario(scn);
+
+	delete mfd;
+	opcCloseRenderViewport();
+}
@@ -0,0 +1,269 @@
+// =======================================================================================
+// BenchPath.cpp : Camera path benchmarks.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+#include "../CameraPath.h"
+
+#include <algorithm>
+#include <random>
+
+// Makes a path through the passed keys count, unevenly spaced, along a smooth sweep
+static std::vector<CameraMFD::CameraKey> makeKeys(int keyCount)
+{
+	std::vector<CameraMFD::CameraKey> keys;
+	keys.reserve(keyCount);
+
+	double time = 0;
+
+	for (int key = 0; key < keyCount; key++)
+	{
+		double phase = key * 0.05;
+
+		keys.push_back({ time, _V(10 * cos(phase), 2 * sin(phase * 0.5), 10 * sin(phase)), 10 * sin(phase), phase * 20, 5 * cos(phase), 40 + 10 * sin(phase * 0.3) });
+		time += 0.1 + 0.05 * (key % 3);
+	}
+
+	return keys;
+}
+
+static double keyDifference(const CameraMFD::CameraKey &first, const CameraMFD::CameraKey &second)
+{
+	double values[] = { first.pos.x - second.pos.x, first.pos.y - second.pos.y, first.pos.z - second.pos.z, first.pitchAngle - second.pitchAngle,
+		first.yawAngle - second.yawAngle, first.rotAngle - second.rotAngle, first.fov - second.fov };
+
+	double difference = 0;
+
+	for (double value : values)
+		difference = std::max(difference, fabs(value));
+
+	return difference;
+}
+
+BENCHMARK(Path_Evaluate)
+{
+	const int keyCount = 10000;
+	std::vector<CameraMFD::CameraKey> keys = makeKeys(keyCount);
+
+	// Set the keys shuffled, they should be sorted by time
+	std::vector<CameraMFD::CameraKey> shuffled = keys;
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(5));
+
+	CameraPath path;
+	Bench::Time("SetKeys (10000 shuffled keys)", std::max(1, iterations / 1000), [&](int) { path.SetKeys(shuffled.data(), shuffled.size()); });
+
+	if (path.GetKeyCount() != size_t(keyCount) || path.GetDuration() != keys.back().time)
+		Bench::Fail("the path has %zu keys over %g seconds, expected %d over %g", path.GetKeyCount(), path.GetDuration(), keyCount, keys.back().time);
+
+	// The path passes through its keys. A looped path is back at its first key at the last key time.
+	double keyError = 0;
+
+	for (int key = 0; key < keyCount - 1; key++)
+		keyError = std::max(keyError, keyDifference(path.Evaluate(keys[key].time), keys[key]));
+
+	keyError = std::max(keyError, keyDifference(path.Evaluate(keys.back().time), keys.front()));
+
+	if (keyError > 1e-9)
+		Bench::Fail("the path is off its keys by up to %g", keyError);
+
+	// Small steps along the path make small changes, so it's continuous
+	const double dt = 1.0 / 60;
+	double maxChange = 0;
+	CameraMFD::CameraKey prev = path.Evaluate(0);
+
+	for (double time = dt; time < path.GetDuration(); time += dt)
+	{
+		CameraMFD::CameraKey key = path.Evaluate(time);
+		maxChange = std::max(maxChange, keyDifference(key, prev));
+		prev = key;
+	}
+
+	printf("Largest change between frames: %g\n", maxChange);
+
+	if (maxChange > 1)
+		Bench::Fail("the path jumps by %g between frames", maxChange);
+
+	// A looped path wraps to its start, a path which doesn't loop stops at its last key
+	double duration = path.GetDuration();
+
+	if (keyDifference(path.Evaluate(duration + 0.5), path.Evaluate(0.5)) > 1e-9)
+		Bench::Fail("the looped path doesn't wrap to its start");
+
+	path.SetLoop(false);
+
+	if (keyDifference(path.Evaluate(duration + 0.5), keys.back()) > 1e-9)
+		Bench::Fail("the path doesn't stop at its last key");
+
+	path.SetLoop(true);
+
+	// The angles turn the shortest way between the keys, across 0 both ways
+	const CameraMFD::CameraKey turnKeys[] = { { 0, _V(0, 0, 0), 350, 10, -170, 40 }, { 1, _V(0, 0, 0), 10, 350, 170, 40 } };
+	CameraPath turnPath;
+
+	for (int set = 0; set < 2; set++)
+	{
+		if (set == 0)
+			turnPath.SetKeys(turnKeys, 2);
+		else
+		{
+			turnPath.Clear();
+			turnPath.AddKey(turnKeys[1]);
+			turnPath.AddKey(turnKeys[0]);
+		}
+
+		turnPath.SetLoop(false);
+		CameraMFD::CameraKey middle = turnPath.Evaluate(0.5);
+
+		// The middle angles, as the turns from the first key angles
+		double turns[] = { std::remainder(middle.pitchAngle - 350, 360.0), std::remainder(middle.yawAngle - 10, 360.0), std::remainder(middle.rotAngle + 170, 360.0) };
+		const double expected[] = { 10, -10, -10 };
+
+		for (int angle = 0; angle < 3; angle++)
+			if (fabs(turns[angle] - expected[angle]) > 1e-9)
+				Bench::Fail("the path turned %g degrees to the middle of a 20 degree turn (%s)", turns[angle], set == 0 ? "SetKeys" : "AddKey");
+	}
+
+	// Frames along the path move the cursor by a segment at most, and evaluate without allocating
+	uint64_t allocations = Bench::Allocations();
+
+	for (double time = 0; time < 2 * duration; time += dt)
+		Bench::Keep(path.Evaluate(time));
+
+	if (Bench::Allocations() != allocations)
+		Bench::Fail("the path evaluation allocated %llu times", (unsigned long long)(Bench::Allocations() - allocations));
+
+	double time = 0;
+
+	Bench::Time("Evaluate (10000 keys, frames along the path)", iterations, 100, [&](int)
+	{
+		time += dt;
+		Bench::Keep(path.Evaluate(time));
+	});
+
+	// Random times search the segment
+	std::mt19937 random(7);
+	std::uniform_real_distribution<double> times(0, duration);
+
+	Bench::Time("Evaluate (10000 keys, random times)", iterations, 100, [&](int)
+	{
+		Bench::Keep(path.Evaluate(times(random)));
+	});
+}
+
+BENCHMARK(Path_MFD)
+{
+	MFDFixture fixture;
+
+	const int keyCount = 10000;
+	std::vector<CameraMFD::CameraKey> keys = makeKeys(keyCount);
+
+	int cam = fixture.mfd->GetCurrentCamera();
+	const double dt = 1.0 / 60;
+
+	// The way before paths: setting the camera data every frame
+	CameraMFD::CameraData camData = fixture.mfd->GetCameraData(cam);
+
+	Bench::Time("Frame (SetCameraData every frame)", iterations, [&](int iteration)
+	{
+		camData.pos = keys[iteration % keyCount].pos;
+		fixture.mfd->SetCameraData(cam, camData);
+		fixture.Frame(dt);
+	});
+
+	if (!fixture.mfd->SetCameraPath(cam, keys.data(), keyCount, true))
+	{
+		Bench::Fail("the camera path wasn't set");
+		return;
+	}
+
+	// Sample the path as the MFD does, to check the camera follows it
+	CameraPath path;
+	path.SetKeys(keys.data(), keys.size());
+
+	Headless::ResetCounters();
+
+	Bench::Time("Frame (10000 key path)", iterations, [&](int) { fixture.Frame(dt); });
+
+	if (Headless::counters.invalidateButtons != 0)
+		Bench::Fail("the path updated the buttons %zu times", Headless::counters.invalidateButtons);
+
+	if (Headless::counters.setupCustomCamera < size_t(iterations))
+		Bench::Fail("the camera was set up %zu times in %d frames with a path", Headless::counters.setupCustomCamera, iterations);
+
+	CameraMFD::CameraKey expected = path.Evaluate(iterations * dt);
+	camData = fixture.mfd->GetCameraData(cam);
+
+	double error = keyDifference({ 0, camData.pos, camData.pitchAngle, camData.yawAngle, camData.rotAngle, camData.fov }, expected);
+
+	if (error > 1e-6)
+		Bench::Fail("the camera is off its path by %g", error);
+
+	// The path is written into the scenario and read back, when the camera data is from a configuration file
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	std::string status = Headless::GetScenario(scn);
+	Headless::CloseScenario(scn);
+
+	size_t keyLines = 0;
+
+	for (size_t pos = status.find("CKEY"); pos != std::string::npos; pos = status.find("CKEY", pos + 1))
+		keyLines++;
+
+	if (keyLines != size_t(keyCount))
+		Bench::Fail("%zu path keys were written, expected %d", keyLines, keyCount);
+
+	fixture.ReadStatus(status);
+	fixture.mfd->RestartCameraPath(cam);
+	fixture.Frame(0);
+
+	camData = fixture.mfd->GetCameraData(cam);
+	error = keyDifference({ 0, camData.pos, camData.pitchAngle, camData.yawAngle, camData.rotAngle, camData.fov }, keys.front());
+
+	// The keys are written with 6 significant digits
+	if (error > 1e-3)
+		Bench::Fail("the path read back starts off its first key by %g", error);
+
+	// Holding a key while the camera follows its path moves it with a single camera setup per frame
+	char kstate[256] = { };
+	kstate[OAPI_KEY_A] = char(0x80);
+
+	Headless::ResetCounters();
+
+	for (int frame = 0; frame < 120; frame++)
+		fixture.Frame(dt, kstate);
+
+	kstate[OAPI_KEY_A] = 0;
+	fixture.mfd->ConsumeKeyImmediate(kstate);
+
+	if (Headless::counters.maxFrameCameraSetups != 1)
+		Bench::Fail("%zu camera setups in a frame while holding a key on a path", Headless::counters.maxFrameCameraSetups);
+
+	if (Headless::counters.setupCustomCamera != Headless::counters.frames)
+		Bench::Fail("the camera was set up %zu times in %zu frames while holding a key on a path", Headless::counters.setupCustomCamera, Headless::counters.frames);
+
+	// Removing the path keeps the camera where it is
+	fixture.mfd->SetCameraPath(cam, nullptr, 0, true);
+	fixture.Frame(dt);
+
+	if (fixture.mfd->RestartCameraPath(cam))
+		Bench::Fail("a camera with no path was restarted");
+}
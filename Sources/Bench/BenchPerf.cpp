@@ -0,0 +1,187 @@
+// =======================================================================================
+// BenchPerf.cpp : Performance counters benchmarks.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+
+#include <fstream>
+
+DLLCLBK void opcDeleteVessel(OBJHANDLE hVessel);
+
+extern MFD_Registry mfdRegistry;
+
+// Counts the lines of a file which contain the passed text
+static size_t countLines(const std::string &path, const std::string &text)
+{
+	std::ifstream file(path);
+	std::string line;
+	size_t count = 0;
+
+	while (std::getline(file, line))
+		if (line.find(text) != std::string::npos)
+			count++;
+
+	return count;
+}
+
+BENCHMARK(Perf_Counters)
+{
+	MFDFixture fixture;
+	OBJHANDLE hVessel = fixture.vessel.GetHandle();
+	const double dt = 1.0 / 60;
+
+	if (mfdRegistry.GetCounters(hVessel).configReads == 0)
+		Bench::Fail("the configuration file read wasn't counted");
+
+	// The counters match the calls seen by the stand-in
+	PerfCounters before = mfdRegistry.GetCounters(hVessel);
+	Headless::ResetCounters();
+
+	Bench::Time("Frame", iterations, [&](int) { fixture.Frame(dt); });
+
+	PerfCounters after = mfdRegistry.GetCounters(hVessel);
+
+	if (after.updates - before.updates != size_t(iterations))
+		Bench::Fail("%zu updates were counted in %d frames", after.updates - before.updates, iterations);
+
+	if (after.blits - before.blits != Headless::counters.copyRect + Headless::counters.stretchRect)
+		Bench::Fail("%zu blits were counted, the sketchpad had %zu", after.blits - before.blits, Headless::counters.copyRect + Headless::counters.stretchRect);
+
+	if (after.cameraSetups - before.cameraSetups != Headless::counters.setupCustomCamera)
+		Bench::Fail("%zu camera setups were counted, the client had %zu", after.cameraSetups - before.cameraSetups, Headless::counters.setupCustomCamera);
+
+	if (after.buttonRebuilds - before.buttonRebuilds != Headless::counters.invalidateButtons)
+		Bench::Fail("%zu button rebuilds were counted, the buttons were updated %zu times", after.buttonRebuilds - before.buttonRebuilds, Headless::counters.invalidateButtons);
+
+	if (!(after.updateTime > before.updateTime) || after.maxUpdateTime <= 0)
+		Bench::Fail("the update time wasn't counted");
+
+	before = after;
+
+	for (int call = 0; call < 10; call++)
+		fixture.mfd->GetCameraCount();
+
+	if (mfdRegistry.GetCounters(hVessel).apiCalls - before.apiCalls != 10)
+		Bench::Fail("%zu API calls were counted, expected 10", mfdRegistry.GetCounters(hVessel).apiCalls - before.apiCalls);
+
+	// The keys which add and delete cameras aren't API calls, and an API call which adds a camera with its data is one call
+	before = mfdRegistry.GetCounters(hVessel);
+
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_G);
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_H);
+	fixture.mfd->AddCamera(100, fixture.mfd->GetCameraData(fixture.mfd->GetCurrentCamera()));
+	fixture.mfd->DeleteCamera(100);
+
+	if (mfdRegistry.GetCounters(hVessel).apiCalls - before.apiCalls != 4)
+		Bench::Fail("%zu API calls were counted for the camera keys and 4 API calls", mfdRegistry.GetCounters(hVessel).apiCalls - before.apiCalls);
+
+	// The diagnostics page
+	while (std::string(fixture.mfd->ButtonLabel(6)) != "LOG")
+	{
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_P);
+		fixture.Frame(dt);
+	}
+
+	size_t formats = OverlayText::formats;
+
+	Bench::Time("Frame (diagnostics page)", iterations, [&](int) { fixture.Frame(dt); });
+
+	// The texts are formatted at the diagnostics interval, not on every frame
+	double seconds = iterations * dt;
+	size_t maxFormats = size_t((seconds / 0.5 + 2) * 9);
+
+	if (OverlayText::formats - formats > maxFormats)
+		Bench::Fail("the diagnostics were formatted %zu times in %g seconds", OverlayText::formats - formats, seconds);
+
+	// The counters of a deleted vessel stay in the module totals
+	{
+		Headless::Vessel other{ "ShuttleA" };
+		Camera_MFD *mfd = new Camera_MFD(256, 256, &other, 1);
+
+		for (int frame = 0; frame < 10; frame++)
+			mfd->Update(&fixture.skp);
+
+		delete mfd;
+
+		size_t updates = mfdRegistry.GetTotals().updates;
+		opcDeleteVessel(other.GetHandle());
+
+		if (mfdRegistry.GetTotals().updates != updates)
+			Bench::Fail("the module updates went from %zu to %zu when a vessel was deleted", updates, mfdRegistry.GetTotals().updates);
+	}
+
+	// The log, started from the diagnostics page, writes a row per MFD and the module totals per sample
+	const std::string logPath = "CameraMFD_Perf.csv";
+
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_O);
+
+	if (!Camera_MFD::GetPerfLog())
+	{
+		Bench::Fail("the performance log didn't start");
+		return;
+	}
+
+	for (int frame = 0; frame < 35; frame++)
+		fixture.Frame(0.1);
+
+	size_t samples = Camera_MFD::GetPerfLog()->GetSamples();
+
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_O);
+
+	if (Camera_MFD::GetPerfLog())
+		Bench::Fail("the performance log didn't stop");
+
+	if (samples < 3 || samples > 5)
+		Bench::Fail("the log took %zu samples in 3.5 seconds, every second", samples);
+
+	if (countLines(logPath, "time,vessel") != 1 || countLines(logPath, "\"Deltaglider\",0,") != samples || countLines(logPath, "\"\",-1,") != samples)
+		Bench::Fail("the log doesn't have a header and %zu rows of the MFD and the module", samples);
+
+	// The log sampled on every frame, as the simulation thread cost
+	Camera_MFD::StartPerfLog(1e-9);
+
+	Bench::Time("Frame (log sample every frame)", iterations, [&](int) { fixture.Frame(dt); });
+
+	if (Camera_MFD::GetPerfLog()->GetSamples() != size_t(iterations))
+		Bench::Fail("the log took %zu samples in %d frames", Camera_MFD::GetPerfLog()->GetSamples(), iterations);
+
+	Camera_MFD::StopPerfLog();
+
+	if (countLines(logPath, "\"\",-1,") != size_t(iterations))
+		Bench::Fail("the log wrote %zu of %d samples", countLines(logPath, "\"\",-1,"), iterations);
+
+	// The log interval is an MFD item, which starts the log when it's read
+	fixture.ReadStatus("CPERFLOG 2");
+
+	if (!Camera_MFD::GetPerfLog() || Camera_MFD::GetPerfLog()->GetInterval() != 2)
+		Bench::Fail("the log wasn't started by the CPERFLOG item");
+
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	if (Headless::GetScenario(scn).find("CPERFLOG 2") == std::string::npos)
+		Bench::Fail("the log interval wasn't written into the scenario");
+
+	Headless::CloseScenario(scn);
+
+	Camera_MFD::StopPerfLog();
+	std::remove(logPath.c_str());
+}
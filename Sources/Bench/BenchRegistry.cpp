@@ -0,0 +1,151 @@
+// =======================================================================================
+// BenchRegistry.cpp : Scale benchmarks of the MFD data registry.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+
+#include <memory>
+#include <random>
+
+DLLCLBK void opcDeleteVessel(OBJHANDLE hVessel);
+DLLCLBK void opcCloseRenderViewport();
+
+extern MFD_Registry mfdRegistry;
+
+const int vesselCount = 10000;
+const int mfdsPerVessel = 4;
+
+static MFD_Data *newData(OBJHANDLE hVessel, int mfdIndex)
+{
+	MFD_Data *data = new MFD_Data;
+	data->hVessel = hVessel;
+	data->mfdIndex = mfdIndex;
+
+	return data;
+}
+
+BENCHMARK(Registry_Scale)
+{
+	std::vector<std::unique_ptr<Headless::Vessel>> vessels;
+
+	for (int vessel = 0; vessel < vesselCount; vessel++)
+		vessels.emplace_back(new Headless::Vessel("Deltaglider"));
+
+	// The linear vector the MFD used before the registry
+	std::vector<MFD_Data*> linear;
+	MFD_Registry registry;
+
+	for (auto &vessel : vessels)
+	{
+		for (int mfdIndex = 0; mfdIndex < mfdsPerVessel; mfdIndex++)
+		{
+			linear.push_back(newData(vessel->GetHandle(), mfdIndex));
+			registry.Add(newData(vessel->GetHandle(), mfdIndex));
+		}
+	}
+
+	std::mt19937 random(1357);
+	int lookups = std::min(iterations, 20000);
+
+	Bench::Time("Find, 10k vessels (linear)", lookups, [&](int)
+	{
+		OBJHANDLE hVessel = vessels[random() % vesselCount]->GetHandle();
+		int mfdIndex = random() % mfdsPerVessel;
+
+		for (const auto &data : linear)
+		{
+			if (data->hVessel == hVessel && data->mfdIndex == mfdIndex)
+			{
+				Bench::Keep(data);
+				break;
+			}
+		}
+	});
+
+	Bench::Time("Find, 10k vessels (registry)", iterations, [&](int)
+	{
+		Bench::Keep(registry.Find(vessels[random() % vesselCount]->GetHandle(), random() % mfdsPerVessel));
+	});
+
+	Bench::Time("Delete vessel, 10k vessels (linear)", std::min(lookups, vesselCount), [&](int vessel)
+	{
+		OBJHANDLE hVessel = vessels[vessel]->GetHandle();
+
+		for (size_t dataIndex = 0; dataIndex < linear.size(); )
+		{
+			if (linear[dataIndex]->hVessel == hVessel)
+			{
+				delete linear[dataIndex];
+				linear.erase(linear.begin() + dataIndex);
+			}
+			else
+				dataIndex++;
+		}
+	});
+
+	Bench::Time("Delete vessel, 10k vessels (registry)", vesselCount, [&](int vessel) { registry.DeleteVessel(vessels[vessel]->GetHandle()); });
+
+	if (registry.Size() != 0)
+		Bench::Fail("%zu MFD data left after deleting all the vessels", registry.Size());
+
+	for (const auto &data : linear)
+		delete data;
+
+	// Replacing the data of an MFD which tracks a target removes it from the trackers, which deleting the vessel walks
+	Headless::Vessel tracking{ "Deltaglider" };
+	MFD_Data *trackingData = newData(tracking.GetHandle(), 0);
+
+	registry.Add(trackingData);
+	registry.Track(trackingData);
+	registry.Add(newData(tracking.GetHandle(), 0));
+	registry.DeleteVessel(tracking.GetHandle());
+
+	if (registry.Size() != 0)
+		Bench::Fail("%zu MFD data left after replacing and deleting a tracking MFD data", registry.Size());
+
+	// Opening an MFD on each vessel, then reopening it as an MFD mode switch does
+	SetupOrbiterRoot();
+
+	for (auto &vessel : vessels)
+		for (int mfdIndex = 0; mfdIndex < 2; mfdIndex++)
+			delete new Camera_MFD(512, 512, vessel.get(), mfdIndex);
+
+	Bench::Time("Camera_MFD reopen, 10k vessels", std::min(iterations, vesselCount), [&](int vessel)
+	{
+		delete new Camera_MFD(512, 512, vessels[vessel].get(), vessel % 2);
+	});
+
+	size_t expected = 2 * vesselCount;
+
+	for (auto &vessel : vessels)
+	{
+		opcDeleteVessel(vessel->GetHandle());
+		expected -= 2;
+
+		if (mfdRegistry.Size() != expected)
+		{
+			Bench::Fail("opcDeleteVessel left %zu MFD data, expected %zu", mfdRegistry.Size(), expected);
+			break;
+		}
+	}
+
+	opcCloseRenderViewport();
+}
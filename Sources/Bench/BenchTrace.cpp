@@ -0,0 +1,150 @@
+// =======================================================================================
+// BenchTrace.cpp : Trace zones benchmarks.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+#include "../Trace.h"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+// Returns the count of the occurrences of a text in a file
+static size_t countText(const std::string &path, const std::string &text)
+{
+	std::ifstream file(path);
+	std::stringstream content;
+	content << file.rdbuf();
+
+	std::string data = content.str();
+	size_t count = 0;
+
+	for (size_t pos = data.find(text); pos != std::string::npos; pos = data.find(text, pos + 1))
+		count++;
+
+	return count;
+}
+
+BENCHMARK(Trace_Zones)
+{
+	std::string path = (std::filesystem::temp_directory_path() / ("CameraMFD_Trace." + std::to_string(getpid()) + ".json")).string();
+
+	// Register the thread buffer and empty the buffers
+	Trace::Record("Bench", Trace::Now());
+	Trace::Flush(path);
+
+	// In whole batches of 100, as the batches are timed whole
+	int zones = (std::max)(100, (std::min)(iterations, int(Trace::bufferSize)) / 100 * 100);
+
+	Bench::Time("Zone", zones, 100, [](int) { Trace::Zone zone("Bench::Zone"); });
+
+	size_t written = Trace::Flush(path);
+
+	if (written != size_t(zones) || countText(path, "\"name\":\"Bench::Zone\",\"ph\":\"X\"") != size_t(zones))
+		Bench::Fail("%zu of %d zones were written", written, zones);
+
+	// Recording doesn't allocate, and a full buffer drops the zones instead of blocking
+	uint64_t allocations = Bench::Allocations();
+	size_t dropped = Trace::Dropped();
+
+	for (size_t zone = 0; zone < Trace::bufferSize + 10; zone++)
+		Trace::Record("Bench::Full", Trace::Now());
+
+	if (Bench::Allocations() != allocations)
+		Bench::Fail("recording zones made %llu allocations", (unsigned long long)(Bench::Allocations() - allocations));
+
+	if (Trace::Dropped() - dropped != 10)
+		Bench::Fail("%zu zones were dropped from a full buffer, expected 10", Trace::Dropped() - dropped);
+
+	if (Trace::Flush(path) != Trace::bufferSize)
+		Bench::Fail("a full buffer wasn't written");
+
+	// Threads record while the buffers are flushed. Every zone is either written or dropped.
+	const int threadCount = 4;
+	const size_t threadZones = 200000;
+
+	std::atomic<int> running{ threadCount };
+	std::vector<std::thread> threads;
+
+	dropped = Trace::Dropped();
+	size_t bufferCount = Trace::BufferCount();
+
+	for (int thread = 0; thread < threadCount; thread++)
+	{
+		threads.emplace_back([&]
+		{
+			for (size_t zone = 0; zone < threadZones; zone++)
+				Trace::Zone traceZone("Bench::Thread");
+
+			running--;
+		});
+	}
+
+	written = 0;
+
+	while (running > 0)
+		written += Trace::Flush(path);
+
+	for (auto &thread : threads)
+		thread.join();
+
+	written += Trace::Flush(path);
+	dropped = Trace::Dropped() - dropped;
+
+	if (written + dropped != threadCount * threadZones)
+		Bench::Fail("%zu zones were written and %zu dropped, of %zu recorded by %d threads", written, dropped, threadCount * threadZones, threadCount);
+
+	// The buffers of the threads were deleted by the flush after they ended
+	if (Trace::BufferCount() > bufferCount)
+		Bench::Fail("%zu thread buffers after the threads ended, expected %zu", Trace::BufferCount(), bufferCount);
+
+	// The MFD zones, if they're compiled in. The zones of the setup are flushed first, as the updates until the configuration file is adopted vary.
+	{
+		MFDFixture fixture;
+		written = Trace::Flush(path);
+
+		for (int frame = 0; frame < 100; frame++)
+			fixture.Frame(1.0 / 60);
+	}
+
+#ifdef CAMERAMFD_TRACE
+	const char *mfdZones[] = { "opcPreStep", "Camera_MFD::Update", "Camera_MFD::setButtons", "Camera_MFD::LoadConfig", "Camera_MFD::adoptConfig",
+		"Camera_MFD::setCustomCamera", "Camera_MFD::updateSurface", "SurfacePool::Acquire", "opcCloseRenderViewport" };
+
+	// The fixture closed the render viewport, which wrote the zones of the frames into the Orbiter folder
+	for (const char *zone : mfdZones)
+		if (countText(path, std::string("\"name\":\"") + zone + "\"") + countText("CameraMFD_Trace.json", std::string("\"name\":\"") + zone + "\"") == 0)
+			Bench::Fail("the %s zone wasn't written", zone);
+
+	if (countText("CameraMFD_Trace.json", "\"name\":\"Camera_MFD::Update\"") != 100)
+		Bench::Fail("the Camera_MFD::Update zones weren't written for every update");
+
+	std::remove("CameraMFD_Trace.json");
+#else
+	written += Trace::Flush(path);
+
+	if (written != 0)
+		Bench::Fail("the MFD recorded %zu zones, but the zones aren't compiled in", written);
+#endif
+
+	std::remove(path.c_str());
+}
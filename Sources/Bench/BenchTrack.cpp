@@ -0,0 +1,185 @@
+// =======================================================================================
+// BenchTrack.cpp : Target tracking benchmarks.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Bench.h"
+#include "MFDFixture.h"
+
+DLLCLBK void opcDeleteVessel(OBJHANDLE hVessel);
+
+// Returns the angle in degrees between the last camera set up and the direction from the camera to the passed global position
+static double aimError(const MFDFixture &fixture, const VECTOR3 &targetPos)
+{
+	VECTOR3 local;
+	fixture.vessel.Global2Local(targetPos, local);
+
+	VECTOR3 expected = local - Headless::lastCamera.pos;
+	expected = expected / length(expected);
+
+	return acos(std::max(std::min(dotp(expected, Headless::lastCamera.dir), 1.0), -1.0)) * DEG;
+}
+
+BENCHMARK(Track_MFD)
+{
+	MFDFixture fixture;
+	int cam = fixture.mfd->GetCurrentCamera();
+	const double dt = 1.0 / 60;
+
+	Bench::Time("Frame (no target)", iterations, [&](int) { fixture.Frame(dt); });
+
+	Headless::Vessel station{ "ProjectAlpha_ISS" };
+	station.name = "Station";
+	station.globalPos = _V(100, 20, 300);
+
+	if (fixture.mfd->SetCameraTarget(cam, fixture.vessel.GetHandle(), -1))
+		Bench::Fail("the camera was set to track its own vessel");
+
+	if (fixture.mfd->SetCameraTarget(cam, station.GetHandle(), 0))
+		Bench::Fail("a target docking port which doesn't exist was set");
+
+	if (!fixture.mfd->SetCameraTarget(cam, station.GetHandle(), -1) || fixture.mfd->GetCameraTarget(cam) != station.GetHandle())
+	{
+		Bench::Fail("the camera target wasn't set");
+		return;
+	}
+
+	fixture.Frame(dt);
+
+	double error = aimError(fixture, station.globalPos);
+
+	if (error > 1e-6)
+		Bench::Fail("the camera points %g degrees off its target", error);
+
+	// A target moving under the tolerance doesn't set the camera up again
+	Headless::ResetCounters();
+
+	Bench::Time("Frame (target in tolerance)", iterations, [&](int iteration) { station.globalPos.x = 100 + 0.1 * sin(iteration * 0.01); fixture.Frame(dt); });
+
+	if (Headless::counters.setupCustomCamera != 0)
+		Bench::Fail("the camera was set up %zu times for a target moving under the tolerance", Headless::counters.setupCustomCamera);
+
+	if (Headless::counters.invalidateButtons != 0)
+		Bench::Fail("tracking updated the buttons %zu times", Headless::counters.invalidateButtons);
+
+	// A target moving over the tolerance on every frame
+	Headless::ResetCounters();
+
+	Bench::Time("Frame (target over tolerance)", iterations, [&](int iteration) { station.globalPos.x = 100 + 10 * sin(iteration * 0.1); fixture.Frame(dt); });
+
+	if (Headless::counters.setupCustomCamera == 0)
+		Bench::Fail("the camera wasn't set up for a target moving over the tolerance");
+
+	error = aimError(fixture, station.globalPos);
+
+	if (error > 0.1)
+		Bench::Fail("the camera points %g degrees off its moving target", error);
+
+	// Holding a key while tracking a moving target sets the camera up once per frame
+	char kstate[256] = { };
+	kstate[OAPI_KEY_A] = char(0x80);
+
+	Headless::ResetCounters();
+
+	for (int frame = 0; frame < 120; frame++)
+	{
+		station.globalPos.x = 100 + 10 * sin(frame * 0.1);
+		fixture.Frame(dt, kstate);
+	}
+
+	kstate[OAPI_KEY_A] = 0;
+	fixture.mfd->ConsumeKeyImmediate(kstate);
+
+	if (Headless::counters.maxFrameCameraSetups != 1)
+		Bench::Fail("%zu camera setups in a frame while holding a key on a moving target", Headless::counters.maxFrameCameraSetups);
+
+	// A docking port of a rotated target
+	station.docks.push_back(_V(0, 5, 30));
+	station.rotation = { 0, 0, 1, 0, 1, 0, -1, 0, 0 };
+
+	if (!fixture.mfd->SetCameraTarget(cam, station.GetHandle(), 0))
+		Bench::Fail("the target docking port wasn't set");
+
+	fixture.Frame(dt);
+
+	VECTOR3 dockPos;
+	station.Local2Global(station.docks[0], dockPos);
+
+	error = aimError(fixture, dockPos);
+
+	if (error > 1e-6)
+		Bench::Fail("the camera points %g degrees off the target docking port", error);
+
+	// The target is written into the scenario and found by name when read back
+	FILEHANDLE scn = Headless::CreateScenario();
+	fixture.mfd->WriteStatus(scn);
+
+	std::string status = Headless::GetScenario(scn);
+	Headless::CloseScenario(scn);
+
+	if (status.find("CTRACK Station 0") == std::string::npos)
+		Bench::Fail("the camera target wasn't written into the scenario");
+
+	fixture.mfd->SetCameraTarget(cam, nullptr, -1);
+	fixture.ReadStatus(status);
+	fixture.Frame(dt);
+
+	if (fixture.mfd->GetCameraTarget(cam) != station.GetHandle())
+		Bench::Fail("the camera target wasn't read back from the scenario");
+
+	// The target set by name from the MFD
+	fixture.mfd->SetCameraTarget(cam, nullptr, -1);
+
+	// The buttons are set on the next update
+	while (std::string(fixture.mfd->ButtonLabel(9)) != "TGT")
+	{
+		fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_P);
+		fixture.Frame(dt);
+	}
+
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_T);
+
+	if (Headless::EnterInput("Nothing"))
+		Bench::Fail("a target which doesn't exist was accepted");
+
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_T);
+
+	if (!Headless::EnterInput("Station") || fixture.mfd->GetCameraTarget(cam) != station.GetHandle())
+		Bench::Fail("the target entered by name wasn't set");
+
+	fixture.mfd->ConsumeKeyBuffered(OAPI_KEY_T);
+
+	if (!Headless::EnterInput("") || fixture.mfd->GetCameraTarget(cam))
+		Bench::Fail("an empty target name didn't stop tracking");
+
+	// Deleting the target stops tracking, and the camera stays in its last direction
+	fixture.mfd->SetCameraTarget(cam, station.GetHandle(), -1);
+	fixture.Frame(dt);
+
+	VECTOR3 lastDir = Headless::lastCamera.dir;
+	opcDeleteVessel(station.GetHandle());
+
+	if (fixture.mfd->GetCameraTarget(cam))
+		Bench::Fail("the camera still tracks a deleted target");
+
+	fixture.Frame(dt);
+
+	if (length(Headless::lastCamera.dir - lastDir) > 1e-9)
+		Bench::Fail("the camera direction changed after its target was deleted");
+}
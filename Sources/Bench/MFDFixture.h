@@ -0,0 +1,127 @@
+// =======================================================================================
+// MFDFixture.h : A Camera MFD opened on a headless vessel for the benchmarks.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include "../CameraMFD.h"
+#include "../Headless/Headless.h"
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include <unistd.h>
+
+DLLCLBK void opcPreStep(double simt, double simdt, double mjd);
+DLLCLBK void opcCloseRenderViewport();
+
+// Sets up a temporary Orbiter root folder with a copy of the configuration files, as the MFD writes their caches beside them.
+// The folder is set up once per run, and removed on exit.
+inline const std::filesystem::path &SetupOrbiterRoot()
+{
+	static struct OrbiterRoot
+	{
+		std::filesystem::path path;
+
+		OrbiterRoot()
+		{
+			path = std::filesystem::temp_directory_path() / ("CameraMFD_Bench." + std::to_string(getpid()));
+
+			std::filesystem::remove_all(path);
+			std::filesystem::create_directories(path / "Config");
+			std::filesystem::copy(CAMERAMFD_CONFIG_DIR, path / "Config", std::filesystem::copy_options::recursive);
+
+			Headless::SetRootDir(path.string());
+		}
+
+		~OrbiterRoot() { std::filesystem::remove_all(path); }
+	} root;
+
+	return root.path;
+}
+
+// Opens a Camera MFD on a Deltaglider and loads its configuration file by the first update
+struct MFDFixture
+{
+	Headless::Vessel vessel{ "Deltaglider" };
+	Headless::Sketchpad skp;
+	Camera_MFD *mfd;
+
+	MFDFixture(int camInfo = 2)
+	{
+		SetupOrbiterRoot();
+
+		mfd = new Camera_MFD(512, 512, &vessel, 0);
+		mfd->Update(&skp);
+
+		// The configuration file is loaded by the watcher thread, and adopted by an update after that
+		for (int wait = 0; wait < 2000 && mfd->IsConfigPending(); wait++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			mfd->Update(&skp);
+		}
+
+		// Cycle the information mode until it's the requested one
+		while (true)
+		{
+			FILEHANDLE scn = Headless::CreateScenario();
+			mfd->WriteStatus(scn);
+
+			bool found = Headless::GetScenario(scn).find("CINF " + std::to_string(camInfo)) != std::string::npos;
+			Headless::CloseScenario(scn);
+
+			if (found)
+				break;
+
+			mfd->ConsumeKeyBuffered(OAPI_KEY_I);
+		}
+	}
+
+	// Runs a frame: advances the time, calls the pre-step hook, then updates the MFD
+	void Frame(double dt)
+	{
+		Headless::Step(dt);
+		opcPreStep(0, dt, 0);
+		mfd->Update(&skp);
+	}
+
+	// Runs a frame with the passed keys state: the pre-step hook, then the keys, then the MFD update
+	void Frame(double dt, char *kstate)
+	{
+		Headless::Step(dt);
+		opcPreStep(0, dt, 0);
+		mfd->ConsumeKeyImmediate(kstate);
+		mfd->Update(&skp);
+	}
+
+	// Reads the passed scenario text into the MFD
+	void ReadStatus(const std::string &text)
+	{
+		FILEHANDLE scn = Headless::OpenScenario(text);
+		mfd->ReadStatus(scn);
+		Headless::CloseScenario(scn);
+	}
+
+	~MFDFixture()
+	{
+		delete mfd;
+		opcCloseRenderViewport();
+	}
+};
@@ -0,0 +1,164 @@
+// =======================================================================================
+// ButtonLayout.h : The compile time tables of the MFD buttons layouts.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include "FrameCapture.h"
+
+#include <Orbitersdk.h>
+
+#include <array>
+
+// The labels, keys and menu of the 12 MFD buttons
+struct ButtonLayout
+{
+	const char *labels[12];
+	DWORD keys[12];
+	MFDBUTTONMENU menu[12];
+};
+
+// All the buttons layouts, generated at compile time. The MFD selects its layout by an index instead of building it.
+// The 6 left buttons depend on the adjust mode and if the user can control it. The 6 right buttons depend on the page:
+//  page 0 (adjust): if the user can change the FOV, control multiple adjust modes, and if the MFD is controlled by vessel.
+//  page 1 (cameras): if the user can select the camera, and if the MFD is controlled by vessel.
+//  page 2 (layout, capture and tracking): if a capture is running, the capture format, and if the MFD is controlled by vessel.
+//  page 3 (diagnostics): a single state.
+namespace ButtonLayouts
+{
+	constexpr int adjustModes = 3; // In the order of Camera_MFD::AdjustMode
+	constexpr int adjustStates = adjustModes * 2;
+	constexpr int pages = 4;
+
+	// The right buttons states count of each page
+	constexpr int pageStates[pages] = { 8, 4, 2 * FrameCapture::FORMAT_COUNT * 2, 1 };
+
+	constexpr int pageOffset(int page)
+	{
+		int offset = 0;
+
+		for (int prev = 0; prev < page; prev++)
+			offset += adjustStates * pageStates[prev];
+
+		return offset;
+	}
+
+	constexpr int count = pageOffset(pages);
+
+	constexpr const char *adjustLabels[6] = { "LFT", "RHT", "UP", "DWN", "FWD", "BCK" };
+	constexpr DWORD adjustKeys[6] = { OAPI_KEY_A, OAPI_KEY_D, OAPI_KEY_W, OAPI_KEY_S, OAPI_KEY_Q, OAPI_KEY_E };
+	constexpr char adjustChars[6] = { 'A', 'D', 'W', 'S', 'Q', 'E' };
+
+	// The adjust buttons menu of each mode. The buttons with no menu are not used by the mode.
+	constexpr const char *adjustMenus[adjustModes][6] = {
+		{ "Move Left", "Move Right", "Move Up", "Move Down", "Move Forward", "Move Backward" },
+		{ "Look Left", "Look Right", "Look Up", "Look Down", nullptr, nullptr },
+		{ "Rotate Left", "Rotate Right", nullptr, nullptr, nullptr, nullptr }
+	};
+
+	constexpr const char *resetMenus[adjustModes] = { "Reset Camera Position", "Reset Camera Direction", "Reset Camera Rotation" };
+
+	// Sets a button, or leaves it empty if it's not enabled
+	constexpr void setButton(ButtonLayout &layout, int bt, bool enabled, const char *label, DWORD key, const char *line1, char selchar, const char *line2 = nullptr)
+	{
+		layout.labels[bt] = enabled ? label : " ";
+		layout.keys[bt] = enabled ? key : OAPI_KEY_ESCAPE;
+		layout.menu[bt] = enabled ? MFDBUTTONMENU{ line1, line2, selchar } : MFDBUTTONMENU{ nullptr, nullptr, 0 };
+	}
+
+	constexpr ButtonLayout makeLayout(int page, int adj, bool adjust, int state)
+	{
+		ButtonLayout layout{};
+
+		for (int bt = 0; bt < 6; bt++)
+			setButton(layout, bt, adjust && adjustMenus[adj][bt], adjustLabels[bt], adjustKeys[bt], adjustMenus[adj][bt], adjustChars[bt]);
+
+		switch (page)
+		{
+		case 0:
+		{
+			bool changeFOV = state & 1, multipleAdj = state & 2, vesselControlled = state & 4;
+
+			setButton(layout, 6, changeFOV, "ZM+", OAPI_KEY_Z, "Zoom In", 'Z');
+			setButton(layout, 7, changeFOV, "ZM-", OAPI_KEY_X, "Zoom Out", 'X');
+			setButton(layout, 8, multipleAdj, "ADJ", OAPI_KEY_J, "Change Adjust Mode", 'J');
+			setButton(layout, 9, adjust, "RST", OAPI_KEY_R, resetMenus[adj], 'R');
+			setButton(layout, 10, !vesselControlled, "LBL", OAPI_KEY_L, "Change Label", 'L');
+			setButton(layout, 11, true, "PG", OAPI_KEY_P, "Switch Page", 'P');
+			break;
+		}
+		case 1:
+		{
+			bool selectCamera = state & 1, vesselControlled = state & 2;
+
+			setButton(layout, 6, selectCamera, "CM+", OAPI_KEY_C, "Next Camera", 'C');
+			setButton(layout, 7, selectCamera, "CM-", OAPI_KEY_V, "Previous Camera", 'V');
+			setButton(layout, 8, !vesselControlled, "ADD", OAPI_KEY_G, "Add Camera", 'G');
+			setButton(layout, 9, !vesselControlled, "DEL", OAPI_KEY_H, "Delete Camera", 'H');
+			setButton(layout, 10, true, "INF", OAPI_KEY_I, "Change Camera Info", 'I');
+			setButton(layout, 11, true, "PG", OAPI_KEY_P, "Switch Page", 'P');
+			break;
+		}
+		case 2:
+		{
+			bool capture = state & 1;
+			int format = state / 2 % FrameCapture::FORMAT_COUNT;
+			bool vesselControlled = state / 2 / FrameCapture::FORMAT_COUNT;
+
+			setButton(layout, 6, true, "LYT", OAPI_KEY_K, "Change Layout", 'K');
+			setButton(layout, 7, true, "REC", OAPI_KEY_Y, capture ? "Stop Capture" : "Start Capture", 'Y');
+			setButton(layout, 8, true, "FMT", OAPI_KEY_F, "Capture Format", 'F', FrameCapture::FormatName(format));
+			setButton(layout, 9, !vesselControlled, "TGT", OAPI_KEY_T, "Track Target", 'T');
+			setButton(layout, 10, false, nullptr, 0, nullptr, 0);
+			setButton(layout, 11, true, "PG", OAPI_KEY_P, "Switch Page", 'P');
+			break;
+		}
+		case 3:
+			setButton(layout, 6, true, "LOG", OAPI_KEY_O, "Performance Log", 'O', "Start or Stop");
+
+			for (int bt = 7; bt < 11; bt++)
+				setButton(layout, bt, false, nullptr, 0, nullptr, 0);
+
+			setButton(layout, 11, true, "PG", OAPI_KEY_P, "Switch Page", 'P');
+			break;
+		}
+
+		return layout;
+	}
+
+	constexpr std::array<ButtonLayout, count> makeLayouts()
+	{
+		std::array<ButtonLayout, count> layouts{};
+
+		for (int page = 0; page < pages; page++)
+			for (int adjustState = 0; adjustState < adjustStates; adjustState++)
+				for (int state = 0; state < pageStates[page]; state++)
+					layouts[pageOffset(page) + adjustState * pageStates[page] + state] = makeLayout(page, adjustState / 2, adjustState & 1, state);
+
+		return layouts;
+	}
+
+	inline constexpr std::array<ButtonLayout, count> layouts = makeLayouts();
+
+	// Returns the layout of a page, with the adjust mode, if the user can control it, and the page state as described above
+	inline const ButtonLayout &Get(int page, int adj, bool adjust, int state)
+	{
+		return layouts[pageOffset(page) + (adj * 2 + adjust) * pageStates[page] + state];
+	}
+}
@@ -22,17 +22,120 @@
 #define ORBITER_MODULE
 
 #include "CameraMFD.h"
+#include "ConfigCache.h"
+#include "ScenarioTokenizer.h"
+#include "Trace.h"
+#include "SurfacePool.h"
 
 #include <Sketchpad2.h>
 
-#include <sstream>
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
 
 
 // ==============================================================
 // API interface
 
 int mfdMode;
-std::vector<MFD_Data*> mfdData;
+MFD_Registry mfdRegistry;
+SurfacePool surfacePool;
+
+// The position step in meters
+const double posStep = 0.025;
+
+// The direction and rotation step in degrees, and its precomputed rotations
+const double stepAngle = 0.5;
+const double stepHalfCos = cos(stepAngle * RAD / 2);
+const double stepHalfSin = sin(stepAngle * RAD / 2);
+
+const Quaternion stepUp = pitchRotation(stepAngle * RAD);
+const Quaternion stepDown = pitchRotation(-stepAngle * RAD);
+const Quaternion stepRotLeft = rollRotation(stepAngle * RAD);
+const Quaternion stepRotRight = rollRotation(-stepAngle * RAD);
+
+// The held key adjust rates, before the hold acceleration
+const double posRate = 0.5;   // In meters per second
+const double angleRate = 10;  // In degrees per second
+const double fovRate = 10;    // In degrees per second
+
+// The default target direction change in degrees over which the tracking cameras point at their target again
+const double defaultTrackTolerance = 0.1;
+
+// The tiles count of each layout
+const int layoutTiles[] = { 1, 2, 4, 9 };
+
+// The render target surface flags
+const DWORD renderSurfaceFlags = OAPISURFACE_TEXTURE | OAPISURFACE_RENDERTARGET | OAPISURFACE_RENDER3D | OAPISURFACE_NOMIPMAPS;
+
+// Sets up a custom camera for the camera data, rendering into the passed surface
+static CAMERAHANDLE setupCamera(CAMERAHANDLE hCamera, OBJHANDLE hVessel, const InternalData &camData, SURFHANDLE hSurf)
+{
+	MATRIX3 mat = toMatrix(camData.dir);
+
+	VECTOR3 dir = _V(mat.m13, mat.m23, mat.m33);
+	VECTOR3 rot = _V(mat.m12, mat.m22, mat.m32);
+
+	return gcSetupCustomCamera(hCamera, hVessel, camData.pos + camData.userPos, dir, rot, (camData.fov + camData.userFOV) * RAD, hSurf, 0xFF);
+}
+
+// Returns the baseline of the delta scenarios, of the cameras loaded from the configuration file
+static std::shared_ptr<const ConfigBaseline> makeBaseline(const std::string &fileName, const FlatMap<int, InternalData> &camMap)
+{
+	auto baseline = std::make_shared<ConfigBaseline>();
+
+	baseline->fileName = fileName;
+	baseline->camMap = camMap;
+
+	return baseline;
+}
+
+// Sets the MFD items flagged by items (the MFD_Data::Item flags)
+static void copyItems(const MFD_Data &from, MFD_Data *to, int items)
+{
+	if (items & MFD_Data::ITEM_ADJ)
+		to->adj = from.adj;
+
+	if (items & MFD_Data::ITEM_PAGE)
+		to->page = from.page;
+
+	if (items & MFD_Data::ITEM_INFO)
+		to->camInfo = from.camInfo;
+
+	if (items & MFD_Data::ITEM_CAM)
+		to->cam = from.cam;
+
+	if (items & MFD_Data::ITEM_BUDGET)
+		to->frameBudget = from.frameBudget;
+
+	if (items & MFD_Data::ITEM_MINSCALE)
+		to->minScale = from.minScale;
+
+	if (items & MFD_Data::ITEM_LAYOUT)
+		to->layout = from.layout;
+
+	if (items & MFD_Data::ITEM_TRACKTOL)
+		to->trackTolerance = from.trackTolerance;
+
+	if (items & MFD_Data::ITEM_PERFLOG)
+		to->perfLogInterval = from.perfLogInterval;
+
+	if (items & MFD_Data::ITEM_COMPACT)
+		to->compactStatus = from.compactStatus;
+
+	if (items & MFD_Data::ITEM_DELTA)
+		to->deltaStatus = from.deltaStatus;
+
+	if (items & MFD_Data::ITEM_MAXPARK)
+		to->maxParked = from.maxParked;
+
+	if (items & MFD_Data::ITEM_RATE)
+		to->defaultRate = from.defaultRate;
+
+	if (items & MFD_Data::ITEM_SCALE)
+		to->defaultScale = from.defaultScale;
+}
 
 DLLCLBK void InitModule(HINSTANCE hDLL) 
 {
@@ -49,36 +152,229 @@ DLLCLBK void InitModule(HINSTANCE hDLL)
 DLLCLBK void ExitModule(HINSTANCE hDLL) 
 {
 	oapiUnregisterMFDMode(mfdMode);
+	FrameCapture::DeleteFinished(true);
 }
 
 DLLCLBK void opcDeleteVessel(OBJHANDLE hVessel)
 {
+	TRACE_ZONE("opcDeleteVessel");
+
 	// Delete the vessel MFD data if there are data for it
-	for (size_t dataIndex = 0; dataIndex < mfdData.size(); dataIndex++)
+	mfdRegistry.DeleteVessel(hVessel);
+}
+
+DLLCLBK void opcPreStep(double simt, double simdt, double mjd)
+{
+	TRACE_ZONE("opcPreStep");
+
+	Camera_MFD::PreStepAll();
+	surfacePool.Trim(oapiGetSysTime());
+}
+
+DLLCLBK void opcOpenRenderViewport(HWND hRenderWnd, DWORD width, DWORD height, BOOL fullscreen)
+{
+	TRACE_ZONE("opcOpenRenderViewport");
+
+	// Load the configuration files of the vessels in the scenario before their MFDs are opened
+	Camera_MFD::PreloadConfigs();
+}
+
+DLLCLBK void opcCloseRenderViewport()
+{
+	{
+		TRACE_ZONE("opcCloseRenderViewport");
+
+		// Delete all data
+		Camera_MFD::StopPerfLog();
+		Camera_MFD::StopConfigWatcher();
+		FrameCapture::DeleteFinished(true);
+		mfdRegistry.Clear();
+		surfacePool.Clear();
+	}
+
+#ifdef CAMERAMFD_TRACE
+	// Write the session zones into the Orbiter folder, after the zone above is recorded
+	Trace::Flush("CameraMFD_Trace.json");
+#endif
+}
+
+// ==============================================================
+// MFD registry implementation
+
+MFD_Data *MFD_Registry::Find(OBJHANDLE hVessel, int mfdIndex) const
+{
+	auto vessel = vessels.find(hVessel);
+
+	if (vessel == vessels.end())
+		return nullptr;
+
+	return vessel->second[mfdIndex];
+}
+
+void MFD_Registry::Add(MFD_Data *data)
+{
+	auto vessel = vessels.find(data->hVessel);
+
+	if (vessel == vessels.end())
+	{
+		vessel = vessels.emplace(data->hVessel, std::array<MFD_Data*, MAXMFD>()).first;
+		vessel->second.fill(nullptr);
+	}
+
+	auto &slot = vessel->second[data->mfdIndex];
+
+	if (slot)
 	{
-		auto data = mfdData[dataIndex];
+		Unpark(slot);
+		trackers.erase(std::remove(trackers.begin(), trackers.end(), slot), trackers.end());
+		retired += slot->perf;
+		delete slot;
+	}
+	else
+		size++;
+
+	slot = data;
+}
 
-		if (data->hVessel == hVessel)
+void MFD_Registry::DeleteVessel(OBJHANDLE hVessel)
+{
+	auto vessel = vessels.find(hVessel);
+
+	if (vessel != vessels.end())
+	{
+		for (auto &data : vessel->second)
 		{
-			delete data;
-			mfdData.erase(mfdData.begin() + dataIndex);
+			if (data)
+			{
+				Unpark(data);
+				trackers.erase(std::remove(trackers.begin(), trackers.end(), data), trackers.end());
+				retired += data->perf;
+				delete data;
+				size--;
+			}
+		}
+
+		vessels.erase(vessel);
+	}
+
+	// Stop the cameras which track the vessel. They stay in their last direction.
+	for (MFD_Data *data : trackers)
+	{
+		for (auto &&camData : data->camMap)
+		{
+			if (camData.second.hTarget == hVessel)
+			{
+				camData.second.hTarget = nullptr;
+				camData.second.targetName.clear();
+			}
 		}
 	}
 }
 
-DLLCLBK void opcCloseRenderViewport()
+void MFD_Registry::Clear()
+{
+	for (auto &vessel : vessels)
+		for (auto &data : vessel.second)
+			delete data;
+
+	vessels.clear();
+	size = 0;
+
+	parked.clear();
+	maxParked = defaultMaxParked;
+	trackers.clear();
+	retired = PerfCounters();
+}
+
+PerfCounters MFD_Registry::GetCounters(OBJHANDLE hVessel) const
+{
+	PerfCounters counters;
+	auto vessel = vessels.find(hVessel);
+
+	if (vessel != vessels.end())
+		for (MFD_Data *data : vessel->second)
+			if (data)
+				counters += data->perf;
+
+	return counters;
+}
+
+PerfCounters MFD_Registry::GetTotals() const
+{
+	PerfCounters counters = retired;
+	ForEach([&counters](const MFD_Data *data) { counters += data->perf; });
+
+	return counters;
+}
+
+void MFD_Registry::Park(MFD_Data *data)
+{
+	Unpark(data);
+	parked.push_back(data);
+
+	releaseParked();
+}
+
+void MFD_Registry::SetMaxParked(size_t count)
+{
+	maxParked = (std::min)(count, parkLimit);
+
+	releaseParked();
+}
+
+void MFD_Registry::releaseParked()
+{
+	while (parked.size() > maxParked)
+	{
+		parked.front()->ReleaseCamera();
+		parked.erase(parked.begin());
+	}
+}
+
+void MFD_Registry::Track(MFD_Data *data)
+{
+	if (std::find(trackers.begin(), trackers.end(), data) == trackers.end())
+		trackers.push_back(data);
+}
+
+void MFD_Registry::Unpark(MFD_Data *data)
+{
+	auto it = std::find(parked.begin(), parked.end(), data);
+
+	if (it != parked.end())
+		parked.erase(it);
+}
+
+void MFD_Data::ReleaseCamera()
 {
-	// Delete all data
-	for (const auto &data : mfdData)
-		delete data;
+	if (hCamera)
+		gcDeleteCustomCamera(hCamera);
 
-	// Clear the list
-	mfdData.clear();
+	if (hRenderSrf)
+		surfacePool.Release(hRenderSrf, oapiGetSysTime());
+
+	hCamera = nullptr;
+	hRenderSrf = nullptr;
+
+	for (auto &tile : tiles)
+	{
+		if (tile.hCamera)
+			gcDeleteCustomCamera(tile.hCamera);
+
+		if (tile.hSurf)
+			surfacePool.Release(tile.hSurf, oapiGetSysTime());
+	}
+
+	tiles.clear();
 }
 
 // ==============================================================
 // MFD class implementation
 
+std::vector<Camera_MFD*> Camera_MFD::openMFDs;
+std::unique_ptr<PerfLog> Camera_MFD::perfLog;
+std::unique_ptr<ConfigWatcher> Camera_MFD::configWatcher;
+
 // MFD message parser
 int Camera_MFD::MsgProc(UINT msg, UINT mfd, WPARAM wparam, LPARAM lparam)
 {
@@ -94,39 +390,29 @@ bool Camera_MFD::LblClbk(void *id, char *str, void *usrdata)
 	return static_cast<Camera_MFD*>(usrdata)->setCamLabel(str);
 }
 
+bool Camera_MFD::TgtClbk(void *id, char *str, void *usrdata)
+{
+	return static_cast<Camera_MFD*>(usrdata)->setCamTarget(str);
+}
+
 Camera_MFD::Camera_MFD(DWORD w, DWORD h, VESSEL *vessel, UINT mfd) : MFD2(w, h, vessel)
 {
 	// Set the default camera data
-	defaultCam.label = "Camera 1";
-
-	defaultCam.pos = defaultCam.userPos = { 0,0,0 };
-	defaultCam.pitchAngle = defaultCam.userPitch = 0;
-	defaultCam.yawAngle = defaultCam.userYaw = 0;
-	defaultCam.rotAngle = defaultCam.userRot = 0;
-	defaultCam.fov = 40;
-	defaultCam.userFOV = 0;
-	defaultCam.dir = { 1,0,0,0,1,0,0,0,1 };
-
-	defaultCam.userControl = { true, true, true, true, true };
-	defaultCam.multipleAdj = true;
+	defaultCam = newCamera();
 
 	int mfdIndex(mfd % MAXMFD);
-	bool found = false;
 
 	// Search for any data saved for this MFD
-	for (const auto &data : mfdData) 
+	data = mfdRegistry.Find(vessel->GetHandle(), mfdIndex);
+
+	if (data)
 	{
-		if (data->hVessel == vessel->GetHandle() && data->mfdIndex == mfdIndex)
-		{
-			this->data = data;
-			found = dataExist = true;
-			loadConfig = false;
-			break;
-		}
+		dataExist = true;
+		loadConfig = false;
 	}
 
 	// If no data is found, create new data
-	if (!found)
+	else
 	{
 		data = new MFD_Data;
 
@@ -142,7 +428,17 @@ Camera_MFD::Camera_MFD(DWORD w, DWORD h, VESSEL *vessel, UINT mfd) : MFD2(w, h,
 		data->page = 0;
 		data->camInfo = 1;
 
-		mfdData.push_back(data);
+		data->frameBudget = 0;
+		data->minScale = 0;
+
+		data->layout = LAYOUT_SINGLE;
+		data->trackTolerance = defaultTrackTolerance;
+		data->perfLogInterval = 0;
+		data->compactStatus = false;
+		data->deltaStatus = false;
+		data->maxParked = -1;
+
+		mfdRegistry.Add(data);
 	}
 
 	setButtons();
@@ -151,1120 +447,2520 @@ Camera_MFD::Camera_MFD(DWORD w, DWORD h, VESSEL *vessel, UINT mfd) : MFD2(w, h,
 
 	if (gcInitialize())
 	{
-		// Create 3D render target
-		hRenderSrf = oapiCreateSurfaceEx(W, H, OAPISURFACE_TEXTURE  | OAPISURFACE_RENDERTARGET |
-		                                       OAPISURFACE_RENDER3D | OAPISURFACE_NOMIPMAPS);
-		// Clear the surface
-		oapiClearSurface(hRenderSrf);
+		mfdRegistry.Unpark(data);
 
-		setCustomCamera();
+		// The parked camera is already set up, so only switch it back on. The tiles are switched on in turns by preStep.
+		if (data->hCamera)
+			gcCustomCameraOnOff(data->hCamera, true);
+
+		// A parked camera keeps its surface, unless the MFD size changed
+		updateSurface();
 	}
+
+	// Start loading the configuration file, so it's likely loaded by the first update
+	if (loadConfig)
+		requestConfig(vessel->GetClassNameA());
+
+	openMFDs.push_back(this);
 }
 
 Camera_MFD::~Camera_MFD()
 {
+	openMFDs.erase(std::find(openMFDs.begin(), openMFDs.end(), this));
+
 	// Send the destroy message to the vessel
 	if (data->sendInstance)
 		static_cast<VESSEL3*>(oapiGetVesselInterface(data->hVessel))->clbkGeneric(CAMERA_MFD, data->mfdIndex, nullptr);
 	
 	oapiReleaseFont(font);
 
-	if (hCamera)
-		gcDeleteCustomCamera(hCamera);
+	// Leave the frames of a capture to its workers
+	FrameCapture::Finish(std::move(capture));
 
-	if (hRenderSrf)
-		oapiDestroySurface(hRenderSrf);
+	// Park the camera switched off, so it's ready if the MFD is opened again
+	if (data->hCamera)
+	{
+		if (cameraOn)
+			gcCustomCameraOnOff(data->hCamera, false);
+
+		for (auto &tile : data->tiles)
+		{
+			if (tile.on)
+				gcCustomCameraOnOff(tile.hCamera, false);
+
+			tile.on = false;
+		}
+
+		mfdRegistry.Park(data);
+	}
+	else
+		data->ReleaseCamera();
 }
 
-void Camera_MFD::ReadStatus(FILEHANDLE scn)  
+InternalData Camera_MFD::newCamera()
 {
-	data->camMap.clear();
+	InternalData camera;
+
+	camera.label = "Camera 1";
+
+	camera.pos = camera.userPos = { 0,0,0 };
+	camera.pitchAngle = camera.userPitch = 0;
+	camera.yawAngle = camera.userYaw = 0;
+	camera.rotAngle = camera.userRot = 0;
+	camera.fov = 40;
+	camera.userFOV = 0;
+	camera.dir = identityQuaternion;
+
+	camera.userControl = { true, true, true, true, true };
+	camera.multipleAdj = true;
+	camera.rate = 0;
+	camera.scale = 1;
+	camera.pathTime = 0;
+	camera.targetDock = -1;
+	camera.hTarget = nullptr;
+	camera.aimDir = { 0,0,0 };
+
+	return camera;
+}
+
+InternalData &Camera_MFD::addCamera(MFD_Data *data, int id, const InternalData &camera)
+{
+	InternalData &camData = data->camMap[id] = camera;
+
+	camData.rate = data->defaultRate;
+	camData.scale = data->defaultScale;
+
+	return camData;
+}
+
+template <typename NextLine, typename Include>
+int Camera_MFD::readLines(MFD_Data *data, NextLine nextLine, Include include, const bool &configLoaded)
+{
+	const InternalData defaultCam = newCamera();
+	int items = 0;
 
 	char *line;
-	int cam;
-	InternalData *camData;
+	int cam = 0;
 
-	while (oapiReadScenario_nextline(scn, line)) 
+	// The camera items before the first CCAM are read into a discarded record, except the MFD default render rate and scale
+	InternalData discardedCam;
+	InternalData *camData = &discardedCam;
+
+	typedef ScenarioTokenizer Tokenizer;
+
+	while (nextLine(line)) 
 	{
-		std::istringstream ss;
-		ss.str(line);
+		std::string_view text = line;
 
-		if (ss.str().empty())
+		if (text.empty())
 			continue;
 
-		if (ss.str() == "END_MFD")
+		if (text == "END_MFD")
 			break;
 
-		std::string id;
-		
-		if (ss >> id)
+		Tokenizer tokens(text);
+
+		switch (Tokenizer::Tag(tokens.Next()))
 		{
-			if (id == "CCFG")
-			{
-				std::string fileName;
-				std::getline(ss, fileName);
-				fileName.erase(0, 1);
+		case Tokenizer::Tag("CCFG"):
+			include(std::string(tokens.Rest()));
+			return items;
 
-				readConfig(fileName);
+		case Tokenizer::Tag("CBASE"):
+			// The configuration file a delta scenario was written against. Its cameras are loaded, then the scenario items change them.
+			data->deltaStatus = true;
+			include(std::string(tokens.Rest()));
 
-				return;
-			}
-			else if (id == "CADJ")
-				ss >> data->adj;
+			camData = &discardedCam;
+			break;
 
-			else if (id == "CPG")
-				ss >> data->page;
+		case Tokenizer::Tag("CDELTA"):
+		{
+			int delta = 0;
+			tokens.Read(delta);
 
-			else if (id == "CINF")
-				ss >> data->camInfo;
+			data->deltaStatus = delta != 0;
+			items |= MFD_Data::ITEM_DELTA;
+			break;
+		}
 
-			else if (id == "CCAM") 
-			{
-				ss >> cam;
-				data->camMap[cam] = defaultCam;
-				camData = &data->camMap.at(cam);
-			}
-			else if (id == "CLBL") 
-			{
-				std::getline(ss, camData->label);
-				camData->label.erase(0, 1);
-			}
-			else if (id == "CPOS")
-			{
-				double x, y, z;
-				ss >> x; ss >> y; ss >> z;
-				camData->pos = { x, y, z };
-			}
-			else if (id == "CPIT")
-				ss >> camData->pitchAngle;
+		case Tokenizer::Tag("CDEL"):
+		{
+			// A configuration file camera which isn't in a delta scenario
+			int deleted = 0;
+			tokens.Read(deleted);
 
-			else if (id == "CYAW")
-				ss >> camData->yawAngle;
+			auto camera = data->camMap.find(deleted);
 
-			else if (id == "CROT")
-			{
-				ss >> camData->rotAngle;
+			if (camera != data->camMap.end())
+				data->camMap.erase(camera);
 
-				if (configLoaded)
-					setCamData(cam, camData->pitchAngle, camData->yawAngle, camData->rotAngle);
-			}
+			camData = &discardedCam;
+			break;
+		}
 
-			else if (id == "CUPOS")
-			{
-				double x, y, z;
-				ss >> x; ss >> y; ss >> z;
-				camData->userPos = { x, y, z };
-			}
-			else if (id == "CUPIT")
-				ss >> camData->userPitch;
+		case Tokenizer::Tag("CADJ"):
+			tokens.Read(data->adj);
+			items |= MFD_Data::ITEM_ADJ;
+			break;
 
-			else if (id == "CUYAW")
-				ss >> camData->userYaw;
+		case Tokenizer::Tag("CPG"):
+			tokens.Read(data->page);
+			items |= MFD_Data::ITEM_PAGE;
+			break;
 
-			else if (id == "CUROT")
-			{
-				ss >> camData->userRot;
-				setCamData(cam, camData->pitchAngle + camData->userPitch, camData->yawAngle + camData->userYaw, camData->rotAngle + camData->userRot);
-			}
-			else if (id == "CFOV")
-				ss >> camData->fov;
+		case Tokenizer::Tag("CINF"):
+			tokens.Read(data->camInfo);
+			items |= MFD_Data::ITEM_INFO;
+			break;
 
-			else if (id == "CUFOV")
-				ss >> camData->userFOV;
+		case Tokenizer::Tag("CCAM"):
+			tokens.Read(cam);
 
-			else if (id == "CURCAM")
-				ss >> data->cam;
-		}
-	}
+			// A delta scenario changes the cameras loaded from the configuration file
+			if (!data->baseline || data->camMap.find(cam) == data->camMap.end())
+				addCamera(data, cam, defaultCam);
 
-	if (data->camMap.empty())
-	{
-		data->camMap[0] = defaultCam;
-		configLoaded = false;
-	}
-	else
-	{
-		loadConfig = false;
-		dataExist = true;
-	}
+			camData = &data->camMap.at(cam);
+			break;
 
-	setButtons();
-	setCustomCamera();
-}
+		case Tokenizer::Tag("CAM"):
+		{
+			// A camera in a line, as written by WriteStatus with CCOMPACT
+			int fields = 0;
 
-void Camera_MFD::WriteStatus(FILEHANDLE scn) const
-{
-	oapiWriteScenario_int(scn, "CADJ", data->adj);
-	oapiWriteScenario_int(scn, "CPG", data->page);
-	oapiWriteScenario_int(scn, "CINF", data->camInfo);
-	oapiWriteScenario_string(scn, "", "");
+			tokens.Read(cam);
+			data->camMap[cam] = defaultCam;
+			camData = &data->camMap.at(cam);
 
-	for (auto &camData : data->camMap)
-	{
-		oapiWriteScenario_int(scn, "CCAM", camData.first);
+			tokens.Read(fields);
 
-		if (!vesselControlled)
-			oapiWriteScenario_string(scn, "CLBL", _strdup(camData.second.label.c_str()));
+			VECTOR3 pos = { 0,0,0 };
+			double pitchAngle = 0, yawAngle = 0, rotAngle = 0, fov = 0;
 
-		if (configLoaded)
-		{
-			oapiWriteScenario_vec(scn, "CPOS", camData.second.pos);
-			oapiWriteScenario_float(scn, "CPIT", camData.second.pitchAngle);
-			oapiWriteScenario_float(scn, "CYAW", camData.second.yawAngle);
-			oapiWriteScenario_float(scn, "CROT", camData.second.rotAngle);
-		}
+			tokens.Read(pos.x);
+			tokens.Read(pos.y);
+			tokens.Read(pos.z);
+			tokens.Read(pitchAngle);
+			tokens.Read(yawAngle);
+			tokens.Read(rotAngle);
+			tokens.Read(fov);
 
-		oapiWriteScenario_vec(scn, "CUPOS", camData.second.userPos);
-		oapiWriteScenario_float(scn, "CUPIT", camData.second.userPitch);
-		oapiWriteScenario_float(scn, "CUYAW", camData.second.userYaw);
-		oapiWriteScenario_float(scn, "CUROT", camData.second.userRot);
+			if (fields & COMPACT_POSE)
+			{
+				camData->pos = pos;
+				camData->pitchAngle = pitchAngle;
+				camData->yawAngle = yawAngle;
+				camData->rotAngle = rotAngle;
+			}
 
-		if (vesselControlled)
-			oapiWriteScenario_float(scn, "CUFOV", camData.second.userFOV);
-		else
-			oapiWriteScenario_float(scn, "CFOV", camData.second.fov);
+			if (fields & COMPACT_LABEL_FOV)
+				camData->fov = fov;
 
-		oapiWriteScenario_string(scn, "", "");
-	}
+			tokens.Read(camData->userPos.x);
+			tokens.Read(camData->userPos.y);
+			tokens.Read(camData->userPos.z);
+			tokens.Read(camData->userPitch);
+			tokens.Read(camData->userYaw);
+			tokens.Read(camData->userRot);
+			tokens.Read(camData->userFOV);
+			tokens.Read(camData->rate);
+			tokens.Read(camData->scale);
 
-	oapiWriteScenario_int(scn, "CURCAM", data->cam);
-}
+			if (fields & COMPACT_LABEL_FOV)
+				camData->label = tokens.Rest();
 
-void Camera_MFD::readConfig(std::string fileName)
-{
-	// Set the vessel configuration file
-	std::string configFile = "CameraMFD/";
-	configFile += fileName;
-	configFile += ".cfg";
+			setCamData(*camData, camData->pitchAngle + camData->userPitch, camData->yawAngle + camData->userYaw, camData->rotAngle + camData->userRot);
+			break;
+		}
 
-	// Open the file
-	FILEHANDLE configHandle = oapiOpenFile(configFile.c_str(), FILE_IN_ZEROONFAIL, CONFIG);
+		case Tokenizer::Tag("CCOMPACT"):
+		{
+			int compact = 0;
+			tokens.Read(compact);
 
-	if (!configHandle)
-		return;
+			data->compactStatus = compact != 0;
+			items |= MFD_Data::ITEM_COMPACT;
+			break;
+		}
 
-	configLoaded = true;
+		case Tokenizer::Tag("CLBL"):
+			camData->label = tokens.Rest();
+			break;
 
-	ReadStatus(configHandle);
+		case Tokenizer::Tag("CPOS"):
+			tokens.Read(camData->pos.x);
+			tokens.Read(camData->pos.y);
+			tokens.Read(camData->pos.z);
+			break;
 
-	oapiCloseFile(configHandle, FILE_IN_ZEROONFAIL);
-}
+		case Tokenizer::Tag("CPIT"):
+			tokens.Read(camData->pitchAngle);
+			break;
 
-void Camera_MFD::setButtons()
-{
-	buttonsLabel.clear();
-	buttons.clear();
-	buttonsMenu.clear();
+		case Tokenizer::Tag("CYAW"):
+			tokens.Read(camData->yawAngle);
+			break;
 
-	auto &camData = data->camMap.at(data->cam);
+		case Tokenizer::Tag("CROT"):
+			tokens.Read(camData->rotAngle);
 
-	switch (data->adj)
-	{
-	case ADJ_ROT:
-		buttonsLabel.insert(buttonsLabel.end(), {
-			camData.userControl.changeRot ? "LFT" : " ", camData.userControl.changeRot ? "RHT" : " ",
-			" ", " ", " ", " "
-			});
-
-		buttons.insert(buttons.end(), {
-			DWORD(camData.userControl.changeRot ? OAPI_KEY_A : OAPI_KEY_ESCAPE), DWORD(camData.userControl.changeRot ? OAPI_KEY_D : OAPI_KEY_ESCAPE),
-			OAPI_KEY_ESCAPE, OAPI_KEY_ESCAPE, OAPI_KEY_ESCAPE, OAPI_KEY_ESCAPE
-			});
-
-		buttonsMenu.insert(buttonsMenu.end(), {
-			{ camData.userControl.changeRot ? "Rotate Left" : 0, 0, camData.userControl.changeRot ? 'A' : 0 },
-			{ camData.userControl.changeRot ? "Rotate Right" : 0, 0, camData.userControl.changeRot ? 'D' : 0 },
-			{ nullptr }, { nullptr }, { nullptr }, { nullptr }
-			});
+			if (configLoaded && camData != &discardedCam)
+			{
+				camData->dir = defaultCam.dir;
+				setCamData(*camData, camData->pitchAngle, camData->yawAngle, camData->rotAngle);
+			}
+			break;
 
-		break;
+		case Tokenizer::Tag("CUPOS"):
+			tokens.Read(camData->userPos.x);
+			tokens.Read(camData->userPos.y);
+			tokens.Read(camData->userPos.z);
+			break;
 
-	case ADJ_DIR:
-		buttonsLabel.insert(buttonsLabel.end(), {
-			camData.userControl.changeDir ? "LFT" : " ", camData.userControl.changeDir ? "RHT" : " ",
-			camData.userControl.changeDir ? "UP" : " ", camData.userControl.changeDir ? "DWN" : " ",
-			" ", " "
-			});
-
-		buttons.insert(buttons.end(), {
-			DWORD(camData.userControl.changeDir ? OAPI_KEY_A : OAPI_KEY_ESCAPE), DWORD(camData.userControl.changeDir ? OAPI_KEY_D : OAPI_KEY_ESCAPE),
-			DWORD(camData.userControl.changeDir ? OAPI_KEY_W : OAPI_KEY_ESCAPE), DWORD(camData.userControl.changeDir ? OAPI_KEY_S : OAPI_KEY_ESCAPE),
-			OAPI_KEY_ESCAPE, OAPI_KEY_ESCAPE
-			});
-
-		buttonsMenu.insert(buttonsMenu.end(), {
-			{ camData.userControl.changeDir ? "Look Left" : 0, 0, camData.userControl.changeDir ? 'A' : 0 },
-			{ camData.userControl.changeDir ? "Look Right" : 0, 0, camData.userControl.changeDir ? 'D' : 0 },
-			{ camData.userControl.changeDir ? "Look Up" : 0, 0, camData.userControl.changeDir ? 'W' : 0 },
-			{ camData.userControl.changeDir ? "Look Down" : 0, 0, camData.userControl.changeDir ? 'S' : 0 },
-			{ nullptr }, { nullptr }
-			});
+		case Tokenizer::Tag("CUPIT"):
+			tokens.Read(camData->userPitch);
+			break;
 
-		break;
+		case Tokenizer::Tag("CUYAW"):
+			tokens.Read(camData->userYaw);
+			break;
 
-	case ADJ_POS:
-		buttonsLabel.insert(buttonsLabel.end(), {
-			camData.userControl.changePos ? "LFT" : " ", camData.userControl.changePos ? "RHT" : " ",
-			camData.userControl.changePos ? "UP" : " ", camData.userControl.changePos ? "DWN" : " ",
-			camData.userControl.changePos ? "FWD" : " ", camData.userControl.changePos ? "BCK" : " "
-			});
-
-		buttons.insert(buttons.end(), {
-			DWORD(camData.userControl.changePos ? OAPI_KEY_A : OAPI_KEY_ESCAPE), DWORD(camData.userControl.changePos ? OAPI_KEY_D : OAPI_KEY_ESCAPE),
-			DWORD(camData.userControl.changePos ? OAPI_KEY_W : OAPI_KEY_ESCAPE), DWORD(camData.userControl.changePos ? OAPI_KEY_S : OAPI_KEY_ESCAPE),
-			DWORD(camData.userControl.changePos ? OAPI_KEY_Q : OAPI_KEY_ESCAPE), DWORD(camData.userControl.changePos ? OAPI_KEY_E : OAPI_KEY_ESCAPE)
-			});
-
-		buttonsMenu.insert(buttonsMenu.end(), {
-			{ camData.userControl.changePos ? "Move Left" : 0, 0, camData.userControl.changePos ? 'A' : 0 },
-			{ camData.userControl.changePos ? "Move Right" : 0, 0, camData.userControl.changePos ? 'D' : 0 },
-			{ camData.userControl.changePos ? "Move Up" : 0, 0, camData.userControl.changePos ? 'W' : 0 },
-			{ camData.userControl.changePos ? "Move Down" : 0, 0, camData.userControl.changePos ? 'S' : 0 },
-			{ camData.userControl.changePos ? "Move Forward" : 0, 0, camData.userControl.changePos ? 'Q' : 0 },
-			{ camData.userControl.changePos ? "Move Backward" : 0, 0, camData.userControl.changePos ? 'E' : 0 }
-			});
+		case Tokenizer::Tag("CUROT"):
+			tokens.Read(camData->userRot);
 
-		break;
-	}
+			// The direction is set from the sums, as the camera may already have the direction of its configuration file angles
+			if (camData != &discardedCam)
+			{
+				camData->dir = defaultCam.dir;
+				setCamData(*camData, camData->pitchAngle + camData->userPitch, camData->yawAngle + camData->userYaw, camData->rotAngle + camData->userRot);
+			}
+			break;
 
-	switch (data->page)
-	{
-	case 0:
-		buttonsLabel.insert(buttonsLabel.end(), {
-			camData.userControl.changeFOV ? "ZM+" : " ", camData.userControl.changeFOV ? "ZM-" : " ",
-			camData.multipleAdj ? "ADJ" : " ", vesselControlled ? " " : "LBL", "PG"
-		});
-
-		buttons.insert(buttons.end(), {
-			DWORD(camData.userControl.changeFOV ? OAPI_KEY_Z : OAPI_KEY_ESCAPE), DWORD(camData.userControl.changeFOV ? OAPI_KEY_X : OAPI_KEY_ESCAPE),
-			DWORD(camData.multipleAdj ? OAPI_KEY_J : OAPI_KEY_ESCAPE),
-			DWORD(vesselControlled ? OAPI_KEY_ESCAPE : OAPI_KEY_L), OAPI_KEY_P
-		});
-
-		buttonsMenu.insert(buttonsMenu.end(), {
-			{ camData.userControl.changeFOV ? "Zoom In" : 0, 0, camData.userControl.changeFOV ? 'Z' : 0 },
-			{ camData.userControl.changeFOV ? "Zoom Out" : 0, 0, camData.userControl.changeFOV ? 'X' : 0 },
-			{ camData.multipleAdj ? "Change Adjust Mode" : 0, 0, camData.multipleAdj ? 'J' : 0 },
-			{ vesselControlled ? 0 : "Change Label", 0, vesselControlled ? 0 : 'L' },
-			{ "Switch Page", 0, 'P' }
-		});
-
-		switch (data->adj)
+		case Tokenizer::Tag("CFOV"):
+			tokens.Read(camData->fov);
+			break;
+
+		case Tokenizer::Tag("CUFOV"):
+			tokens.Read(camData->userFOV);
+			break;
+
+		case Tokenizer::Tag("CRATE"):
+			if (camData == &discardedCam)
+			{
+				tokens.Read(data->defaultRate);
+				items |= MFD_Data::ITEM_RATE;
+			}
+			else
+				tokens.Read(camData->rate);
+			break;
+
+		case Tokenizer::Tag("CSCALE"):
+			if (camData == &discardedCam)
+			{
+				tokens.Read(data->defaultScale);
+				items |= MFD_Data::ITEM_SCALE;
+			}
+			else
+				tokens.Read(camData->scale);
+			break;
+
+		case Tokenizer::Tag("CKEY"):
 		{
-		case ADJ_ROT:
-			buttonsLabel.insert(buttonsLabel.begin() + 9, camData.userControl.changeRot ? "RST" : " ");
+			CameraKey key = {};
+
+			tokens.Read(key.time);
+			tokens.Read(key.pos.x);
+			tokens.Read(key.pos.y);
+			tokens.Read(key.pos.z);
+			tokens.Read(key.pitchAngle);
+			tokens.Read(key.yawAngle);
+			tokens.Read(key.rotAngle);
+			tokens.Read(key.fov);
+
+			camData->path.AddKey(key);
+			break;
+		}
 
-			buttons.insert(buttons.begin() + 9, DWORD(camData.userControl.changeRot ? OAPI_KEY_R : OAPI_KEY_ESCAPE));
+		case Tokenizer::Tag("CLOOP"):
+		{
+			int loop = 1;
+			tokens.Read(loop);
 
-			buttonsMenu.insert(buttonsMenu.begin() + 9, { camData.userControl.changeRot ? "Reset Camera Rotation" : 0, 0, camData.userControl.changeRot ? 'R' : 0 });
+			camData->path.SetLoop(loop != 0);
 			break;
+		}
 
-		case ADJ_DIR:
-			buttonsLabel.insert(buttonsLabel.begin() + 9, camData.userControl.changeDir ? "RST" : " ");
+		case Tokenizer::Tag("CTRACK"):
+		{
+			// The target is found by name on the first frame, as it may be created after this vessel
+			camData->targetName = tokens.Next();
+			camData->targetDock = -1;
+			camData->hTarget = nullptr;
+			tokens.Read(camData->targetDock);
+			break;
+		}
+
+		case Tokenizer::Tag("CTRKTOL"):
+			tokens.Read(data->trackTolerance);
+			items |= MFD_Data::ITEM_TRACKTOL;
+			break;
 
-			buttons.insert(buttons.begin() + 9, DWORD(camData.userControl.changeDir ? OAPI_KEY_R : OAPI_KEY_ESCAPE));
+		case Tokenizer::Tag("CPERFLOG"):
+			tokens.Read(data->perfLogInterval);
+			items |= MFD_Data::ITEM_PERFLOG;
+			break;
 
-			buttonsMenu.insert(buttonsMenu.begin() + 9, { camData.userControl.changeDir ? "Reset Camera Direction" : 0, 0, camData.userControl.changeDir ? 'R' : 0 });
+		case Tokenizer::Tag("CMINSCALE"):
+			tokens.Read(data->minScale);
+			items |= MFD_Data::ITEM_MINSCALE;
 			break;
 
-		case ADJ_POS:
-			buttonsLabel.insert(buttonsLabel.begin() + 9, camData.userControl.changePos ? "RST" : " ");
+		case Tokenizer::Tag("CLAYOUT"):
+			tokens.Read(data->layout);
+			items |= MFD_Data::ITEM_LAYOUT;
+			break;
 
-			buttons.insert(buttons.begin() + 9, DWORD(camData.userControl.changePos ? OAPI_KEY_R : OAPI_KEY_ESCAPE));
+		case Tokenizer::Tag("CMAXPARK"):
+			tokens.Read(data->maxParked);
+			items |= MFD_Data::ITEM_MAXPARK;
+			break;
+
+		case Tokenizer::Tag("CBUDGET"):
+		{
+			// In milliseconds
+			double budget = 0;
+			tokens.Read(budget);
 
-			buttonsMenu.insert(buttonsMenu.begin() + 9, { camData.userControl.changePos ? "Reset Camera Position" : 0, 0, camData.userControl.changePos ? 'R' : 0 });
+			data->frameBudget = budget / 1000;
+			items |= MFD_Data::ITEM_BUDGET;
 			break;
 		}
-		break;
 
-	case 1:
-		buttonsLabel.insert(buttonsLabel.end(), {
-			camData.userControl.selectCamera ? "CM+" : " ", camData.userControl.selectCamera ? "CM-" : " ",
-			vesselControlled ? " " : "ADD", vesselControlled ? " " : "DEL",
-			"INF", "PG"
-			});
-
-		buttons.insert(buttons.end(), {
-			DWORD(camData.userControl.selectCamera ? OAPI_KEY_C : OAPI_KEY_ESCAPE), DWORD(camData.userControl.selectCamera ? OAPI_KEY_V : OAPI_KEY_ESCAPE),
-			DWORD(vesselControlled ? OAPI_KEY_ESCAPE : OAPI_KEY_G), DWORD(vesselControlled ? OAPI_KEY_ESCAPE : OAPI_KEY_H),
-			OAPI_KEY_I, OAPI_KEY_P
-			});
-
-		buttonsMenu.insert(buttonsMenu.end(), {
-			{ camData.userControl.selectCamera ? "Next Camera" : 0, 0, camData.userControl.selectCamera ? 'C' : 0 },
-			{ camData.userControl.selectCamera ? "Previous Camera" : 0, 0, camData.userControl.selectCamera ? 'V' : 0 },
-			{ vesselControlled ? 0 : "Add Camera", 0, vesselControlled ? 0 : 'G' },
-			{ vesselControlled ? 0 : "Delete Camera", 0, vesselControlled ? 0 : 'H' },
-			{ "Change Camera Info", 0, 'I'},
-			{ "Switch Page", 0, 'P' }
-			});
-		break;
+		case Tokenizer::Tag("CURCAM"):
+			tokens.Read(data->cam);
+			items |= MFD_Data::ITEM_CAM;
+			break;
+		}
 	}
+
+	return items;
 }
 
-char *Camera_MFD::ButtonLabel(int bt)
+void Camera_MFD::ReadStatus(FILEHANDLE scn)  
 {
-	if (bt < 12)
-		return buttonsLabel[bt];
+	TRACE_ZONE("Camera_MFD::ReadStatus");
 
-	return nullptr;
-}
+	data->camMap.clear();
+	data->baseline.reset();
+	data->configFile.reset();
+	data->configCameras.reset();
+	data->configPending = false;
 
-int Camera_MFD::ButtonMenu(const MFDBUTTONMENU **menu) const
-{
-	if (menu)
-		*menu = &(buttonsMenu[0]);
+	// The defaults are of the cameras read, so they're read again with them
+	data->defaultRate = 0;
+	data->defaultScale = 1;
+
+	readItems = readLines(data, [scn](char *&line) { return oapiReadScenario_nextline(scn, line); },
+		[this](const std::string &fileName) { readConfig(fileName); }, configLoaded);
+
+	if (data->camMap.empty())
+	{
+		addCamera(data, 0, defaultCam);
+		data->baseline.reset();
+		configLoaded = false;
+	}
+	else
+	{
+		loadConfig = false;
+		dataExist = true;
+	}
+
+	validateData(data);
 
-	return buttonsMenu.size();
+	applyModuleItems();
+
+	dirty |= DIRTY_BUTTONS | DIRTY_CAMERA;
 }
 
-bool Camera_MFD::Update(oapi::Sketchpad *skp) 
+void Camera_MFD::validateData(MFD_Data *data)
 {
-	// If the vessel class is VESSEL3 or higher and MFD instance wasn't sent (can't send in the constructor because the class isn't fully constructed, will result in CTD)
-	if (!instanceSent)
-	{
-		if (data->sendInstance)
-		{
-			vesselControlled = static_cast<VESSEL3*>(oapiGetVesselInterface(data->hVessel))->clbkGeneric(CAMERA_MFD, data->mfdIndex, static_cast<CameraMFD*>(this)) == CAMERA_MFD;
+	if (data->camMap.find(data->cam) == data->camMap.end())
+		data->cam = data->camMap.begin()->first;
 
-			if (vesselControlled)
-			{
-				setButtons();
-				InvalidateButtons();
-			}
-		}
+	if (data->adj < ADJ_POS || data->adj > ADJ_ROT)
+		data->adj = ADJ_POS;
 
-		instanceSent = true;
-	}
+	if (data->page < 0 || data->page > 3)
+		data->page = 0;
 
-	if (loadConfig) {
-		if (!vesselControlled)
-			readConfig(oapiGetVesselInterface(data->hVessel)->GetClassNameA());
+	if (data->camInfo < INFO_NONE || data->camInfo > INFO_FULL)
+		data->camInfo = INFO_MIN;
 
-		loadConfig = false;
-	}
+	if (!(data->frameBudget > 0))
+		data->frameBudget = 0;
 
-	// Helper for static texts
-	auto SKPTEXT = [skp](int x, int y, const char* str) { skp->Text(x, y, str, strlen(str)); };
+	if (!(data->defaultRate > 0))
+		data->defaultRate = 0;
 
-	if (hRenderSrf && gcSketchpadVersion(skp) == 2) 
-	{
-		Sketchpad2 *skp2 = static_cast<Sketchpad2*>(skp);
+	if (!(data->defaultScale > 0 && data->defaultScale <= 1))
+		data->defaultScale = 1;
 
-		// Blit the camera view into the sketchpad.
-		RECT sr = { 0, 0, LONG(W), LONG(H) };
-		skp2->CopyRect(hRenderSrf, &sr, 0, 0);
-	}
+	if (!(data->minScale > 0 && data->minScale <= 1))
+		data->minScale = 0;
 
-	Title(skp, "Camera MFD");
+	if (data->layout < LAYOUT_SINGLE || data->layout > LAYOUT_3X3)
+		data->layout = LAYOUT_SINGLE;
 
-	// Draw a green rectangle in HUD view
-	if (oapiCockpitMode() == COCKPIT_GENERIC)
-		skp->Rectangle(0, 0, W, H);
+	if (!(data->trackTolerance >= 0))
+		data->trackTolerance = defaultTrackTolerance;
 
-	// Set the text color to green
-	skp->SetTextColor(0x00FF00);
+	if (!(data->perfLogInterval > 0))
+		data->perfLogInterval = 0;
 
-	auto &camData = data->camMap.at(data->cam);
+	if (data->maxParked < 0)
+		data->maxParked = -1;
+	else if (data->maxParked > int(MFD_Registry::parkLimit))
+		data->maxParked = int(MFD_Registry::parkLimit);
 
-	switch (data->camInfo)
-	{
-	case INFO_NONE:
-		break;
-	case INFO_FULL: 
+	for (auto &&camData : data->camMap)
 	{
-		skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::BOTTOM);
+		if (!(camData.second.rate > 0))
+			camData.second.rate = 0;
 
-		char buffer[256];
+		if (!(camData.second.scale > 0 && camData.second.scale <= 1))
+			camData.second.scale = 1;
 
-		switch (data->adj) 
-		{
-		case ADJ_POS:
-			sprintf_s(buffer, 256, "X: %g", camData.userPos.x);
-			SKPTEXT(5, H - 60, buffer);
+		if (camData.second.targetDock < -1)
+			camData.second.targetDock = -1;
+	}
+}
 
-			sprintf_s(buffer, 256, "Y: %g", camData.userPos.y);
-			SKPTEXT(5, H - 40, buffer);
+void Camera_MFD::applyModuleItems()
+{
+	if (data->perfLogInterval > 0 && !perfLog)
+		StartPerfLog(data->perfLogInterval);
 
-			sprintf_s(buffer, 256, "Z: %g", camData.userPos.z);
-			SKPTEXT(5, H - 20, buffer);
+	if (data->maxParked >= 0)
+		mfdRegistry.SetMaxParked(data->maxParked);
+}
 
-			break;
-		case ADJ_DIR:
-			sprintf_s(buffer, 256, "Pitch: %g", camData.userPitch);
-			SKPTEXT(5, H - 40, buffer);
+void Camera_MFD::WriteStatus(FILEHANDLE scn) const
+{
+	TRACE_ZONE("Camera_MFD::WriteStatus");
 
-			sprintf_s(buffer, 256, "Yaw: %g", camData.userYaw);
-			SKPTEXT(5, H - 20, buffer);
+	// In the delta mode, the configuration file is loaded first and the items after it change its data
+	const ConfigBaseline *baseline = data->deltaStatus && configLoaded && !vesselControlled ? data->baseline.get() : nullptr;
 
-			break;
-		case ADJ_ROT:
-			sprintf_s(buffer, 256, "Rotation: %g", camData.userRot);
-			SKPTEXT(5, H - 20, buffer);
+	if (baseline)
+		oapiWriteScenario_string(scn, "CBASE", const_cast<char*>(baseline->fileName.c_str()));
 
-			break;
-		}
-	}
-	case INFO_MIN:
-		skp->SetTextAlign(oapi::Sketchpad::RIGHT, oapi::Sketchpad::TOP);
-		SKPTEXT(W - 5, 0, camData.label.c_str());
+	oapiWriteScenario_int(scn, "CADJ", data->adj);
+	oapiWriteScenario_int(scn, "CPG", data->page);
+	oapiWriteScenario_int(scn, "CINF", data->camInfo);
 
-		// Display the camera FOV if it can be changed by user
-		if (camData.userControl.changeFOV) 
-		{
-			skp->SetTextAlign(oapi::Sketchpad::RIGHT, oapi::Sketchpad::BASELINE);
+	if (data->frameBudget > 0)
+		oapiWriteScenario_float(scn, "CBUDGET", data->frameBudget * 1000);
 
-			char buffer[256];
-			sprintf_s(buffer, 256, "FOV: %g", camData.fov + camData.userFOV);
-			SKPTEXT(W - 5, H - 5, buffer);
-		}
+	// Before the cameras, so they're read as the MFD defaults
+	if (data->defaultRate > 0)
+		oapiWriteScenario_float(scn, "CRATE", data->defaultRate);
 
-		// Display the camera adjust mode if the user can contorl any mode
-		if (camData.userControl.changePos || camData.userControl.changeDir || camData.userControl.changeRot) 
-		{
-			// Set text alignment
-			skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::BASELINE);
+	if (data->defaultScale < 1)
+		oapiWriteScenario_float(scn, "CSCALE", data->defaultScale);
 
-			// Set the adjust mode text
-			switch (data->adj)
-			{
-			case ADJ_POS:
-				SKPTEXT(5, H - 5, "Position");
-				break;
-			case ADJ_DIR:
-				SKPTEXT(5, H - 5, "Direction");
-				break;
-			case ADJ_ROT:
-				SKPTEXT(5, H - 5, "Rotation");
-				break;
-			}
-		}
-		break;
-	}
+	if (data->minScale > 0)
+		oapiWriteScenario_float(scn, "CMINSCALE", data->minScale);
 
-	skp->SetTextAlign(oapi::Sketchpad::CENTER, oapi::Sketchpad::BASELINE);
+	if (data->layout != LAYOUT_SINGLE)
+		oapiWriteScenario_int(scn, "CLAYOUT", data->layout);
 
-	if (!hCamera)
-		SKPTEXT(W / 2, H / 2, "Custom Camera Interface Disabled");
+	if (data->trackTolerance != defaultTrackTolerance)
+		oapiWriteScenario_float(scn, "CTRKTOL", data->trackTolerance);
 
-	else if (!gcEnabled())
-		SKPTEXT(W / 2, H / 2, "No Graphics Client");
+	if (data->perfLogInterval > 0)
+		oapiWriteScenario_float(scn, "CPERFLOG", data->perfLogInterval);
 
-	else if (gcSketchpadVersion(skp) != 2)
-		SKPTEXT(W / 2, H / 2, "Sketchpad Not in DirectX mode");
+	if (data->maxParked >= 0)
+		oapiWriteScenario_int(scn, "CMAXPARK", data->maxParked);
 
-	return true;
-}
+	if (data->compactStatus)
+		oapiWriteScenario_int(scn, "CCOMPACT", 1);
 
-bool Camera_MFD::ConsumeButton(int bt, int event)
-{
-	if (event & PANEL_MOUSE_LBDOWN) 
-	{
-		ignoreImmediateMouse = 0;
+	oapiWriteScenario_string(scn, "", "");
 
-		if (bt < 12 && buttons[bt] != OAPI_KEY_ESCAPE)
-			return ConsumeKeyBuffered(buttons[bt]);
+	if (!baseline)
+	{
+		for (const auto &camData : data->camMap)
+			writeCamera(scn, camData.first, camData.second, nullptr);
 	}
-	else if (event & PANEL_MOUSE_LBPRESSED) 
+	else
 	{
-		if (ignoreImmediateMouse < 15) 
+		// The configuration file cameras which were deleted
+		for (const auto &camData : baseline->camMap)
+			if (data->camMap.find(camData.first) == data->camMap.end())
+				oapiWriteScenario_int(scn, "CDEL", camData.first);
+
+		for (const auto &camData : data->camMap)
 		{
-			ignoreImmediateMouse++;
-			return false;
+			auto base = baseline->camMap.find(camData.first);
+			writeCamera(scn, camData.first, camData.second, base == baseline->camMap.end() ? nullptr : &base->second);
 		}
-
-		if (bt < (data->page == 0 ? 8 : 6) && buttons[bt] != OAPI_KEY_ESCAPE)
-			return ConsumeKeyBuffered(buttons[bt]);
 	}
 
-	return false;
+	oapiWriteScenario_int(scn, "CURCAM", data->cam);
 }
 
-bool Camera_MFD::ConsumeKeyImmediate(char *kstate)
+void Camera_MFD::writeCamera(FILEHANDLE scn, int id, const InternalData &cam, const InternalData *base) const
 {
-	if (ignoreImmediateKey < 15)
-	{
-		ignoreImmediateKey++;
-		return false;
-	}
+	auto differs = [](const VECTOR3 &a, const VECTOR3 &b) { return a.x != b.x || a.y != b.y || a.z != b.z; };
 
-	for (int button = 0; button < (data->page == 0 ? 8 : 6); button++)
+	auto samePath = [](const CameraPath &a, const CameraPath &b)
 	{
-		if (KEYDOWN(kstate, buttons[button]) && buttons[button] != OAPI_KEY_ESCAPE)
+		if (a.GetKeyCount() != b.GetKeyCount() || a.GetLoop() != b.GetLoop())
+			return false;
+
+		for (size_t index = 0; index < a.GetKeyCount(); index++)
 		{
-			immediateCall = true;
-			return ConsumeKeyBuffered(buttons[button]);
-		}
-	}
+			CameraKey first = a.GetKey(index), second = b.GetKey(index);
 
-	return false;
-}
+			if (first.time != second.time || first.pos.x != second.pos.x || first.pos.y != second.pos.y || first.pos.z != second.pos.z ||
+				first.pitchAngle != second.pitchAngle || first.yawAngle != second.yawAngle || first.rotAngle != second.rotAngle || first.fov != second.fov)
+				return false;
+		}
 
-bool Camera_MFD::ConsumeKeyBuffered(DWORD key)
-{
-	if (immediateCall)
-		immediateCall = false;
+		return true;
+	};
 
-	else if (ignoreImmediateKey > 0)
+	if (base)
 	{
-		if (ignoreImmediateKey >= 15) 
+		// The items only add to the baseline camera, so a changed path or target is written with the whole camera instead
+		if (samePath(cam.path, base->path) && cam.targetName == base->targetName && cam.targetDock == base->targetDock)
 		{
-			ignoreImmediateKey = 0;
-			return false;
-		}	
+			bool baseAngles = cam.pitchAngle != base->pitchAngle || cam.yawAngle != base->yawAngle || cam.rotAngle != base->rotAngle;
+			bool userAngles = cam.userPitch != base->userPitch || cam.userYaw != base->userYaw || cam.userRot != base->userRot;
 
-		ignoreImmediateKey = 0;
-	}
+			bool changed = cam.label != base->label || differs(cam.pos, base->pos) || baseAngles || userAngles || differs(cam.userPos, base->userPos) ||
+				cam.fov != base->fov || cam.userFOV != base->userFOV || cam.rate != base->rate || cam.scale != base->scale;
 
-	switch (key)
-	{
-	case OAPI_KEY_A:
-		moveCamLeft();
-		setCustomCamera();
-		break;
+			if (!changed)
+				return;
 
-	case OAPI_KEY_D:
-		moveCamRight();
-		setCustomCamera();
-		break;
+			oapiWriteScenario_int(scn, "CCAM", id);
 
-	case OAPI_KEY_W:
-		moveCamUp();
-		setCustomCamera();
-		break;
+			if (cam.label != base->label)
+				oapiWriteScenario_string(scn, "CLBL", const_cast<char*>(cam.label.c_str()));
 
-	case OAPI_KEY_S:
-		moveCamDown();
-		setCustomCamera();
-		break;
+			if (differs(cam.pos, base->pos))
+				oapiWriteScenario_vec(scn, "CPOS", cam.pos);
 
-	case OAPI_KEY_Q:
-		moveCamForward();
-		setCustomCamera();
-		break;
+			if (differs(cam.userPos, base->userPos))
+				oapiWriteScenario_vec(scn, "CUPOS", cam.userPos);
 
-	case OAPI_KEY_E:
-		moveCamBackward();
-		setCustomCamera();
-		break;
+			// The direction is set again when CUROT is read
+			if (baseAngles || userAngles)
+			{
+				oapiWriteScenario_float(scn, "CPIT", cam.pitchAngle);
+				oapiWriteScenario_float(scn, "CYAW", cam.yawAngle);
+				oapiWriteScenario_float(scn, "CROT", cam.rotAngle);
+				oapiWriteScenario_float(scn, "CUPIT", cam.userPitch);
+				oapiWriteScenario_float(scn, "CUYAW", cam.userYaw);
+				oapiWriteScenario_float(scn, "CUROT", cam.userRot);
+			}
 
-	case OAPI_KEY_Z:
-	{
-		if (data->page == 1)
-			return false;
+			if (cam.fov != base->fov)
+				oapiWriteScenario_float(scn, "CFOV", cam.fov);
 
-		auto &camData = data->camMap.at(data->cam);
+			if (cam.userFOV != base->userFOV)
+				oapiWriteScenario_float(scn, "CUFOV", cam.userFOV);
 
-		if (camData.userFOV + camData.fov <= 0.5)
-			return false;
+			if (cam.rate != base->rate)
+				oapiWriteScenario_float(scn, "CRATE", cam.rate);
 
-		vesselControlled ? camData.userFOV -= 0.5 : camData.fov -= 0.5;
+			if (cam.scale != base->scale)
+				oapiWriteScenario_float(scn, "CSCALE", cam.scale);
 
-		setCustomCamera();
-		break;
+			if (!data->compactStatus)
+				oapiWriteScenario_string(scn, "", "");
+
+			return;
+		}
+
+		oapiWriteScenario_int(scn, "CDEL", id);
 	}
-	case OAPI_KEY_X:
+
+	// The fields which are written as the separate items would be
+	int fields = (configLoaded ? COMPACT_POSE : 0) | (vesselControlled ? 0 : COMPACT_LABEL_FOV);
+
+	if (data->compactStatus)
 	{
-		if (data->page == 1)
-			return false;
+		// A line per camera, formatted on the stack. The numbers are in their shortest form which reads back exactly.
+		const double values[] = { cam.pos.x, cam.pos.y, cam.pos.z, cam.pitchAngle, cam.yawAngle, cam.rotAngle, cam.fov,
+			cam.userPos.x, cam.userPos.y, cam.userPos.z, cam.userPitch, cam.userYaw, cam.userRot, cam.userFOV, cam.rate, cam.scale };
 
-		auto &camData = data->camMap.at(data->cam);
+		char buffer[1024];
+		char *end = buffer + sizeof(buffer) - 1;
 
-		if (camData.userFOV + camData.fov >= 80)
-			return false;
+		char *next = std::to_chars(buffer, end, id).ptr;
+		*next++ = ' ';
+		next = std::to_chars(next, end, fields).ptr;
 
-		vesselControlled ? camData.userFOV += 0.5 : camData.fov += 0.5;
+		for (double value : values)
+		{
+			*next++ = ' ';
+			next = std::to_chars(next, end, value).ptr;
+		}
 
-		setCustomCamera();
-		break;
+		if (fields & COMPACT_LABEL_FOV)
+		{
+			size_t length = (std::min)(cam.label.size(), size_t(end - next - 1));
+
+			*next++ = ' ';
+			next = std::copy_n(cam.label.data(), length, next);
+		}
+
+		*next = '\0';
+
+		oapiWriteScenario_string(scn, "CAM", buffer);
 	}
-	case OAPI_KEY_J:
+	else
 	{
-		auto &userControl = data->camMap.at(data->cam).userControl;
+		oapiWriteScenario_int(scn, "CCAM", id);
 
-		while (true)
+		if (!vesselControlled)
+			oapiWriteScenario_string(scn, "CLBL", const_cast<char*>(cam.label.c_str()));
+
+		if (configLoaded)
 		{
-			// Change the adjust mode
-			data->adj >= ADJ_ROT ? data->adj = ADJ_POS : data->adj++;
+			oapiWriteScenario_vec(scn, "CPOS", cam.pos);
+			oapiWriteScenario_float(scn, "CPIT", cam.pitchAngle);
+			oapiWriteScenario_float(scn, "CYAW", cam.yawAngle);
+			oapiWriteScenario_float(scn, "CROT", cam.rotAngle);
+		}
 
-			// If the new adjust mode is allowed to change by user
-			if ((data->adj == ADJ_POS && userControl.changePos) || (data->adj == ADJ_DIR && userControl.changeDir) || (data->adj == ADJ_ROT && userControl.changeRot))
-				break;
+		oapiWriteScenario_vec(scn, "CUPOS", cam.userPos);
+		oapiWriteScenario_float(scn, "CUPIT", cam.userPitch);
+		oapiWriteScenario_float(scn, "CUYAW", cam.userYaw);
+		oapiWriteScenario_float(scn, "CUROT", cam.userRot);
+
+		if (vesselControlled)
+			oapiWriteScenario_float(scn, "CUFOV", cam.userFOV);
+		else
+			oapiWriteScenario_float(scn, "CFOV", cam.fov);
+
+		// The cameras take the MFD defaults when they're read
+		if (cam.rate != data->defaultRate)
+			oapiWriteScenario_float(scn, "CRATE", cam.rate);
+
+		if (cam.scale != data->defaultScale)
+			oapiWriteScenario_float(scn, "CSCALE", cam.scale);
+	}
+
+	// The path is a part of the camera data, so it's written with it
+	if (configLoaded && !cam.path.Empty())
+	{
+		const CameraPath &path = cam.path;
+
+		for (size_t index = 0; index < path.GetKeyCount(); index++)
+		{
+			CameraKey key = path.GetKey(index);
+
+			char buffer[256];
+			sprintf_s(buffer, 256, "%g %g %g %g %g %g %g %g", key.time, key.pos.x, key.pos.y, key.pos.z, key.pitchAngle, key.yawAngle, key.rotAngle, key.fov);
+			oapiWriteScenario_string(scn, "CKEY", buffer);
 		}
 
-		setButtons();
-		InvalidateButtons();
-		break;
+		if (!path.GetLoop())
+			oapiWriteScenario_int(scn, "CLOOP", 0);
 	}
-	case OAPI_KEY_R:
-		resetCam();
-		setCustomCamera();
-		break;
 
-	case OAPI_KEY_L:
-		oapiOpenInputBox("Enter Camera Label:", LblClbk, _strdup(data->camMap.at(data->cam).label.c_str()), 20, this);
-		break;
+	if (!cam.targetName.empty())
+	{
+		char buffer[256];
 
-	case OAPI_KEY_P:
-		data->page >= 1 ? data->page = 0 : data->page = 1;
+		if (cam.targetDock >= 0)
+			sprintf_s(buffer, 256, "%s %d", cam.targetName.c_str(), cam.targetDock);
+		else
+			sprintf_s(buffer, 256, "%s", cam.targetName.c_str());
 
-		setButtons();
-		InvalidateButtons();
-		break;
+		oapiWriteScenario_string(scn, "CTRACK", buffer);
+	}
 
-	case OAPI_KEY_C:
+	if (!data->compactStatus)
+		oapiWriteScenario_string(scn, "", "");
+}
+
+void Camera_MFD::readConfig(std::string fileName)
+{
+	TRACE_ZONE("Camera_MFD::readConfig");
+
+	// Set the vessel configuration file
+	std::string configFile = "CameraMFD/";
+	configFile += fileName;
+	configFile += ".cfg";
+
+	PerfTimer timer;
+
+	// The outer file is watched with the files its CCFG items read
+	if (configDepth == 0)
+		configSources.clear();
+
+	// Load the compiled cache if it's up to date with the file
+	if (ConfigCache::Load(configFile, data))
 	{
-		auto &nextCam = data->camMap.upper_bound(data->cam);
+		configLoaded = true;
+		loadConfig = false;
+		dataExist = true;
 
-		if (nextCam == data->camMap.end())
-			return false;
+		dirty |= DIRTY_BUTTONS | DIRTY_CAMERA;
 
-		data->cam = nextCam->first;
+		applyModuleItems();
 
-		setButtons();
-		InvalidateButtons();
-		setCustomCamera();
-		break;
+		if (data->deltaStatus)
+			data->baseline = makeBaseline(fileName, data->camMap);
+
+		configSources.push_back(fileName);
+
+		if (configDepth == 0)
+			watchConfig(fileName);
+
+		data->perf.configReads++;
+		data->perf.configTime += timer.Elapsed();
+
+		return;
 	}
-	case OAPI_KEY_V:
+
+	// Open the file
+	FILEHANDLE configHandle = oapiOpenFile(configFile.c_str(), FILE_IN_ZEROONFAIL, CONFIG);
+
+	if (!configHandle)
+		return;
+
+	configLoaded = true;
+
+	int configRead = ++configReads;
+
+	configDepth++;
+	ReadStatus(configHandle);
+	configDepth--;
+
+	oapiCloseFile(configHandle, FILE_IN_ZEROONFAIL);
+
+	// Compile the file into the cache, unless it loaded another file (CCFG) which has its own cache
+	if (configLoaded && configRead == configReads)
+		ConfigCache::Save(configFile, data, readItems);
+
+	// Keep the loaded cameras, which the delta scenario is written against
+	if (configLoaded && data->deltaStatus)
+		data->baseline = makeBaseline(fileName, data->camMap);
+
+	if (configLoaded)
 	{
-		auto &prevCam = data->camMap.lower_bound(data->cam);
-		prevCam--;
+		configSources.push_back(fileName);
 
-		if (prevCam == data->camMap.end())
+		if (configDepth == 0)
+			watchConfig(fileName);
+	}
+
+	data->perf.configReads++;
+	data->perf.configTime += timer.Elapsed();
+}
+
+void Camera_MFD::watchConfig(const std::string &fileName)
+{
+	if (!configWatcher)
+		configWatcher = std::make_unique<ConfigWatcher>(LoadConfig);
+
+	data->configFile = configWatcher->Watch(fileName, configSources);
+	data->configVersion = data->configFile->GetVersion();
+	data->configCameras = makeBaseline(fileName, data->camMap);
+	data->configPending = false;
+}
+
+void Camera_MFD::requestConfig(const std::string &fileName)
+{
+	if (!configWatcher)
+		configWatcher = std::make_unique<ConfigWatcher>(LoadConfig);
+
+	data->configFile = configWatcher->Load(fileName);
+	data->configVersion = 0;
+	data->configPending = true;
+}
+
+void Camera_MFD::PreloadConfigs()
+{
+	if (!configWatcher)
+		configWatcher = std::make_unique<ConfigWatcher>(LoadConfig);
+
+	for (DWORD index = 0; index < oapiGetVesselCount(); index++)
+	{
+		const char *className = oapiGetVesselInterface(oapiGetVesselByIndex(index))->GetClassNameA();
+
+		if (className)
+			configWatcher->Load(className);
+	}
+}
+
+void Camera_MFD::StopConfigWatcher()
+{
+	configWatcher.reset();
+}
+
+std::shared_ptr<const ConfigBaseline> Camera_MFD::LoadConfig(const std::string &fileName)
+{
+	TRACE_ZONE("Camera_MFD::LoadConfig");
+
+	std::string configFile = "CameraMFD/" + fileName + ".cfg";
+
+	auto config = std::make_shared<ConfigBaseline>();
+	config->fileName = fileName;
+
+	MFD_Data &items = config->items;
+
+	if (ConfigCache::Load(configFile, &items, &config->readItems))
+		config->sources.push_back(fileName);
+	else
+	{
+		config->readItems = parseConfig(fileName, &items, 0, config->sources);
+
+		// Compile the file into the cache, unless it loaded another file (CCFG) which has its own cache
+		if (config->sources.size() == 1 && !items.camMap.empty())
+			ConfigCache::Save(configFile, &items, config->readItems);
+	}
+
+	if (items.camMap.empty())
+		return nullptr;
+
+	validateData(&items);
+	config->camMap = std::move(items.camMap);
+
+	return config;
+}
+
+int Camera_MFD::parseConfig(const std::string &fileName, MFD_Data *data, int depth, std::vector<std::string> &sources)
+{
+	std::ifstream file(ConfigCache::GetSourcePath("CameraMFD/" + fileName + ".cfg"));
+
+	if (!file)
+		return 0;
+
+	data->camMap.clear();
+	sources.push_back(fileName);
+
+	int readItems = 0;
+
+	const bool configLoaded = true;
+	std::string buffer;
+
+	// The lines are trimmed as oapiReadScenario_nextline trims them
+	auto nextLine = [&](char *&line)
+	{
+		if (!std::getline(file, buffer))
 			return false;
 
-		data->cam = prevCam->first;
+		size_t end = buffer.find_last_not_of(" \t\r");
+		buffer.erase(end == std::string::npos ? 0 : end + 1);
 
-		setButtons();
-		InvalidateButtons();
-		setCustomCamera();
-		break;
+		line = &buffer[(std::min)(buffer.find_first_not_of(" \t"), buffer.size())];
+		return true;
+	};
+
+	readItems |= readLines(data, nextLine, [&](const std::string &include)
+	{
+		if (depth < maxIncludes)
+			readItems |= parseConfig(include, data, depth + 1, sources);
+	}, configLoaded);
+
+	return readItems;
+}
+
+void Camera_MFD::adoptConfig()
+{
+	TRACE_ZONE("Camera_MFD::adoptConfig");
+
+	data->configVersion = data->configFile->GetVersion();
+	std::shared_ptr<const ConfigBaseline> snapshot = data->configFile->GetSnapshot();
+
+	if (!snapshot || vesselControlled)
+		return;
+
+	// The first load replaces the default camera, and sets the MFD items as reading the file would
+	if (data->configPending)
+	{
+		PerfTimer timer;
+
+		data->camMap = snapshot->camMap;
+		copyItems(snapshot->items, data, snapshot->readItems);
+		validateData(data);
+
+		data->configCameras = snapshot;
+		data->configPending = false;
+		configLoaded = true;
+		dataExist = true;
+
+		if (data->deltaStatus)
+			data->baseline = snapshot;
+
+		applyModuleItems();
+
+		dirty |= DIRTY_BUTTONS | DIRTY_CAMERA;
+
+		data->perf.configReads++;
+		data->perf.configTime += timer.Elapsed();
+
+		return;
 	}
-	case OAPI_KEY_G:
+
+	for (const auto &camera : snapshot->camMap)
+	{
+		// The cameras added to the file
+		if (data->camMap.find(camera.first) == data->camMap.end())
+		{
+			data->camMap[camera.first] = camera.second;
+			continue;
+		}
+
+		InternalData &camData = data->camMap.at(camera.first);
+		const InternalData &base = camera.second;
+
+		// The file data replaces the camera data, except the user offsets
+		camData.label = base.label;
+		camData.pos = base.pos;
+		camData.pitchAngle = base.pitchAngle;
+		camData.yawAngle = base.yawAngle;
+		camData.rotAngle = base.rotAngle;
+		camData.fov = base.fov;
+		camData.userControl = base.userControl;
+		camData.multipleAdj = base.multipleAdj;
+		camData.rate = base.rate;
+		camData.scale = base.scale;
+		camData.path = base.path;
+
+		// A changed target is found by name on the next frame, as when the file is read
+		if (camData.targetName != base.targetName || camData.targetDock != base.targetDock)
+		{
+			camData.targetName = base.targetName;
+			camData.targetDock = base.targetDock;
+			camData.hTarget = nullptr;
+			overlay.target.Reset();
+		}
+
+		// Point a tracking camera at its target again, from the new position
+		camData.aimDir = { 0,0,0 };
+
+		camData.dir = defaultCam.dir;
+		setCamData(camData, camData.pitchAngle + camData.userPitch, camData.yawAngle + camData.userYaw, camData.rotAngle + camData.userRot);
+	}
+
+	// The cameras deleted from the file. The cameras the MFD added, which were never in the file, are kept.
+	if (data->configCameras)
 	{
-		int addedCam = data->camMap.rbegin()->first + 1;
+		for (const auto &camera : data->configCameras->camMap)
+		{
+			auto deleted = data->camMap.find(camera.first);
 
-		if (AddCamera(addedCam))
-			data->cam = addedCam;
+			if (deleted != data->camMap.end() && snapshot->camMap.find(camera.first) == snapshot->camMap.end())
+				data->camMap.erase(deleted);
+		}
+	}
 
-		setCustomCamera();
-		break;
+	// If the current camera was deleted, switch to the nearest camera
+	if (data->camMap.find(data->cam) == data->camMap.end())
+	{
+		auto next = data->camMap.lower_bound(data->cam);
+		auto prev = next;
+		prev--;
+
+		// The previous camera is the end iterator if there's none
+		if (next == data->camMap.end() || (prev != data->camMap.end() && data->cam - prev->first <= next->first - data->cam))
+			next = prev;
+
+		data->cam = next->first;
 	}
-	case OAPI_KEY_H:
-		DeleteCamera(data->cam);
+
+	data->configCameras = snapshot;
+
+	// The delta scenario is written against the file as it's now
+	if (data->deltaStatus)
+		data->baseline = snapshot;
+
+	dirty |= DIRTY_BUTTONS | DIRTY_CAMERA;
+}
+
+void Camera_MFD::setButtons()
+{
+	TRACE_ZONE("Camera_MFD::setButtons");
+
+	auto &camData = data->camMap.at(data->cam);
+	auto &userControl = camData.userControl;
+
+	// The layout is selected from the compile time tables by the state the buttons depend on
+	bool adjust = data->adj == ADJ_POS ? userControl.changePos : data->adj == ADJ_DIR ? userControl.changeDir : userControl.changeRot;
+	int state = 0;
+
+	switch (data->page)
+	{
+	case 0:
+		state = userControl.changeFOV | camData.multipleAdj << 1 | vesselControlled << 2;
+		break;
+
+	case 1:
+		state = userControl.selectCamera | vesselControlled << 1;
 		break;
 
-	case OAPI_KEY_I:
-		data->camInfo >= INFO_FULL ? data->camInfo = INFO_NONE : data->camInfo++;
-		break;
+	case 2:
+		state = (capture != nullptr) | (captureFormat + vesselControlled * FrameCapture::FORMAT_COUNT) << 1;
+		break;
+	}
+
+	buttonLayout = &ButtonLayouts::Get(data->page, data->adj, adjust, state);
+	data->perf.buttonRebuilds++;
+}
+
+char *Camera_MFD::ButtonLabel(int bt)
+{
+	if (bt < 12)
+		return const_cast<char*>(buttonLayout->labels[bt]);
+
+	return nullptr;
+}
+
+int Camera_MFD::ButtonMenu(const MFDBUTTONMENU **menu) const
+{
+	if (menu)
+		*menu = buttonLayout->menu;
+
+	return 12;
+}
+
+bool Camera_MFD::Update(oapi::Sketchpad *skp) 
+{
+	TRACE_ZONE("Camera_MFD::Update");
+	PerfTimer timer;
+
+	// If the vessel class is VESSEL3 or higher and MFD instance wasn't sent (can't send in the constructor because the class isn't fully constructed, will result in CTD)
+	if (!instanceSent)
+	{
+		if (data->sendInstance)
+		{
+			vesselControlled = static_cast<VESSEL3*>(oapiGetVesselInterface(data->hVessel))->clbkGeneric(CAMERA_MFD, data->mfdIndex, static_cast<CameraMFD*>(this)) == CAMERA_MFD;
+
+			if (vesselControlled)
+				dirty |= DIRTY_BUTTONS;
+		}
+
+		instanceSent = true;
+	}
+
+	// The configuration file load is requested when the MFD is constructed, but the vessel may take control of the MFD in the first update
+	if (loadConfig) {
+		if (vesselControlled)
+		{
+			data->configFile.reset();
+			data->configPending = false;
+		}
+		else if (!data->configPending)
+			requestConfig(oapiGetVesselInterface(data->hVessel)->GetClassNameA());
+
+		loadConfig = false;
+	}
+
+	// Adopt the configuration file once the watcher loaded it, or parsed it again
+	if (data->configFile && data->configFile->GetVersion() != data->configVersion)
+		adoptConfig();
+
+	commitChanges();
+
+	// Helper for texts. The lengths of the literals are known at compile time, and the others are kept with the texts.
+	auto SKPTEXT = [skp](int x, int y, std::string_view str) { skp->Text(x, y, str.data(), int(str.size())); };
+
+	// Blits a camera view into its tile, stretched if it's rendered at a lower resolution
+	auto blitTile = [this, skp](SURFHANDLE hSurf, DWORD width, DWORD height, RECT tr)
+	{
+		data->perf.blits++;
+
+		Sketchpad2 *skp2 = static_cast<Sketchpad2*>(skp);
+		RECT sr = { 0, 0, LONG(width), LONG(height) };
+
+		if (LONG(width) == tr.right - tr.left && LONG(height) == tr.bottom - tr.top)
+			skp2->CopyRect(hSurf, &sr, tr.left, tr.top);
+		else
+			skp2->StretchRect(hSurf, &sr, &tr);
+	};
+
+	if (data->hRenderSrf && gcSketchpadVersion(skp) == 2) 
+	{
+		blitTile(data->hRenderSrf, data->srfWidth, data->srfHeight, tileRect(0));
+
+		for (size_t tile = 0; tile < data->tiles.size(); tile++)
+		{
+			auto &tileData = data->tiles[tile];
+			RECT tr = tileRect(int(tile) + 1);
+
+			blitTile(tileData.hSurf, tileData.width, tileData.height, tr);
+			skp->Rectangle(tr.left, tr.top, tr.right, tr.bottom);
+		}
+	}
+
+	Title(skp, "Camera MFD");
+
+	// Draw a green rectangle in HUD view
+	if (oapiCockpitMode() == COCKPIT_GENERIC)
+		skp->Rectangle(0, 0, W, H);
+
+	// Set the text color to green
+	skp->SetTextColor(0x00FF00);
+
+	// Display the tiles camera labels
+	if (data->camInfo != INFO_NONE && !data->tiles.empty())
+	{
+		skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::TOP);
+
+		for (size_t tile = 0; tile < data->tiles.size(); tile++)
+		{
+			// The camera may be deleted by a batch which isn't applied yet
+			auto tileCam = data->camMap.find(data->tiles[tile].cam);
+
+			if (tileCam != data->camMap.end())
+			{
+				RECT tr = tileRect(int(tile) + 1);
+				SKPTEXT(tr.left + 5, tr.top, tileCam->second.label);
+			}
+		}
+	}
+
+	// Display the capture state
+	if (capture)
+	{
+		skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::TOP);
+
+		char buffer[128];
+		FrameCapture::Stats stats = capture->GetStats();
+		int length;
+
+		if (data->camInfo == INFO_FULL)
+			length = sprintf_s(buffer, 128, "REC %s: %zu, %zu dropped, queue %zu%s", FrameCapture::FormatName(capture->GetFormat()),
+				stats.captured, stats.dropped, stats.queueDepth, stats.failed ? ", failed" : "");
+		else
+			length = sprintf_s(buffer, 128, "REC %s", FrameCapture::FormatName(capture->GetFormat()));
+
+		SKPTEXT(5, 20, std::string_view(buffer, length < 0 ? 0 : (std::min)(length, 127)));
+	}
+
+	if (data->page == 3)
+		drawDiagnostics(skp);
+
+	auto &camData = data->camMap.at(data->cam);
+
+	switch (data->camInfo)
+	{
+	case INFO_NONE:
+		break;
+	case INFO_FULL: 
+	{
+		skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::BOTTOM);
+
+		// The texts are formatted again only when their values change
+		// Display the render resolution
+		if (data->hRenderSrf)
+		{
+			skp->SetTextAlign(oapi::Sketchpad::RIGHT, oapi::Sketchpad::TOP);
+
+			overlay.resolution.Set(double(data->srfWidth) * 65536 + data->srfHeight, "%lux%lu", (unsigned long)data->srfWidth, (unsigned long)data->srfHeight);
+			SKPTEXT(W - 5, 20, overlay.resolution);
+
+			skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::BOTTOM);
+		}
+
+		// Display the tracked target
+		if (camData.hTarget)
+		{
+			skp->SetTextAlign(oapi::Sketchpad::RIGHT, oapi::Sketchpad::TOP);
+
+			overlay.target.Set(data->cam, "Tracking %s", camData.targetName.c_str());
+			SKPTEXT(W - 5, 40, overlay.target);
+
+			skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::BOTTOM);
+		}
+
+		switch (data->adj) 
+		{
+		case ADJ_POS:
+			overlay.pos[0].Set("X: %g", camData.userPos.x);
+			SKPTEXT(5, H - 60, overlay.pos[0]);
+
+			overlay.pos[1].Set("Y: %g", camData.userPos.y);
+			SKPTEXT(5, H - 40, overlay.pos[1]);
+
+			overlay.pos[2].Set("Z: %g", camData.userPos.z);
+			SKPTEXT(5, H - 20, overlay.pos[2]);
+
+			break;
+		case ADJ_DIR:
+			overlay.pitch.Set("Pitch: %g\xB0", camData.userPitch);
+			SKPTEXT(5, H - 40, overlay.pitch);
+
+			overlay.yaw.Set("Yaw: %g\xB0", camData.userYaw);
+			SKPTEXT(5, H - 20, overlay.yaw);
+
+			break;
+		case ADJ_ROT:
+			overlay.rot.Set("Rotation: %g\xB0", camData.userRot);
+			SKPTEXT(5, H - 20, overlay.rot);
+
+			break;
+		}
+	}
+	case INFO_MIN:
+		skp->SetTextAlign(oapi::Sketchpad::RIGHT, oapi::Sketchpad::TOP);
+		SKPTEXT(W - 5, 0, camData.label);
+
+		// Display the camera FOV if it can be changed by user
+		if (camData.userControl.changeFOV) 
+		{
+			skp->SetTextAlign(oapi::Sketchpad::RIGHT, oapi::Sketchpad::BASELINE);
+
+			overlay.fov.Set("FOV: %g", camData.fov + camData.userFOV);
+			SKPTEXT(W - 5, H - 5, overlay.fov);
+		}
+
+		// Display the camera adjust mode if the user can contorl any mode
+		if (camData.userControl.changePos || camData.userControl.changeDir || camData.userControl.changeRot) 
+		{
+			// Set text alignment
+			skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::BASELINE);
+
+			// Set the adjust mode text
+			switch (data->adj)
+			{
+			case ADJ_POS:
+				SKPTEXT(5, H - 5, "Position");
+				break;
+			case ADJ_DIR:
+				SKPTEXT(5, H - 5, "Direction");
+				break;
+			case ADJ_ROT:
+				SKPTEXT(5, H - 5, "Rotation");
+				break;
+			}
+		}
+		break;
+	}
+
+	skp->SetTextAlign(oapi::Sketchpad::CENTER, oapi::Sketchpad::BASELINE);
+
+	if (!data->hCamera)
+		SKPTEXT(W / 2, H / 2, "Custom Camera Interface Disabled");
+
+	else if (!gcEnabled())
+		SKPTEXT(W / 2, H / 2, "No Graphics Client");
+
+	else if (gcSketchpadVersion(skp) != 2)
+		SKPTEXT(W / 2, H / 2, "Sketchpad Not in DirectX mode");
+
+	double updateTime = timer.Elapsed();
+
+	data->perf.updates++;
+	data->perf.updateTime += updateTime;
+	data->perf.maxUpdateTime = (std::max)(data->perf.maxUpdateTime, updateTime);
+
+	return true;
+}
+
+void Camera_MFD::drawDiagnostics(oapi::Sketchpad *skp)
+{
+	// The counters change every frame, so the texts are formatted again at an interval
+	double time = oapiGetSysTime();
+
+	if (diagnosticsTime < 0 || time - diagnosticsTime >= diagnosticsInterval)
+	{
+		diagnosticsTime = time;
+		diagnosticsSample++;
+	}
+
+	const PerfCounters &perf = data->perf;
+	PerfCounters vessel = mfdRegistry.GetCounters(data->hVessel);
+	PerfCounters module = mfdRegistry.GetTotals();
+
+	double key = double(diagnosticsSample);
+
+	diagnostics[0].Set(key, "Update: %.1f us, max %.1f us", perf.updates ? perf.updateTime / perf.updates * 1e6 : 0.0, perf.maxUpdateTime * 1e6);
+	diagnostics[1].Set(key, "Camera setups: %zu", perf.cameraSetups);
+	diagnostics[2].Set(key, "Blits: %zu", perf.blits);
+	diagnostics[3].Set(key, "Button rebuilds: %zu", perf.buttonRebuilds);
+	diagnostics[4].Set(key, "Config reads: %zu, %.2f ms", perf.configReads, perf.configTime * 1000);
+	diagnostics[5].Set(key, "API calls: %zu, vessel %zu", perf.apiCalls, vessel.apiCalls);
+	diagnostics[6].Set(key, "Module: %zu MFDs, %.1f us", mfdRegistry.Size(), module.updates ? module.updateTime / module.updates * 1e6 : 0.0);
+	diagnostics[7].Set(key, "Module setups: %zu, blits: %zu", module.cameraSetups, module.blits);
+
+	if (perfLog)
+		diagnostics[8].Set(key, "Log: %zu samples every %g s%s", perfLog->GetSamples(), perfLog->GetInterval(), perfLog->Failed() ? ", failed" : "");
+	else
+		diagnostics[8].Set(key, "Log: off");
+
+	skp->SetTextAlign(oapi::Sketchpad::LEFT, oapi::Sketchpad::TOP);
+
+	for (size_t line = 0; line < diagnostics.size(); line++)
+	{
+		std::string_view text = diagnostics[line];
+		skp->Text(5, 40 + int(line) * 20, text.data(), int(text.size()));
+	}
+}
+
+bool Camera_MFD::ConsumeButton(int bt, int event)
+{
+	if (event & PANEL_MOUSE_LBDOWN) 
+	{
+		mouseAdjust.Release();
+
+		if (bt < 12 && buttonLayout->keys[bt] != OAPI_KEY_ESCAPE)
+			return ConsumeKeyBuffered(buttonLayout->keys[bt]);
+	}
+	else if (event & PANEL_MOUSE_LBPRESSED) 
+	{
+		// Only the adjust and zoom buttons are continuous
+		if (bt < (data->page == 0 ? 8 : 6) && buttonLayout->keys[bt] != OAPI_KEY_ESCAPE)
+			return adjustCam(buttonLayout->keys[bt], mouseAdjust.Hold(buttonLayout->keys[bt], oapiGetSysTime()));
+	}
+	else if (event & PANEL_MOUSE_LBUP)
+		mouseAdjust.Release();
+
+	return false;
+}
+
+bool Camera_MFD::ConsumeKeyImmediate(char *kstate)
+{
+	for (int button = 0; button < (data->page == 0 ? 8 : 6); button++)
+	{
+		if (KEYDOWN(kstate, buttonLayout->keys[button]) && buttonLayout->keys[button] != OAPI_KEY_ESCAPE)
+			return adjustCam(buttonLayout->keys[button], keyAdjust.Hold(buttonLayout->keys[button], oapiGetSysTime()));
+	}
+
+	keyAdjust.Release();
+
+	return false;
+}
+
+bool Camera_MFD::adjustCam(DWORD key, double adjustTime)
+{
+	if (adjustTime <= 0)
+		return false;
+
+	// The number of steps to move in the current adjust mode
+	double steps = adjustTime * (data->adj == ADJ_POS ? posRate / posStep : angleRate / stepAngle);
+
+	switch (key)
+	{
+	case OAPI_KEY_A:
+		moveCamLeft(steps);
+		break;
+
+	case OAPI_KEY_D:
+		moveCamRight(steps);
+		break;
+
+	case OAPI_KEY_W:
+		moveCamUp(steps);
+		break;
+
+	case OAPI_KEY_S:
+		moveCamDown(steps);
+		break;
+
+	case OAPI_KEY_Q:
+		moveCamForward(adjustTime * posRate / posStep);
+		break;
+
+	case OAPI_KEY_E:
+		moveCamBackward(adjustTime * posRate / posStep);
+		break;
+
+	case OAPI_KEY_Z:
+		if (!zoomCam(-adjustTime * fovRate))
+			return false;
+		break;
+
+	case OAPI_KEY_X:
+		if (!zoomCam(adjustTime * fovRate))
+			return false;
+		break;
+
+	default:
+		return false;
+	}
+
+	dirty |= key == OAPI_KEY_Z || key == OAPI_KEY_X ? DIRTY_FOV : DIRTY_POSE;
+	InvalidateDisplay();
+
+	return true;
+}
+
+bool Camera_MFD::ConsumeKeyBuffered(DWORD key)
+{
+	TRACE_ZONE("Camera_MFD::ConsumeKeyBuffered");
+
+	switch (key)
+	{
+	case OAPI_KEY_A:
+		moveCamLeft();
+		dirty |= DIRTY_POSE;
+		break;
+
+	case OAPI_KEY_D:
+		moveCamRight();
+		dirty |= DIRTY_POSE;
+		break;
+
+	case OAPI_KEY_W:
+		moveCamUp();
+		dirty |= DIRTY_POSE;
+		break;
+
+	case OAPI_KEY_S:
+		moveCamDown();
+		dirty |= DIRTY_POSE;
+		break;
+
+	case OAPI_KEY_Q:
+		moveCamForward();
+		dirty |= DIRTY_POSE;
+		break;
+
+	case OAPI_KEY_E:
+		moveCamBackward();
+		dirty |= DIRTY_POSE;
+		break;
+
+	case OAPI_KEY_Z:
+		if (data->page != 0 || !zoomCam(-stepAngle))
+			return false;
+
+		dirty |= DIRTY_FOV;
+		break;
+
+	case OAPI_KEY_X:
+		if (data->page != 0 || !zoomCam(stepAngle))
+			return false;
+
+		dirty |= DIRTY_FOV;
+		break;
+
+	case OAPI_KEY_J:
+	{
+		auto &camData = data->camMap.at(data->cam);
+		auto &userControl = camData.userControl;
+
+		// As the button, only if the user can control more than one mode (there may be no mode to change to)
+		if (!camData.multipleAdj)
+			break;
+
+		while (true)
+		{
+			// Change the adjust mode
+			data->adj >= ADJ_ROT ? data->adj = ADJ_POS : data->adj++;
+
+			// If the new adjust mode is allowed to change by user
+			if ((data->adj == ADJ_POS && userControl.changePos) || (data->adj == ADJ_DIR && userControl.changeDir) || (data->adj == ADJ_ROT && userControl.changeRot))
+				break;
+		}
+
+		dirty |= DIRTY_BUTTONS;
+		break;
+	}
+	case OAPI_KEY_R:
+		resetCam();
+		dirty |= DIRTY_POSE;
+		break;
+
+	case OAPI_KEY_L:
+		oapiOpenInputBox("Enter Camera Label:", LblClbk, const_cast<char*>(data->camMap.at(data->cam).label.c_str()), 20, this);
+		break;
+
+	case OAPI_KEY_T:
+		if (data->page != 2 || vesselControlled)
+			return false;
+
+		oapiOpenInputBox("Enter Target Name:", TgtClbk, nullptr, 20, this);
+		break;
+
+	case OAPI_KEY_O:
+		if (data->page != 3)
+			return false;
+
+		perfLog ? StopPerfLog() : StartPerfLog(data->perfLogInterval > 0 ? data->perfLogInterval : PerfLog::defaultInterval);
+		InvalidateDisplay();
+		break;
+
+	case OAPI_KEY_P:
+		data->page >= 3 ? data->page = 0 : data->page++;
+
+		dirty |= DIRTY_BUTTONS;
+		break;
+
+	case OAPI_KEY_C:
+	{
+		auto nextCam = data->camMap.upper_bound(data->cam);
+
+		if (nextCam == data->camMap.end())
+			return false;
+
+		data->cam = nextCam->first;
+
+		dirty |= DIRTY_BUTTONS | DIRTY_CAMERA;
+		break;
+	}
+	case OAPI_KEY_V:
+	{
+		auto prevCam = data->camMap.lower_bound(data->cam);
+		prevCam--;
+
+		if (prevCam == data->camMap.end())
+			return false;
+
+		data->cam = prevCam->first;
+
+		dirty |= DIRTY_BUTTONS | DIRTY_CAMERA;
+		break;
+	}
+	case OAPI_KEY_G:
+	{
+		int addedCam = data->camMap.lastKey() + 1;
+
+		if (addNewCamera(addedCam))
+			data->cam = addedCam;
+
+		dirty |= DIRTY_CAMERA;
+		break;
+	}
+	case OAPI_KEY_H:
+		deleteCamera(data->cam);
+		break;
+
+	case OAPI_KEY_I:
+		data->camInfo >= INFO_FULL ? data->camInfo = INFO_NONE : data->camInfo++;
+		break;
+
+	case OAPI_KEY_K:
+		if (data->page != 2)
+			return false;
+
+		data->layout >= LAYOUT_3X3 ? data->layout = LAYOUT_SINGLE : data->layout++;
+
+		dirty |= DIRTY_TILES;
+		break;
+
+	case OAPI_KEY_Y:
+		if (data->page != 2)
+			return false;
+
+		if (capture)
+			FrameCapture::Finish(std::move(capture));
+		else
+			startCapture();
+
+		dirty |= DIRTY_BUTTONS;
+		break;
+
+	case OAPI_KEY_F:
+		// The format can't change while recording
+		if (data->page != 2 || capture)
+			return false;
+
+		captureFormat = (captureFormat + 1) % FrameCapture::FORMAT_COUNT;
+
+		dirty |= DIRTY_BUTTONS;
+		break;
+
+
+	default:
+		return false;
+	}
+
+	InvalidateDisplay();
+	return true;
+}
+
+void Camera_MFD::moveCamLeft(double steps)
+{
+	auto &camData = data->camMap.at(data->cam);
+
+	switch (data->adj) 
+	{
+	case ADJ_POS:
+	{
+		VECTOR3 dir = mul(camData.dir, _V(1, 0, 0)); normalise(dir);
+
+		camData.userPos -= dir * (posStep * steps);
+		break;
+	}
+	case ADJ_DIR:
+	{
+		// When dealing the left/right movement, we must yaw the camera as if it's level (no pitch). Otherwise, the camera wil move in an unexpected way.
+		double halfAngle = stepAngle * steps * RAD / 2;
+
+		camData.dir = camData.dir * leveledYawRotation(steps == 1 ? stepHalfCos : cos(halfAngle), steps == 1 ? stepHalfSin : sin(halfAngle),
+		                                               (camData.pitchAngle + camData.userPitch) * RAD);
+		renormalise(camData.dir);
+
+		camData.userYaw += stepAngle * steps;
+
+		if (camData.userYaw > 180)
+			camData.userYaw -= 360;
+
+		break;
+	}
+	case ADJ_ROT: 
+		camData.dir = camData.dir * (steps == 1 ? stepRotLeft : rollRotation(stepAngle * steps * RAD));
+		renormalise(camData.dir);
+
+		camData.userRot += stepAngle * steps;
+
+		if (camData.userRot > 180)
+			camData.userRot -= 360;
+		break;
+	}
+}
+
+void Camera_MFD::moveCamRight(double steps)
+{
+	auto &camData = data->camMap.at(data->cam);
+
+	switch (data->adj)
+	{
+	case ADJ_POS:
+	{
+		VECTOR3 dir = mul(camData.dir, _V(1, 0, 0)); normalise(dir);
+
+		camData.userPos += dir * (posStep * steps);
+		break;
+	}
+	case ADJ_DIR:
+	{
+		double halfAngle = stepAngle * steps * RAD / 2;
+
+		camData.dir = camData.dir * leveledYawRotation(steps == 1 ? stepHalfCos : cos(halfAngle), steps == 1 ? -stepHalfSin : -sin(halfAngle),
+		                                               (camData.pitchAngle + camData.userPitch) * RAD);
+		renormalise(camData.dir);
+
+		camData.userYaw -= stepAngle * steps;
+
+		if (camData.userYaw < -180)
+			camData.userYaw += 360;
+
+		break;
+	}
+	case ADJ_ROT:
+		camData.dir = camData.dir * (steps == 1 ? stepRotRight : rollRotation(-stepAngle * steps * RAD));
+		renormalise(camData.dir);
+
+		camData.userRot -= stepAngle * steps;
+
+		if (camData.userRot < -180)
+			camData.userRot += 360;
+		break;
+	}
+}
+
+void Camera_MFD::moveCamUp(double steps)
+{
+	auto &camData = data->camMap.at(data->cam);
+
+	switch (data->adj) 
+	{
+	case ADJ_POS:
+	{
+		VECTOR3 dir = mul(camData.dir, _V(0, 1, 0)); normalise(dir);
+
+		camData.userPos += dir * (posStep * steps);
+		break;
+	}
+	case ADJ_DIR: 
+		camData.dir = camData.dir * (steps == 1 ? stepUp : pitchRotation(stepAngle * steps * RAD));
+		renormalise(camData.dir);
+
+		camData.userPitch += stepAngle * steps;
+		if (camData.userPitch > 180)
+			camData.userPitch -= 360;
+		break;
+	}
+}
+
+void Camera_MFD::moveCamDown(double steps)
+{
+	auto &camData = data->camMap.at(data->cam);
+
+	switch (data->adj) 
+	{
+	case ADJ_POS:
+	{
+		VECTOR3 dir = mul(camData.dir, _V(0, 1, 0)); normalise(dir);
+
+		camData.userPos -= dir * (posStep * steps);
+		break;
+	}
+	case ADJ_DIR: 
+		camData.dir = camData.dir * (steps == 1 ? stepDown : pitchRotation(-stepAngle * steps * RAD));
+		renormalise(camData.dir);
+
+		camData.userPitch -= stepAngle * steps;
+
+		if (camData.userPitch < -180)
+			camData.userPitch += 360;
+		break;
+	}
+}
+
+void Camera_MFD::moveCamForward(double steps)
+{
+	auto &camData = data->camMap.at(data->cam);
+	
+	VECTOR3 dir = mul(camData.dir, _V(0, 0, 1)); normalise(dir);
+
+	camData.userPos += dir * (posStep * steps);
+}
+
+void Camera_MFD::moveCamBackward(double steps)
+{
+	auto &camData = data->camMap.at(data->cam);
+
+	VECTOR3 dir = mul(camData.dir, _V(0, 0, 1)); normalise(dir);
+
+	camData.userPos -= dir * (posStep * steps);
+}
+
+bool Camera_MFD::zoomCam(double angle)
+{
+	auto &camData = data->camMap.at(data->cam);
+
+	// Keep the FOV within (0, 80], the same limits as the zoom steps
+	double fov = min(max(camData.fov + camData.userFOV + angle, stepAngle), 80.0);
+
+	if (fov == camData.fov + camData.userFOV)
+		return false;
+
+	vesselControlled ? camData.userFOV = fov - camData.fov : camData.fov = fov - camData.userFOV;
+
+	return true;
+}
+
+void Camera_MFD::resetCam()
+{
+	auto &camData = data->camMap.at(data->cam);
+
+	switch (data->adj) 
+	{
+	case ADJ_POS:
+		camData.userPos = { 0,0,0 };
+		break;
+
+	case ADJ_DIR: 
+	{
+		camData.dir = defaultCam.dir;
+
+		setCamData(camData, camData.pitchAngle, camData.yawAngle, camData.rotAngle + camData.userRot);
+
+		camData.userPitch = 0;
+		camData.userYaw = 0;
+		break;
+	}
+	case ADJ_ROT: 
+		camData.dir = camData.dir * rollRotation(-camData.userRot * RAD);
+		renormalise(camData.dir);
+
+		camData.userRot = 0;
+		break;
+	}
+}
+
+bool Camera_MFD::setCamLabel(std::string label)
+{
+	if (label.empty() || label.size() > 20)
+		return false;
+
+	data->camMap.at(data->cam).label = label;
+
+	return true;
+}
+
+bool Camera_MFD::setCamTarget(std::string target)
+{
+	auto &camData = data->camMap.at(data->cam);
+	ScenarioTokenizer tokens(target);
+
+	std::string name(tokens.Next());
+
+	// An empty name stops tracking
+	if (name.empty())
+	{
+		setTarget(camData, nullptr, -1);
+		return true;
+	}
+
+	int dock = -1;
+	tokens.Read(dock);
+
+	OBJHANDLE hTarget = oapiGetVesselByName(const_cast<char*>(name.c_str()));
+
+	if (!hTarget || hTarget == data->hVessel)
+		return false;
+
+	if (dock >= int(oapiGetVesselInterface(hTarget)->DockCount()))
+		return false;
+
+	setTarget(camData, hTarget, dock < 0 ? -1 : dock);
+
+	return true;
+}
+
+bool Camera_MFD::CameraDataExist()
+{
+	data->perf.apiCalls++;
+
+	return dataExist;
+}
+
+int Camera_MFD::GetCameraCount()
+{
+	data->perf.apiCalls++;
+
+	return int(data->camMap.size());
+}
+
+int Camera_MFD::GetCurrentCamera()
+{
+	data->perf.apiCalls++;
+
+	return data->cam;
+}
+
+Camera_MFD::CameraData Camera_MFD::GetCameraData(int camera) 
+{
+	data->perf.apiCalls++;
+
+	CameraData cameraData;
+	cameraData.label = "";
+
+	if (data->camMap.find(camera) == data->camMap.end())
+		return cameraData;
+
+	cameraData = data->camMap.at(camera);
+	return cameraData;
+}
+
+bool Camera_MFD::SetCurrentCamera(int camera)
+{
+	data->perf.apiCalls++;
+
+	if (data->camMap.find(camera) == data->camMap.end())
+		return false;
+
+	data->cam = camera;
+
+	applyUpdate();
+
+	return true;
+}
+
+bool Camera_MFD::SetCameraData(int camera, CameraData cameraData)
+{
+	data->perf.apiCalls++;
+
+	return setCameraData(camera, cameraData);
+}
+
+bool Camera_MFD::setCameraData(int camera, const CameraData &cameraData)
+{
+	if (data->camMap.find(camera) == data->camMap.end())
+		return false;
+
+	auto &camData = data->camMap.at(camera);
+
+	camData.label = cameraData.label;
+	camData.pos = cameraData.pos;
+	camData.pitchAngle = cameraData.pitchAngle;
+	camData.yawAngle = cameraData.yawAngle;
+	camData.rotAngle = cameraData.rotAngle;
+	camData.fov = max(min(cameraData.fov, 80), 0);
+	camData.dir = defaultCam.dir;
+
+	setCamData(camData, camData.pitchAngle + camData.userPitch, camData.yawAngle + camData.userYaw, camData.rotAngle + camData.userRot);
+
+	camData.userControl = cameraData.userControl;
+	camData.multipleAdj = false;
+
+	if (!camData.userControl.changePos && !camData.userControl.changeDir && !camData.userControl.changeRot) { }
+
+	else if (camData.userControl.changePos && !camData.userControl.changeDir && !camData.userControl.changeRot)
+		data->adj = ADJ_POS;
+
+	else if (camData.userControl.changeDir && !camData.userControl.changePos && !camData.userControl.changeRot)
+		data->adj = ADJ_DIR;
+
+	else if (camData.userControl.changeRot && !camData.userControl.changePos && !camData.userControl.changeDir)
+		data->adj = ADJ_ROT;
+
+	else 
+	{
+		camData.multipleAdj = true;
+		data->adj -= 1;
+
+		while (true)
+		{
+			data->adj == ADJ_ROT ? data->adj = ADJ_POS : data->adj++;
+
+			if ((data->adj == ADJ_POS && camData.userControl.changePos) || (data->adj == ADJ_DIR && camData.userControl.changeDir) || (data->adj == ADJ_ROT && camData.userControl.changeRot))
+				break;
+		}
+	}
+
+	applyUpdate();
+
+	return true;
+}
+
+void Camera_MFD::setCamData(InternalData &camData, double pitchAngle, double yawAngle, double rotAngle)
+{
+	camData.dir = camData.dir * yawRotation(yawAngle * RAD) * pitchRotation(pitchAngle * RAD) * rollRotation(rotAngle * RAD);
+	renormalise(camData.dir);
+}
+
+bool Camera_MFD::AddCamera(int camera)
+{
+	data->perf.apiCalls++;
+
+	return addNewCamera(camera);
+}
+
+bool Camera_MFD::addNewCamera(int camera)
+{
+	if (data->camMap.find(camera) != data->camMap.end())
+		return false;
+
+	defaultCam.label = "Camera " + std::to_string(camera + 1);
+
+	addCamera(data, camera, defaultCam);
+
+	return true;
+}
+
+bool Camera_MFD::AddCamera(int camera, CameraData cameraData)
+{
+	data->perf.apiCalls++;
+
+	if (data->camMap.find(camera) != data->camMap.end())
+		return false;
+
+	addCamera(data, camera, defaultCam);
+
+	setCameraData(camera, cameraData);
+
+	return true;
+}
+
+bool Camera_MFD::DeleteCamera(int camera)
+{
+	data->perf.apiCalls++;
+
+	return deleteCamera(camera);
+}
+
+bool Camera_MFD::deleteCamera(int camera)
+{
+	if (data->camMap.size() == 1)
+		return false;
+
+	if (data->camMap.find(camera) == data->camMap.end())
+		return false;
+
+	data->camMap.erase(data->camMap.find(camera));
+
+	auto prevCam = data->camMap.lower_bound(data->cam);
+	prevCam--;
+
+	// If there is no previous camera, switch to the first one
+	if (prevCam == data->camMap.end())
+		prevCam = data->camMap.begin();
+
+	data->cam = prevCam->first;
+
+	applyUpdate();
+
+	return true;
+}
+
+void Camera_MFD::BeginUpdate()
+{
+	data->perf.apiCalls++;
+
+	updateDepth++;
+}
+
+void Camera_MFD::EndUpdate()
+{
+	data->perf.apiCalls++;
+
+	if (updateDepth == 0 || --updateDepth > 0 || !updatePending)
+		return;
+
+	updatePending = false;
+	applyUpdate();
+}
+
+void Camera_MFD::applyUpdate()
+{
+	// Defer the update to the end of the batch
+	if (updateDepth > 0)
+	{
+		updatePending = true;
+		return;
+	}
+
+	dirty |= DIRTY_BUTTONS | DIRTY_CAMERA;
+	InvalidateDisplay();
+}
+
+int Camera_MFD::GetLayout()
+{
+	data->perf.apiCalls++;
+
+	return data->layout;
+}
+
+bool Camera_MFD::SetLayout(int layout)
+{
+	data->perf.apiCalls++;
+
+	if (layout < LAYOUT_SINGLE || layout > LAYOUT_3X3)
+		return false;
+
+	data->layout = layout;
+
+	applyUpdate();
+
+	return true;
+}
+
+bool Camera_MFD::SetCameraPath(int camera, const CameraKey *keys, int count, bool loop)
+{
+	data->perf.apiCalls++;
 
+	auto cam = data->camMap.find(camera);
 
-	default:
+	if (cam == data->camMap.end() || count < 0 || (count > 0 && !keys))
 		return false;
-	}
 
-	InvalidateDisplay();
+	cam->second.path.SetKeys(keys, size_t(count));
+	cam->second.path.SetLoop(loop);
+	cam->second.pathTime = 0;
+
 	return true;
 }
 
-void Camera_MFD::moveCamLeft()
+bool Camera_MFD::RestartCameraPath(int camera)
 {
-	auto &camData = data->camMap.at(data->cam);
+	data->perf.apiCalls++;
 
-	switch (data->adj) 
-	{
-	case ADJ_POS:
-		VECTOR3 dir = mul(camData.dir, _V(1, 0, 0)); normalise(dir);
+	auto cam = data->camMap.find(camera);
 
-		camData.userPos -= dir * 0.025;
-		break;
+	if (cam == data->camMap.end() || cam->second.path.Empty())
+		return false;
 
-	case ADJ_DIR:
-	{
-		// When dealing the left/right movement, we must reset the camera to level (no pitch). Otherwise, the camera wil move in an unexpected way.
-		double pitchSin = sin(-(camData.pitchAngle + camData.userPitch) * RAD);
-		double pitchCos = cos(-(camData.pitchAngle + camData.userPitch) * RAD);
+	cam->second.pathTime = 0;
 
-		MATRIX3 mFixed = { 1, 0, 0, 0, pitchCos, pitchSin, 0, -pitchSin, pitchCos };
-		camData.dir = mul(camData.dir, mFixed);
+	return true;
+}
 
-		double leftSin = sin(0.5 * RAD);
-		double leftCos = cos(0.5 * RAD);
+bool Camera_MFD::SetCameraTarget(int camera, OBJHANDLE hTarget, int dock)
+{
+	data->perf.apiCalls++;
 
-		mFixed = { leftCos, 0, -leftSin, 0, 1, 0, leftSin, 0, leftCos };
-		camData.dir = mul(camData.dir, mFixed);
+	auto cam = data->camMap.find(camera);
 
-		camData.userYaw += 0.5;
+	if (cam == data->camMap.end())
+		return false;
 
-		if (camData.userYaw > 180)
-			camData.userYaw -= 360;
+	if (hTarget && (!oapiIsVessel(hTarget) || hTarget == data->hVessel || dock >= int(oapiGetVesselInterface(hTarget)->DockCount())))
+		return false;
 
-		pitchSin = sin((camData.pitchAngle + camData.userPitch) * RAD);
-		pitchCos = cos((camData.pitchAngle + camData.userPitch) * RAD);
+	setTarget(cam->second, hTarget, dock < 0 ? -1 : dock);
 
-		mFixed = { 1, 0, 0, 0, pitchCos, pitchSin, 0, -pitchSin, pitchCos };
-		camData.dir = mul(camData.dir, mFixed);
+	return true;
+}
 
-		break;
-	}
-	case ADJ_ROT: 
-	{
-		double leftSin = sin(0.5 * RAD);
-		double leftCos = cos(0.5 * RAD);
+OBJHANDLE Camera_MFD::GetCameraTarget(int camera)
+{
+	data->perf.apiCalls++;
 
-		MATRIX3 mFixed = { leftCos, -leftSin, 0, leftSin, leftCos, 0, 0, 0, 1 };
-		camData.dir = mul(camData.dir, mFixed);
+	auto cam = data->camMap.find(camera);
 
-		camData.userRot += 0.5;
+	if (cam == data->camMap.end())
+		return nullptr;
 
-		if (camData.userRot > 180)
-			camData.userRot -= 360;
-		break;
-	}
-	}
+	return cam->second.hTarget;
 }
 
-void Camera_MFD::moveCamRight()
+void Camera_MFD::setTarget(InternalData &camData, OBJHANDLE hTarget, int dock)
 {
-	auto &camData = data->camMap.at(data->cam);
+	camData.hTarget = hTarget;
+	camData.targetDock = hTarget ? dock : -1;
+	camData.targetName = hTarget ? oapiGetVesselInterface(hTarget)->GetName() : "";
+	camData.aimDir = { 0,0,0 };
 
-	switch (data->adj)
-	{
-	case ADJ_POS:
-		VECTOR3 dir = mul(camData.dir, _V(1, 0, 0)); normalise(dir);
+	if (hTarget)
+		mfdRegistry.Track(data);
 
-		camData.userPos += dir * 0.025;
-		break;
+	overlay.target.Reset();
+	InvalidateDisplay();
+}
 
-	case ADJ_DIR:
+void Camera_MFD::commitChanges()
+{
+	if (dirty & DIRTY_BUTTONS)
 	{
-		double pitchSin = sin(-(camData.pitchAngle + camData.userPitch) * RAD);
-		double pitchCos = cos(-(camData.pitchAngle + camData.userPitch) * RAD);
-
-		MATRIX3 mFixed = { 1, 0, 0, 0, pitchCos, pitchSin, 0, -pitchSin, pitchCos };
-		camData.dir = mul(camData.dir, mFixed);
-
-		double rightSin = sin(-0.5 * RAD);
-		double rightCos = cos(-0.5 * RAD);
+		setButtons();
+		InvalidateButtons();
+	}
 
-		mFixed = { rightCos, 0, -rightSin, 0, 1, 0, rightSin, 0, rightCos };
-		camData.dir = mul(camData.dir, mFixed);
+	// A camera switch may change the render scale
+	if (dirty & (DIRTY_CAMERA | DIRTY_SURFACE) && data->hRenderSrf)
+		updateSurface();
 
-		camData.userYaw -= 0.5;
+	if (dirty & (DIRTY_POSE | DIRTY_FOV | DIRTY_SURFACE))
+		setCustomCamera();
 
-		if (camData.userYaw < -180)
-			camData.userYaw += 360;
+	if (dirty & DIRTY_TILES && data->hCamera)
+		setupTiles();
 
-		pitchSin = sin((camData.pitchAngle + camData.userPitch) * RAD);
-		pitchCos = cos((camData.pitchAngle + camData.userPitch) * RAD);
+	if (dirty & DIRTY_CAMERA)
+		overlay.target.Reset();
 
-		mFixed = { 1, 0, 0, 0, pitchCos, pitchSin, 0, -pitchSin, pitchCos };
-		camData.dir = mul(camData.dir, mFixed);
+	dirty = 0;
+}
 
-		break;
-	}
-	case ADJ_ROT:
-	{
-		double rightSin = sin(-0.5 * RAD);
-		double rightCos = cos(-0.5 * RAD);
+void Camera_MFD::PreStepAll()
+{
+	for (Camera_MFD *mfd : openMFDs)
+		mfd->preStep();
 
-		MATRIX3 mFixed = { rightCos, -rightSin, 0, rightSin, rightCos, 0, 0, 0, 1 };
-		camData.dir = mul(camData.dir, mFixed);
+	FrameCapture::DeleteFinished();
 
-		camData.userRot -= 0.5;
+	samplePerfLog();
+}
 
-		if (camData.userRot < -180)
-			camData.userRot += 360;
-		break;
-	}
-	}
+void Camera_MFD::StartPerfLog(double interval)
+{
+	perfLog.reset();
+	perfLog.reset(new PerfLog("CameraMFD_Perf.csv", interval));
 }
 
-void Camera_MFD::moveCamUp()
+void Camera_MFD::StopPerfLog() { perfLog.reset(); }
+
+void Camera_MFD::samplePerfLog()
 {
-	auto &camData = data->camMap.at(data->cam);
+	if (!perfLog)
+		return;
 
-	switch (data->adj) 
-	{
-	case ADJ_POS:
-		VECTOR3 dir = mul(camData.dir, _V(0, 1, 0)); normalise(dir);
+	double time = oapiGetSysTime();
 
-		camData.userPos += dir * 0.025;
-		break;
+	if (!perfLog->Due(time))
+		return;
 
-	case ADJ_DIR: 
+	// Copy the counters only. The rows are formatted and written by the log thread.
+	std::vector<PerfLog::Row> rows;
+	rows.reserve(mfdRegistry.Size() + 1);
+
+	mfdRegistry.ForEach([&rows, time](const MFD_Data *data)
 	{
-		double upSin = sin(0.5 * RAD);
-		double upCos = cos(0.5 * RAD);
+		rows.push_back({ time, oapiGetVesselInterface(data->hVessel)->GetName(), data->mfdIndex, data->perf });
+	});
 
-		MATRIX3 mFixed = { 1, 0, 0, 0, upCos, upSin, 0, -upSin, upCos };
-		camData.dir = mul(camData.dir, mFixed);
+	rows.push_back({ time, "", -1, mfdRegistry.GetTotals() });
 
-		camData.userPitch += 0.5;
-		if (camData.userPitch > 180)
-			camData.userPitch -= 360;
-		break;
-	}
-	}
+	perfLog->Write(std::move(rows));
 }
 
-void Camera_MFD::moveCamDown()
+void Camera_MFD::preStep()
 {
+	if (!data->hCamera)
+		return;
+
+	// Read back the frame the camera rendered last
+	if (capture && cameraOn)
+		capture->Capture(data->hRenderSrf, data->srfWidth, data->srfHeight);
+
 	auto &camData = data->camMap.at(data->cam);
 
-	switch (data->adj) 
-	{
-	case ADJ_POS:
-		VECTOR3 dir = mul(camData.dir, _V(0, 1, 0)); normalise(dir);
+	bool render = governor.Step(oapiGetSysTime(), oapiGetSysStep(), camData.rate, data->frameBudget, data->minScale > 0 ? data->minScale : 1);
 
-		camData.userPos -= dir * 0.025;
-		break;
+	// Change the surface on the next update when the resolution passes a step
+	double stepResolution = std::ceil(governor.GetResolution() * resolutionSteps) / resolutionSteps;
 
-	case ADJ_DIR: 
+	if (stepResolution != resolution)
+	{
+		resolution = stepResolution;
+		dirty |= DIRTY_SURFACE;
+		InvalidateDisplay();
+	}
+
+	if (render != cameraOn)
 	{
-		double downSin = sin(-0.5 * RAD);
-		double downCos = cos(-0.5 * RAD);
+		gcCustomCameraOnOff(data->hCamera, render);
+		cameraOn = render;
+	}
 
-		MATRIX3 mFixed = { 1, 0, 0, 0, downCos, downSin, 0, -downSin, downCos };
-		camData.dir = mul(camData.dir, mFixed);
+	// Move the camera along its path, only on the frames it renders
+	bool moved = false;
 
-		camData.userPitch -= 0.5;
+	if (!camData.path.Empty())
+	{
+		camData.pathTime += oapiGetSimStep();
 
-		if (camData.userPitch < -180)
-			camData.userPitch += 360;
-		break;
+		if (render)
+		{
+			followPath();
+			moved = true;
+		}
 	}
+
+	// Point the camera at its target. A path sets the direction on every frame, so it's pointed at the target on every frame too.
+	if (render && !camData.targetName.empty())
+		moved |= aimAtTarget(moved);
+
+	// Set the camera up by the next update with the other changes of the frame, so it's set up once per frame
+	if (moved)
+	{
+		dirty |= DIRTY_POSE;
+		InvalidateDisplay();
 	}
-}
 
-void Camera_MFD::moveCamForward()
-{
-	auto &camData = data->camMap.at(data->cam);
-	
-	VECTOR3 dir = mul(camData.dir, _V(0, 0, 1)); normalise(dir);
+	if (data->tiles.empty())
+		return;
+
+	// Switch on the next tiles in turn, so the tiles render cost doesn't depend on the tiles count
+	size_t tileCount = data->tiles.size();
+
+	for (size_t tile = 0; tile < tileCount; tile++)
+	{
+		auto &tileData = data->tiles[tile];
+		bool on = (tile + tileCount - nextTile) % tileCount < tilesPerFrame;
+
+		if (on != tileData.on)
+		{
+			gcCustomCameraOnOff(tileData.hCamera, on);
+			tileData.on = on;
+		}
+	}
 
-	camData.userPos += dir * 0.025;
+	nextTile = (nextTile + tilesPerFrame) % tileCount;
 }
 
-void Camera_MFD::moveCamBackward()
+void Camera_MFD::followPath()
 {
 	auto &camData = data->camMap.at(data->cam);
+	CameraKey key = camData.path.Evaluate(camData.pathTime);
+
+	// As SetCameraData, without updating the buttons
+	camData.pos = key.pos;
+	camData.pitchAngle = key.pitchAngle;
+	camData.yawAngle = key.yawAngle;
+	camData.rotAngle = key.rotAngle;
+	camData.fov = max(min(key.fov, 80), 0);
+	camData.dir = defaultCam.dir;
 
-	VECTOR3 dir = mul(camData.dir, _V(0, 0, 1)); normalise(dir);
-
-	camData.userPos -= dir * 0.025;
+	setCamData(camData, camData.pitchAngle + camData.userPitch, camData.yawAngle + camData.userYaw, camData.rotAngle + camData.userRot);
 }
 
-void Camera_MFD::resetCam()
+bool Camera_MFD::aimAtTarget(bool force)
 {
 	auto &camData = data->camMap.at(data->cam);
 
-	switch (data->adj) 
-	{
-	case ADJ_POS:
-		camData.userPos = { 0,0,0 };
-		break;
-
-	case ADJ_DIR: 
+	// Find the target read by name
+	if (!camData.hTarget)
 	{
-		camData.dir = defaultCam.dir;
+		OBJHANDLE hTarget = oapiGetVesselByName(const_cast<char*>(camData.targetName.c_str()));
 
-		setCamData(data->cam, camData.pitchAngle, camData.yawAngle, camData.rotAngle + camData.userRot);
+		if (!hTarget || hTarget == data->hVessel)
+		{
+			camData.targetName.clear();
+			return false;
+		}
 
-		camData.userPitch = 0;
-		camData.userYaw = 0;
-		break;
+		camData.hTarget = hTarget;
+		mfdRegistry.Track(data);
 	}
-	case ADJ_ROT: 
-	{
-		double rotSin = sin(-camData.userRot * RAD);
-		double rotCos = cos(-camData.userRot * RAD);
 
-		MATRIX3 mFixed = { rotCos, -rotSin, 0, rotSin, rotCos, 0, 0, 0, 1 };
-		camData.dir = mul(camData.dir, mFixed);
+	VESSEL *target = oapiGetVesselInterface(camData.hTarget);
+	VECTOR3 targetPos;
 
-		camData.userRot = 0;
-		break;
-	}
+	if (camData.targetDock >= 0 && camData.targetDock < int(target->DockCount()))
+	{
+		VECTOR3 dockPos, dockDir, dockRot;
+		target->GetDockParams(target->GetDockHandle(camData.targetDock), dockPos, dockDir, dockRot);
+		target->Local2Global(dockPos, targetPos);
 	}
-}
-
-bool Camera_MFD::setCamLabel(std::string label)
-{
-	if (label.empty() || label.size() > 20)
-		return false;
-
-	data->camMap.at(data->cam).label = label;
-
-	return true;
-}
-
-bool Camera_MFD::CameraDataExist() { return dataExist; }
-
-int Camera_MFD::GetCameraCount() { return int(data->camMap.size()); }
+	else
+		oapiGetGlobalPos(camData.hTarget, &targetPos);
 
-int Camera_MFD::GetCurrentCamera() { return data->cam; }
+	// The target direction from the camera, in the vessel frame
+	VECTOR3 aimDir;
+	oapiGetVesselInterface(data->hVessel)->Global2Local(targetPos, aimDir);
+	aimDir -= camData.pos + camData.userPos;
 
-Camera_MFD::CameraData Camera_MFD::GetCameraData(int camera) 
-{
-	CameraData cameraData;
-	cameraData.label = "";
+	double distance = length(aimDir);
 
-	if (data->camMap.find(camera) == data->camMap.end())
-		return cameraData;
+	if (distance <= 0)
+		return false;
 
-	cameraData = data->camMap.at(camera);
-	return cameraData;
-}
+	aimDir = aimDir / distance;
 
-bool Camera_MFD::SetCurrentCamera(int camera)
-{
-	if (data->camMap.find(camera) == data->camMap.end())
+	// Set the camera up again only if the target moved over the tolerance
+	if (!force && dotp(aimDir, camData.aimDir) >= std::cos(data->trackTolerance * RAD))
 		return false;
 
-	data->cam = camera;
+	camData.aimDir = aimDir;
 
-	setButtons();
-	InvalidateButtons();
-	setCustomCamera();
-	InvalidateDisplay();
+	// The angles of the direction, as setCamData rotates the camera
+	camData.pitchAngle = std::asin(max(min(aimDir.y, 1.0), -1.0)) * DEG;
+	camData.yawAngle = std::atan2(-aimDir.x, aimDir.z) * DEG;
+	camData.dir = defaultCam.dir;
+
+	setCamData(camData, camData.pitchAngle + camData.userPitch, camData.yawAngle + camData.userYaw, camData.rotAngle + camData.userRot);
 
 	return true;
 }
 
-bool Camera_MFD::SetCameraData(int camera, CameraData cameraData)
+void Camera_MFD::startCapture()
 {
-	if (data->camMap.find(camera) == data->camMap.end())
-		return false;
-
-	auto &camData = data->camMap.at(camera);
+	// A new folder in the Orbiter screenshots folder for each capture
+	std::string folder = "Images/CameraMFD/";
+	folder += oapiGetVesselInterface(data->hVessel)->GetClassNameA();
+	folder += "_" + std::to_string(data->mfdIndex) + "_";
 
-	camData.label = cameraData.label;
-	camData.pos = cameraData.pos;
-	camData.pitchAngle = cameraData.pitchAngle;
-	camData.yawAngle = cameraData.yawAngle;
-	camData.rotAngle = cameraData.rotAngle;
-	camData.fov = max(min(cameraData.fov, 80), 0);
-	camData.dir = defaultCam.dir;
+	int number = 1;
 
-	setCamData(camera, camData.pitchAngle + camData.userPitch, camData.yawAngle + camData.userYaw, camData.rotAngle + camData.userRot);
+	while (std::filesystem::exists(folder + std::to_string(number)))
+		number++;
 
-	camData.userControl = cameraData.userControl;
-	camData.multipleAdj = false;
+	// The Y4M video is at the camera render rate, or 60 frames per second if it renders every frame
+	double frameRate = data->camMap.at(data->cam).rate;
 
-	if (!camData.userControl.changePos && !camData.userControl.changeDir && !camData.userControl.changeRot) { }
+	capture.reset(new FrameCapture(folder + std::to_string(number), FrameCapture::Format(captureFormat), W, H, frameRate > 0 ? frameRate : 60));
+}
 
-	else if (camData.userControl.changePos && !camData.userControl.changeDir && !camData.userControl.changeRot)
-		data->adj = ADJ_POS;
+void Camera_MFD::updateSurface()
+{
+	TRACE_ZONE("Camera_MFD::updateSurface");
 
-	else if (camData.userControl.changeDir && !camData.userControl.changePos && !camData.userControl.changeRot)
-		data->adj = ADJ_DIR;
+	double scale = data->camMap.at(data->cam).scale * resolution;
+	RECT rect = tileRect(0);
 
-	else if (camData.userControl.changeRot && !camData.userControl.changePos && !camData.userControl.changeDir)
-		data->adj = ADJ_ROT;
+	DWORD width = (std::max)(DWORD(1), DWORD(std::lround((rect.right - rect.left) * scale)));
+	DWORD height = (std::max)(DWORD(1), DWORD(std::lround((rect.bottom - rect.top) * scale)));
 
-	else 
-	{
-		camData.multipleAdj = true;
-		data->adj -= 1;
+	if (data->hRenderSrf && data->srfWidth == width && data->srfHeight == height)
+		return;
 
-		while (true)
-		{
-			data->adj == ADJ_ROT ? data->adj = ADJ_POS : data->adj++;
+	if (data->hRenderSrf)
+		surfacePool.Release(data->hRenderSrf, oapiGetSysTime());
 
-			if ((data->adj == ADJ_POS && camData.userControl.changePos) || (data->adj == ADJ_DIR && camData.userControl.changeDir) || (data->adj == ADJ_ROT && camData.userControl.changeRot))
-				break;
-		}
-	}
+	// Get a 3D render target from the pool
+	data->hRenderSrf = surfacePool.Acquire(width, height, renderSurfaceFlags);
+	data->srfWidth = width;
+	data->srfHeight = height;
 
-	setButtons();
-	InvalidateButtons();
-	setCustomCamera();
-	InvalidateDisplay();
+	// Clear the surface
+	oapiClearSurface(data->hRenderSrf);
 
-	return true;
+	dirty |= DIRTY_SURFACE;
 }
 
-void Camera_MFD::setCamData(int cam, double pitchAngle, double yawAngle, double rotAngle)
+void Camera_MFD::setupTiles()
 {
-	auto &camData = data->camMap.at(cam);
+	TRACE_ZONE("Camera_MFD::setupTiles");
 
-	double yawSin = sin(yawAngle * RAD);
-	double yawCos = cos(yawAngle * RAD);
+	// The tiles show the cameras after the current one, each camera once
+	size_t tileCount = (std::min)(size_t(layoutTiles[data->layout] - 1), data->camMap.size() - 1);
 
-	MATRIX3 mFixed = { yawCos, 0, -yawSin, 0, 1, 0, yawSin, 0, yawCos };
-	camData.dir = mul(camData.dir, mFixed);
+	for (size_t tile = tileCount; tile < data->tiles.size(); tile++)
+	{
+		gcDeleteCustomCamera(data->tiles[tile].hCamera);
+		surfacePool.Release(data->tiles[tile].hSurf, oapiGetSysTime());
+	}
 
-	double pitchSin = sin(pitchAngle * RAD);
-	double pitchCos = cos(pitchAngle * RAD);
+	data->tiles.resize(tileCount);
 
-	mFixed = { 1, 0, 0, 0, pitchCos, pitchSin, 0, -pitchSin, pitchCos };
-	camData.dir = mul(camData.dir, mFixed);
+	auto cam = data->camMap.find(data->cam);
 
-	double rotSin = sin(rotAngle * RAD);
-	double rotCos = cos(rotAngle * RAD);
+	for (size_t tile = 0; tile < tileCount; tile++)
+	{
+		if (++cam == data->camMap.end())
+			cam = data->camMap.begin();
 
-	mFixed = { rotCos, -rotSin, 0, rotSin, rotCos, 0, 0, 0, 1 };
-	camData.dir = mul(camData.dir, mFixed);
-}
+		auto &tileData = data->tiles[tile];
+		tileData.cam = cam->first;
 
-bool Camera_MFD::AddCamera(int camera)
-{
-	if (data->camMap.find(camera) != data->camMap.end())
-		return false;
+		RECT rect = tileRect(int(tile) + 1);
 
-	defaultCam.label = "Camera " + std::to_string(camera + 1);
+		DWORD width = (std::max)(DWORD(1), DWORD(std::lround((rect.right - rect.left) * cam->second.scale)));
+		DWORD height = (std::max)(DWORD(1), DWORD(std::lround((rect.bottom - rect.top) * cam->second.scale)));
 
-	data->camMap[camera] = defaultCam;
+		if (!tileData.hSurf || tileData.width != width || tileData.height != height)
+		{
+			if (tileData.hSurf)
+				surfacePool.Release(tileData.hSurf, oapiGetSysTime());
 
-	return true;
-}
+			tileData.hSurf = surfacePool.Acquire(width, height, renderSurfaceFlags);
+			tileData.width = width;
+			tileData.height = height;
 
-bool Camera_MFD::AddCamera(int camera, CameraData cameraData)
-{
-	if (data->camMap.find(camera) != data->camMap.end())
-		return false;
+			oapiClearSurface(tileData.hSurf);
+		}
 
-	data->camMap[camera] = defaultCam;
+		tileData.hCamera = setupCamera(tileData.hCamera, data->hVessel, cam->second, tileData.hSurf);
+		data->perf.cameraSetups++;
 
-	SetCameraData(camera, cameraData);
+		// Keep the tile off until its turn
+		if (tileData.hCamera && !tileData.on)
+			gcCustomCameraOnOff(tileData.hCamera, false);
+	}
 
-	return true;
+	if (nextTile >= tileCount)
+		nextTile = 0;
 }
 
-bool Camera_MFD::DeleteCamera(int camera)
+RECT Camera_MFD::tileRect(int tile) const
 {
-	if (data->camMap.size() == 1)
-		return false;
-
-	if (data->camMap.find(camera) == data->camMap.end())
-		return false;
-
-	data->camMap.erase(data->camMap.find(camera));
-
-	auto &prevCam = data->camMap.lower_bound(data->cam);
-	prevCam--;
+	switch (data->layout)
+	{
+	case LAYOUT_PIP:
+		if (tile == 0)
+			break;
 
-	if (prevCam == data->camMap.end())
-		data->cam = 0;
+		// The inset is a third of the MFD, in the bottom right corner above the bottom texts
+		return { LONG(W - W / 3 - 5), LONG(H - H / 3 - 25), LONG(W - 5), LONG(H - 25) };
 
-	data->cam = prevCam->first;
+	case LAYOUT_2X2:
+	case LAYOUT_3X3:
+	{
+		int columns = data->layout == LAYOUT_2X2 ? 2 : 3;
+		int column = tile % columns;
+		int row = tile / columns;
 
-	setButtons();
-	InvalidateButtons();
-	setCustomCamera();
-	InvalidateDisplay();
+		return { LONG(W * column / columns), LONG(H * row / columns), LONG(W * (column + 1) / columns), LONG(H * (row + 1) / columns) };
+	}
+	}
 
-	return true;
+	return { 0, 0, LONG(W), LONG(H) };
 }
 
 void Camera_MFD::setCustomCamera() 
 {
-	auto &camData = data->camMap.at(data->cam);
+	TRACE_ZONE("Camera_MFD::setCustomCamera");
 
-	VECTOR3 dir = mul(camData.dir, _V(0, 0, 1)); normalise(dir);
-	VECTOR3 rot = mul(camData.dir, _V(0, 1, 0)); normalise(rot);
+	data->perf.cameraSetups++;
+	data->hCamera = setupCamera(data->hCamera, data->hVessel, data->camMap.at(data->cam), data->hRenderSrf);
 
-	hCamera = gcSetupCustomCamera(hCamera, data->hVessel, camData.pos + camData.userPos, dir, rot, (camData.fov + camData.userFOV) * RAD, hRenderSrf, 0xFF);
+	// Keep the camera off until it's due to render
+	if (data->hCamera && !cameraOn)
+		gcCustomCameraOnOff(data->hCamera, false);
 }
\ No newline at end of file
@@ -21,11 +21,23 @@
 
 #pragma once
 #include "CameraMFD_API.h"
+#include "Orientation.h"
+#include "AdjustEngine.h"
+#include "RenderGovernor.h"
+#include "FrameCapture.h"
+#include "CameraPath.h"
+#include "ButtonLayout.h"
+#include "FlatMap.h"
+#include "PerfCounters.h"
+#include "ConfigWatcher.h"
 
 #include <gcAPI.h>
 
+#include <array>
+#include <memory>
+#include <string_view>
 #include <vector>
-#include <map>
+#include <unordered_map>
 
 struct InternalData : CameraMFD::CameraData 
 {
@@ -38,22 +50,212 @@ struct InternalData : CameraMFD::CameraData
 	double userRot;
 	double userFOV;
 
-	MATRIX3 dir;
+	Quaternion dir; // The camera orientation. Only converted to a matrix when the custom camera is set.
 	bool multipleAdj;
+
+	double rate;  // The render rate in frames per second, 0 to render every frame
+	double scale; // The render resolution scale of the MFD size, from 0 to 1
+
+	CameraPath path; // The camera path, if it has keys
+	double pathTime; // The time along the path, in seconds. Advances only while the camera is the current camera.
+
+	std::string targetName; // The name of the vessel the camera points at, empty if it doesn't track a target
+	int targetDock;         // The docking port of the target to point at, or -1 for the target center
+	OBJHANDLE hTarget;      // The target handle. A target read by name is found on the first frame, once all the vessels exist.
+	VECTOR3 aimDir;         // The target direction the camera last pointed at, in the vessel frame
+};
+
+// A view of a multi-view layout besides the current camera view, with its own custom camera
+struct MFD_Tile
+{
+	int cam;
+	CAMERAHANDLE hCamera = nullptr;
+	SURFHANDLE hSurf = nullptr;
+	DWORD width = 0;
+	DWORD height = 0;
+	bool on = false; // If the camera is switched on for this frame
 };
 
 struct MFD_Data 
 {
+	// The MFD items which can be set by a configuration file, as flags
+	enum Item
+	{
+		ITEM_ADJ = 1,
+		ITEM_PAGE = 2,
+		ITEM_INFO = 4,
+		ITEM_CAM = 8,
+		ITEM_BUDGET = 16,
+		ITEM_MINSCALE = 32,
+		ITEM_LAYOUT = 64,
+		ITEM_TRACKTOL = 128,
+		ITEM_PERFLOG = 256,
+		ITEM_COMPACT = 512,
+		ITEM_DELTA = 1024,
+		ITEM_MAXPARK = 2048,
+		ITEM_RATE = 4096,
+		ITEM_SCALE = 8192
+	};
+
 	OBJHANDLE hVessel;
 	int mfdIndex;
 	bool sendInstance;
-	std::map<int, InternalData> camMap;
+	FlatMap<int, InternalData> camMap;
 
 	int cam;
 	int adj;
 
 	int page;
 	int camInfo;
+
+	double frameBudget; // The frame time budget in seconds, over which the render rate is scaled down. 0 for no budget.
+	double minScale;    // The lowest factor the render resolution is scaled down by over the frame budget, before the render rate. 0 for a fixed resolution.
+
+	int layout;                 // The multi-view layout, as the CameraMFD::Layout enum
+	double trackTolerance;      // The target direction change in degrees over which the tracking cameras point at their target again
+	double perfLogInterval;     // The performance log interval in seconds. If it's set, the log starts when the MFD data is loaded.
+	bool compactStatus;         // If the cameras are written into the scenario as a line each (CAM items), instead of the separate items
+	bool deltaStatus;           // If only the changes from the configuration file cameras are written into the scenario
+	int maxParked;              // The most cameras kept for closed MFDs. If it's set, the module cap is set when the MFD data is loaded. -1 if it isn't set.
+	std::vector<MFD_Tile> tiles; // The layout views of the cameras after the current one
+
+	// The render rate and scale of the cameras added without them, set by CRATE and CSCALE before the first camera.
+	// They're set before the file is read, as the cameras read take them.
+	double defaultRate = 0;
+	double defaultScale = 1;
+
+	// The custom camera and its render target. They are kept with the data when the MFD is closed, so reopening it doesn't set them up again.
+	CAMERAHANDLE hCamera = nullptr;
+	SURFHANDLE hRenderSrf = nullptr;
+	DWORD srfWidth = 0;
+	DWORD srfHeight = 0;
+
+	PerfCounters perf; // The runtime counters of the MFD
+
+	// The cameras of the loaded configuration file, kept in the delta mode. Shared, as it isn't changed once loaded.
+	std::shared_ptr<const ConfigBaseline> baseline;
+
+	// The configuration file of the cameras, and the count of its watcher snapshots the cameras are up to date with
+	std::shared_ptr<ConfigWatcher::File> configFile;
+	uint64_t configVersion = 0;
+	std::shared_ptr<const ConfigBaseline> configCameras; // The cameras of the file as last loaded, so a reload removes the cameras deleted from it
+	bool configPending = false; // If the configuration file is being loaded by the watcher thread, while the default camera is shown
+
+	~MFD_Data() { ReleaseCamera(); }
+
+	// Deletes the custom cameras of the current camera and the tiles, and returns their render targets to the surface pool
+	void ReleaseCamera();
+};
+
+// A configuration file as loaded: its cameras, and the MFD items it sets. A delta scenario (CDELTA) stores the changes from its cameras,
+// and the configuration watcher publishes it when the file is loaded or changed.
+struct ConfigBaseline
+{
+	std::string fileName; // The file name as given to CCFG, without the CameraMFD folder and the extension
+	FlatMap<int, InternalData> camMap;
+
+	MFD_Data items;    // The MFD items, of which the readItems flags are set by the file. The cameras are in camMap.
+	int readItems = 0;
+
+	std::vector<std::string> sources; // The files read to load it: the file, then the files of its CCFG and CBASE items
+};
+
+// The MFD data of all vessels, looked up by the vessel handle and the MFD index.
+// Each vessel has a slot per MFD index, so finding an MFD data and deleting a vessel data don't depend on the vessel count.
+class MFD_Registry
+{
+public:
+	MFD_Data *Find(OBJHANDLE hVessel, int mfdIndex) const;
+
+	// Adds the data to its vessel and MFD index slot. The registry owns the data.
+	void Add(MFD_Data *data);
+
+	// Deletes the vessel data, and stops the cameras which track the vessel
+	void DeleteVessel(OBJHANDLE hVessel);
+	void Clear();
+
+	// Adds data with a camera which tracks a target, so the camera stops tracking if the target is deleted
+	void Track(MFD_Data *data);
+
+	// Keeps the switched off camera of a closed MFD. The least recently parked cameras over maxParked are released.
+	void Park(MFD_Data *data);
+	// Removes the data from the parked cameras, as its MFD is open again
+	void Unpark(MFD_Data *data);
+
+	size_t Size() const { return size; }
+	size_t ParkedCount() const { return parked.size(); }
+
+	// Returns the counters summed over the MFDs of a vessel
+	PerfCounters GetCounters(OBJHANDLE hVessel) const;
+	// Returns the counters summed over all the MFDs, including the deleted ones
+	PerfCounters GetTotals() const;
+
+	template <typename Func>
+	void ForEach(Func func) const
+	{
+		for (const auto &vessel : vessels)
+			for (MFD_Data *data : vessel.second)
+				if (data)
+					func(data);
+	}
+
+	// Sets the most cameras kept for closed MFDs, as each holds a render target. 0 to release them on close.
+	// It's limited to parkLimit, and the least recently parked cameras over it are released.
+	void SetMaxParked(size_t count);
+	size_t GetMaxParked() const { return maxParked; }
+
+	static constexpr size_t defaultMaxParked = 4;
+	static constexpr size_t parkLimit = 32;
+
+private:
+	std::unordered_map<OBJHANDLE, std::array<MFD_Data*, MAXMFD>> vessels;
+	size_t size = 0;
+
+	std::vector<MFD_Data*> parked; // The parked cameras data, the least recently parked first
+	size_t maxParked = defaultMaxParked;
+	std::vector<MFD_Data*> trackers; // The data with cameras which track a target
+	PerfCounters retired;            // The counters of the deleted data
+
+	// Releases the least recently parked cameras over the cap
+	void releaseParked();
+};
+
+// An overlay text line, which is formatted again only when the value it shows changes
+class OverlayText
+{
+public:
+	// Formats the text if the key value or the format changed since it was last formatted
+	template <typename... Args>
+	void Set(double key, const char *format, Args... args)
+	{
+		if (formatted && key == this->key && format == this->format)
+			return;
+
+		this->key = key;
+		this->format = format;
+		formatted = true;
+		formats++;
+
+		int count = sprintf_s(text, sizeof(text), format, args...);
+		length = count < 0 ? 0 : count < int(sizeof(text)) ? count : int(sizeof(text)) - 1;
+	}
+
+	void Set(const char *format, double value) { Set(value, format, value); }
+
+	// Formats the text on the next call, for texts which don't depend on a single value
+	void Reset() { formatted = false; }
+
+	operator std::string_view() const { return std::string_view(text, length); }
+
+	static inline size_t formats = 0; // The count of texts formatted by all overlays
+
+private:
+	char text[64] = {};
+	int length = 0;
+
+	bool formatted = false;
+	double key = 0;
+	const char *format = nullptr;
 };
 
 class Camera_MFD : public MFD2, public CameraMFD
@@ -63,9 +265,31 @@ public:
 	static bool LblClbk(void *id, char *str, void *usrdata);
 	bool setCamLabel(std::string label);
 
+	static bool TgtClbk(void *id, char *str, void *usrdata);
+	bool setCamTarget(std::string target);
+
 	Camera_MFD(DWORD w, DWORD h, VESSEL *vessel, UINT mfd);
 	~Camera_MFD();
 
+	// Called by opcPreStep for all the open MFDs, to switch the custom cameras on the frames they render
+	static void PreStepAll();
+
+	// Starts the performance log of all the MFDs (CameraMFD_Perf.csv in the Orbiter folder), or stops it
+	static void StartPerfLog(double interval);
+	static void StopPerfLog();
+	static const PerfLog *GetPerfLog() { return perfLog.get(); }
+
+	// Loads the configuration files of the vessel classes in the simulation on the watcher thread, so the MFDs opened later adopt them right away
+	static void PreloadConfigs();
+
+	// Stops loading and watching the configuration files
+	static void StopConfigWatcher();
+	static const ConfigWatcher *GetConfigWatcher() { return configWatcher.get(); }
+
+	// Loads a configuration file (the name as given to CCFG) from its cache, or parses it and compiles the cache, without an MFD.
+	// Returns nullptr if it has no cameras. It doesn't call the Orbiter API, so it's called by the configuration watcher thread.
+	static std::shared_ptr<const ConfigBaseline> LoadConfig(const std::string &fileName);
+
 	void ReadStatus(FILEHANDLE scn);
 	void WriteStatus(FILEHANDLE scn) const;
 
@@ -89,6 +313,24 @@ public:
 	bool AddCamera(int camera, CameraData cameraData) override;
 	bool DeleteCamera(int camera) override;
 
+	void BeginUpdate() override;
+	void EndUpdate() override;
+
+	int GetLayout() override;
+	bool SetLayout(int layout) override;
+
+	bool SetCameraPath(int camera, const CameraKey *keys, int count, bool loop) override;
+	bool RestartCameraPath(int camera) override;
+
+	bool SetCameraTarget(int camera, OBJHANDLE hTarget, int dock) override;
+	OBJHANDLE GetCameraTarget(int camera) override;
+
+	// Returns the capture of the camera view, or nullptr if it isn't recording
+	const FrameCapture *GetCapture() const { return capture.get(); }
+
+	// Returns true while the configuration file is being loaded, and the default camera is shown
+	bool IsConfigPending() const { return data->configPending; }
+
 private:
 	InternalData defaultCam;
 
@@ -106,14 +348,29 @@ private:
 		INFO_FULL
 	};
 
+	// The fields of a compact camera line which are read, as the separate items which would be written
+	enum CompactField
+	{
+		COMPACT_POSE = 1,     // The position and angles set by the configuration file
+		COMPACT_LABEL_FOV = 2 // The label and the FOV, if the MFD isn't controlled by vessel
+	};
+
+	// The changes which are committed once per frame by Update
+	enum DirtyFlag
+	{
+		DIRTY_POSE = 1,    // The camera position and direction
+		DIRTY_FOV = 2,     // The camera FOV
+		DIRTY_SURFACE = 4, // The render target surface
+		DIRTY_BUTTONS = 8, // The buttons layout
+		DIRTY_TILES = 16,  // The cameras shown by the layout tiles
+
+		DIRTY_CAMERA = DIRTY_POSE | DIRTY_FOV | DIRTY_TILES // A switch to another camera
+	};
+
 	MFD_Data *data = nullptr;
 	oapi::Font *font;
-	SURFHANDLE hRenderSrf = nullptr;
-	CAMERAHANDLE hCamera = nullptr;
 
-	std::vector<char*> buttonsLabel;
-	std::vector<DWORD> buttons;
-	std::vector<MFDBUTTONMENU> buttonsMenu;
+	const ButtonLayout *buttonLayout = nullptr; // The current buttons layout, in the ButtonLayouts tables
 
 	bool instanceSent = false;     // If the MFD instance is sent to the vessel that created it
 	bool loadConfig = true;        // If the MFD should load a configuration file (true if no data are saved in the scenario)
@@ -121,20 +378,119 @@ private:
 	bool dataExist = false;        // If there are saved data for this MFD instance
 	bool vesselControlled = false; // If the MFD is controlled by vessel
 
-	int ignoreImmediateMouse = 0;
-	int ignoreImmediateKey = 0;
-	bool immediateCall = false;
+	int dirty = 0;               // The DirtyFlag flags of the changes to commit
+	int updateDepth = 0;         // The nesting depth of the API update batches
+	bool updatePending = false;  // If an API call in a batch changed the cameras
+
+	int readItems = 0;   // The MFD_Data::Item flags of the items read by the last ReadStatus
+	int configReads = 0; // The count of configuration files read as text
+
+	// The files read by the configuration file being read and its CCFG items, which are watched with it, and the nesting depth of the reads
+	std::vector<std::string> configSources;
+	int configDepth = 0;
+
+	AdjustEngine keyAdjust;   // The held keyboard key
+	AdjustEngine mouseAdjust; // The held MFD button
+
+	static std::vector<Camera_MFD*> openMFDs;
+	static std::unique_ptr<PerfLog> perfLog;
+	static std::unique_ptr<ConfigWatcher> configWatcher;
+
+	RenderGovernor governor;
+	bool cameraOn = true;    // If the custom camera is switched on
+	double resolution = 1;   // The render resolution scale set by the governor, in steps of 1 / resolutionSteps
+
+	static constexpr int resolutionSteps = 8;
+
+	static constexpr size_t tilesPerFrame = 2; // The most tiles refreshed in a frame
+	size_t nextTile = 0;                       // The first tile to refresh in the next frame
+
+	// The overlay texts of the full information mode
+	struct
+	{
+		OverlayText resolution;
+		OverlayText pos[3];
+		OverlayText pitch;
+		OverlayText yaw;
+		OverlayText rot;
+		OverlayText fov;
+		OverlayText target;
+	} overlay;
+
+	// The diagnostics page texts, formatted again at an interval as the counters change every frame
+	std::array<OverlayText, 9> diagnostics;
+	double diagnosticsTime = -1;   // The system time the diagnostics texts were last formatted
+	size_t diagnosticsSample = 0;  // Changes the texts keys, to format them again
+
+	static constexpr double diagnosticsInterval = 0.5;
+
+	std::unique_ptr<FrameCapture> capture;
+	int captureFormat = FrameCapture::FORMAT_QOI;
+
+	void preStep();
+	void drawDiagnostics(oapi::Sketchpad *skp);
+	static void samplePerfLog();
+	void followPath();
+	bool aimAtTarget(bool force);
+	void setTarget(InternalData &camData, OBJHANDLE hTarget, int dock);
+
+	// The camera changes of the API functions, which the keys use too, so only the API calls are counted as such
+	bool setCameraData(int camera, const CameraData &cameraData);
+	bool addNewCamera(int camera);
+	bool deleteCamera(int camera);
+	void updateSurface();
+	void startCapture();
+	void setupTiles();
+
+	// Returns the MFD area of a layout tile. Tile 0 is the current camera view.
+	RECT tileRect(int tile) const;
 
 	void setButtons();
 	void readConfig(std::string fileName);
-	void setCamData(int cam, double pitchAngle, double yawAngle, double rotAngle);
+	void watchConfig(const std::string &fileName);
+	// Loads the configuration file on the watcher thread. The MFD shows the default camera until it's loaded.
+	void requestConfig(const std::string &fileName);
+	// Sets the cameras and the MFD items from the configuration file once it's loaded,
+	// or sets the cameras base data from its new snapshot after it changed, keeping the user offsets
+	void adoptConfig();
+
+	// Returns a camera with the default data
+	static InternalData newCamera();
+	// Adds or replaces a camera with the passed data, at the MFD default render rate and scale
+	static InternalData &addCamera(MFD_Data *data, int id, const InternalData &camera);
+
+	// Reads the MFD items of a scenario or a configuration file into the data, until END_MFD. Returns the MFD_Data::Item flags of the MFD items read.
+	// nextLine gets the next line as oapiReadScenario_nextline. include loads the file of a CCFG or CBASE item, and the reading stops after CCFG.
+	// The configuration file angles set the camera direction only if configLoaded, which include may set.
+	template <typename NextLine, typename Include>
+	static int readLines(MFD_Data *data, NextLine nextLine, Include include, const bool &configLoaded);
+
+	// Reads a configuration file without the Orbiter API, following up to maxIncludes CCFG and CBASE items.
+	// Returns the MFD_Data::Item flags of the MFD items read, and adds the files read to sources.
+	static int parseConfig(const std::string &fileName, MFD_Data *data, int depth, std::vector<std::string> &sources);
+	static constexpr int maxIncludes = 8;
+
+	// Resets the items which are out of range, as the buttons and the display depend on them
+	static void validateData(MFD_Data *data);
+	// Applies the items of the loaded data which are module settings: starts the performance log and sets the parked cameras cap
+	void applyModuleItems();
+
+	// Writes a camera into the scenario. If the camera has a configuration file baseline, only the items which differ from it are written.
+	void writeCamera(FILEHANDLE scn, int id, const InternalData &cam, const InternalData *base) const;
+	static void setCamData(InternalData &camData, double pitchAngle, double yawAngle, double rotAngle);
 	void setCustomCamera();
+	void applyUpdate();
+	void commitChanges();
 
-	void moveCamLeft();
-	void moveCamRight();
-	void moveCamUp();
-	void moveCamDown();
-	void moveCamForward();
-	void moveCamBackward();
+	// The move functions take the number of steps to move, which can be fractional for held keys
+	void moveCamLeft(double steps = 1);
+	void moveCamRight(double steps = 1);
+	void moveCamUp(double steps = 1);
+	void moveCamDown(double steps = 1);
+	void moveCamForward(double steps = 1);
+	void moveCamBackward(double steps = 1);
+	bool zoomCam(double angle);
 	void resetCam();
+
+	bool adjustCam(DWORD key, double adjustTime);
 };
\ No newline at end of file
@@ -114,4 +114,82 @@ public:
 	virtual bool DeleteCamera(int camera) = 0;
 
 	virtual ~CameraMFD() { }
+
+	// The methods below are declared after the destructor, to keep the order of the methods above for the vessels built with earlier versions.
+
+	// Starts a batch of changes, to set up many cameras at once.
+	// Until the batch ends, SetCurrentCamera, SetCameraData, AddCamera and DeleteCamera change the camera data only.
+	// The MFD buttons and the camera view are updated once, by the first MFD update after the batch ends.
+	// Batches can be nested. The changes are applied when the outermost batch ends.
+	virtual void BeginUpdate() = 0;
+
+	// Ends a batch of changes started by BeginUpdate.
+	virtual void EndUpdate() = 0;
+
+	// The multi-view layouts.
+	//	LAYOUT_SINGLE: the current camera only. This is the default layout.
+	//	LAYOUT_PIP: the current camera, with the next camera in a picture-in-picture inset.
+	//	LAYOUT_2X2: the current camera and the next 3 cameras in a 2x2 grid.
+	//	LAYOUT_3X3: the current camera and the next 8 cameras in a 3x3 grid.
+	// The cameras besides the current one are refreshed in turns, a few per frame.
+	enum Layout
+	{
+		LAYOUT_SINGLE = 0,
+		LAYOUT_PIP,
+		LAYOUT_2X2,
+		LAYOUT_3X3
+	};
+
+	// Returns the current layout, as the Layout enum.
+	virtual int GetLayout() = 0;
+
+	// Sets the layout.
+	// Parameters:
+	//	layout: the layout as the Layout enum.
+	// Returns true if the layout is changed, false if the passed layout is invalid.
+	virtual bool SetLayout(int layout) = 0;
+
+	// A key of a camera path.
+	//	time: the key time in seconds. The path starts at the time of its first key.
+	//	pos, pitchAngle, yawAngle, rotAngle, fov: the camera data at the key, as in the CameraData struct.
+	struct CameraKey
+	{
+		double time;
+
+		VECTOR3 pos;
+		double pitchAngle;
+		double yawAngle;
+		double rotAngle;
+		double fov;
+	};
+
+	// Sets the path of the passed camera. The camera moves along the path smoothly through the keys while it's the current camera.
+	// While the camera has a path, the path sets the camera position, angles and FOV. The user adjustments are added to them.
+	// The path time starts from the first key when the path is set.
+	// Parameters:
+	//	camera: the camera number.
+	//	keys: the path keys, in any order. Of the keys with the same time, the last one is kept.
+	//	count: the keys count. Pass 0 to remove the camera path, the camera will stay where the path left it.
+	//	loop: true to start the path over after its last key, false to stop at the last key.
+	// Returns true if the path is set, false if the passed number is invalid.
+	virtual bool SetCameraPath(int camera, const CameraKey *keys, int count, bool loop) = 0;
+
+	// Starts the path of the passed camera over from its first key.
+	// Parameters:
+	//	camera: the camera number.
+	// Returns true if the path is restarted, false if the passed number is invalid or the camera has no path.
+	virtual bool RestartCameraPath(int camera) = 0;
+
+	// Sets the target of the passed camera. The camera keeps pointing at the target from its position, while it's the current camera.
+	// The camera points at the target again when its direction changes by more than the tracking tolerance (CTRKTOL, 0.1 degrees by default).
+	// The user direction adjustments are added to the target direction.
+	// Parameters:
+	//	camera: the camera number.
+	//	hTarget: the target vessel handle, or nullptr to stop tracking. The camera will stay in its last direction.
+	//	dock: the docking port of the target to point at, or -1 to point at the target center.
+	// Returns true if the target is set, false if the camera number, the target or the docking port is invalid.
+	virtual bool SetCameraTarget(int camera, OBJHANDLE hTarget, int dock) = 0;
+
+	// Returns the target of the passed camera, or nullptr if the camera doesn't track a target or the number is invalid.
+	virtual OBJHANDLE GetCameraTarget(int camera) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,222 @@
+// =======================================================================================
+// CameraPath.h : Keyframed camera paths.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include "CameraMFD_API.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// A camera path through keyframes of the camera position, angles and FOV.
+// The path is interpolated by Catmull-Rom splines with the key times as the knots, so the keys don't have to be evenly spaced.
+// The path time starts at the first key. Looped paths wrap to the first key after the last one, other paths stop at the last key.
+// Evaluation keeps the segment of the last call, so evaluating along the path is constant time with any keys count.
+// The angles turn the shortest way between the keys, so the keys of 350 and 10 degrees turn through 0 instead of 180.
+class CameraPath
+{
+public:
+	typedef CameraMFD::CameraKey Key;
+
+	// Adds a key, in the order of the key times. A key with the time of an existing key replaces it.
+	// The key angles are kept within 180 degrees of the previous key, so GetKey may return them a turn apart from the angles added.
+	void AddKey(const Key &key)
+	{
+		auto pos = std::lower_bound(keys.begin(), keys.end(), key.time, [](const PathKey &pathKey, double time) { return pathKey.time < time; });
+
+		if (pos != keys.end() && pos->time == key.time)
+			*pos = toPathKey(key);
+		else
+			keys.insert(pos, toPathKey(key));
+
+		unwrapAngles();
+		tangentsValid = false;
+	}
+
+	// Sets all the keys, in any order. Of the keys with the same time, the last one is kept.
+	void SetKeys(const Key *newKeys, size_t count)
+	{
+		keys.resize(count);
+
+		for (size_t key = 0; key < count; key++)
+			keys[key] = toPathKey(newKeys[key]);
+
+		std::stable_sort(keys.begin(), keys.end(), [](const PathKey &first, const PathKey &second) { return first.time < second.time; });
+
+		size_t kept = 0;
+
+		for (size_t key = 0; key < keys.size(); key++)
+		{
+			if (kept > 0 && keys[kept - 1].time == keys[key].time)
+				keys[kept - 1] = keys[key];
+			else
+				keys[kept++] = keys[key];
+		}
+
+		keys.resize(kept);
+		unwrapAngles();
+		cursor = 0;
+		tangentsValid = false;
+	}
+
+	void Clear()
+	{
+		keys.clear();
+		cursor = 0;
+	}
+
+	bool Empty() const { return keys.empty(); }
+	size_t GetKeyCount() const { return keys.size(); }
+
+	Key GetKey(size_t index) const { return toKey(keys[index].time, keys[index].values); }
+
+	// The time from the first key to the last key, in seconds
+	double GetDuration() const { return keys.empty() ? 0 : keys.back().time - keys.front().time; }
+
+	bool GetLoop() const { return loop; }
+	void SetLoop(bool loop) { this->loop = loop; }
+
+	// Returns the camera key at the passed path time, in seconds from the first key
+	Key Evaluate(double time)
+	{
+		if (keys.size() < 2)
+			return keys.empty() ? Key{} : GetKey(0);
+
+		if (!tangentsValid)
+			updateTangents();
+
+		double duration = GetDuration();
+
+		if (loop && duration > 0)
+			time = std::fmod(time, duration) + (time < 0 ? duration : 0);
+
+		time = (std::min)((std::max)(time, 0.0), duration) + keys.front().time;
+
+		findSegment(time);
+
+		const PathKey &start = keys[cursor];
+		const PathKey &end = keys[cursor + 1];
+
+		// Cubic Hermite interpolation between the segment keys
+		double length = end.time - start.time;
+		double s = length > 0 ? (time - start.time) / length : 0;
+		double s2 = s * s;
+		double s3 = s2 * s;
+
+		double h00 = 2 * s3 - 3 * s2 + 1;
+		double h10 = (s3 - 2 * s2 + s) * length;
+		double h01 = -2 * s3 + 3 * s2;
+		double h11 = (s3 - s2) * length;
+
+		double values[channels];
+
+		for (int channel = 0; channel < channels; channel++)
+			values[channel] = h00 * start.values[channel] + h10 * start.tangents[channel] + h01 * end.values[channel] + h11 * end.tangents[channel];
+
+		return toKey(time, values);
+	}
+
+	// The index of the segment start key of the last evaluation
+	size_t GetCursor() const { return cursor; }
+
+private:
+	// The position (3 channels), pitch, yaw, rotation and FOV
+	static constexpr int channels = 7;
+	static constexpr int firstAngle = 3;
+	static constexpr int lastAngle = 5;
+
+	struct PathKey
+	{
+		double time;
+		double values[channels];
+		double tangents[channels]; // The values change rates at the key, in units per second
+	};
+
+	std::vector<PathKey> keys;
+	size_t cursor = 0;          // The segment start key of the last evaluation
+	bool tangentsValid = false;
+	bool loop = true;
+
+	static PathKey toPathKey(const Key &key)
+	{
+		return { key.time, { key.pos.x, key.pos.y, key.pos.z, key.pitchAngle, key.yawAngle, key.rotAngle, key.fov }, { } };
+	}
+
+	static Key toKey(double time, const double *values)
+	{
+		return { time, _V(values[0], values[1], values[2]), values[3], values[4], values[5], values[6] };
+	}
+
+	// Sets the key angles to within 180 degrees of the previous key, so each segment turns the shortest way
+	void unwrapAngles()
+	{
+		for (size_t key = 1; key < keys.size(); key++)
+		{
+			for (int channel = firstAngle; channel <= lastAngle; channel++)
+			{
+				double prev = keys[key - 1].values[channel];
+				keys[key].values[channel] = prev + std::remainder(keys[key].values[channel] - prev, 360.0);
+			}
+		}
+	}
+
+	// Sets the tangents as the slopes between the neighbour keys (the Catmull-Rom tangents), or the slope of the segment at the end keys
+	void updateTangents()
+	{
+		for (size_t key = 0; key < keys.size(); key++)
+		{
+			const PathKey &prev = keys[key > 0 ? key - 1 : key];
+			const PathKey &next = keys[key + 1 < keys.size() ? key + 1 : key];
+			double length = next.time - prev.time;
+
+			for (int channel = 0; channel < channels; channel++)
+				keys[key].tangents[channel] = length > 0 ? (next.values[channel] - prev.values[channel]) / length : 0;
+		}
+
+		tangentsValid = true;
+	}
+
+	// Moves the cursor to the segment which holds the passed time
+	void findSegment(double time)
+	{
+		if (cursor + 1 >= keys.size())
+			cursor = 0;
+
+		// The time is usually in the same segment or a few segments ahead
+		for (int step = 0; step < 4; step++)
+		{
+			if (time < keys[cursor].time)
+				break;
+
+			if (time <= keys[cursor + 1].time)
+				return;
+
+			if (cursor + 2 >= keys.size())
+				return;
+
+			cursor++;
+		}
+
+		// Otherwise search the segment, such as when the path loops
+		auto next = std::upper_bound(keys.begin() + 1, keys.end() - 1, time, [](double time, const PathKey &pathKey) { return time < pathKey.time; });
+		cursor = size_t(next - keys.begin()) - 1;
+	}
+};
@@ -0,0 +1,476 @@
+// =======================================================================================
+// ConfigCache.cpp : The compiled binary cache of the vessel configuration files.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "ConfigCache.h"
+#include "Trace.h"
+
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> ConfigCache::enabled = true;
+
+namespace
+{
+	const uint32_t cacheMagic = 0x43464D43; // "CMFC"
+	const uint32_t cacheVersion = 11;
+
+	// The configuration files are in the Config folder of Orbiter, which is the working folder
+	const char *configRoot = "Config/";
+
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+
+		uint32_t cameraCount;
+		uint32_t keyCount;
+		uint32_t labelBytes;
+
+		uint32_t readItems;
+		int32_t adj;
+		int32_t page;
+		int32_t camInfo;
+		int32_t cam;
+		int32_t layout;
+		int32_t compactStatus;
+		int32_t deltaStatus;
+		int32_t maxParked;
+
+		double frameBudget;
+		double defaultRate;
+		double defaultScale;
+		double minScale;
+		double trackTolerance;
+		double perfLogInterval;
+	};
+
+	struct CacheCamera
+	{
+		int32_t id;
+		uint32_t labelOffset;
+		uint32_t labelLength;
+		uint32_t flags; // The user control policy, multipleAdj and the path loop
+		uint32_t keyOffset;
+		uint32_t keyCount;
+		uint32_t targetOffset; // The target name, in the labels table
+		uint32_t targetLength;
+		int32_t targetDock;
+		uint32_t reserved;
+
+		double pos[3];
+		double pitchAngle;
+		double yawAngle;
+		double rotAngle;
+		double fov;
+
+		double userPos[3];
+		double userPitch;
+		double userYaw;
+		double userRot;
+		double userFOV;
+
+		double dir[4];
+		double rate;
+		double scale;
+	};
+
+	struct CacheKey
+	{
+		double time;
+		double pos[3];
+		double pitchAngle;
+		double yawAngle;
+		double rotAngle;
+		double fov;
+	};
+
+	enum CameraFlag
+	{
+		FLAG_SELECT_CAMERA = 1,
+		FLAG_CHANGE_FOV = 2,
+		FLAG_CHANGE_POS = 4,
+		FLAG_CHANGE_DIR = 8,
+		FLAG_CHANGE_ROT = 16,
+		FLAG_MULTIPLE_ADJ = 32,
+		FLAG_PATH_LOOP = 64
+	};
+
+	// Gets the size and modification time of a file. Returns false if the file doesn't exist.
+	bool getFileStamp(const std::string &path, uint64_t &size, int64_t &time)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+			return false;
+
+		size = (uint64_t(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		time = (int64_t(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+		struct stat status;
+
+		if (stat(path.c_str(), &status) != 0)
+			return false;
+
+		size = uint64_t(status.st_size);
+		time = int64_t(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+		return true;
+	}
+
+	// A read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string &path)
+		{
+#ifdef _WIN32
+			hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+			if (hFile == INVALID_HANDLE_VALUE)
+				return;
+
+			LARGE_INTEGER fileSize;
+
+			if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+				return;
+
+			hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+			if (!hMapping)
+				return;
+
+			view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+			size = view ? size_t(fileSize.QuadPart) : 0;
+#else
+			int file = open(path.c_str(), O_RDONLY);
+
+			if (file < 0)
+				return;
+
+			struct stat status;
+
+			if (fstat(file, &status) == 0 && status.st_size > 0)
+			{
+				view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+				if (view == MAP_FAILED)
+					view = nullptr;
+				else
+					size = size_t(status.st_size);
+			}
+
+			close(file);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (view)
+				UnmapViewOfFile(view);
+
+			if (hMapping)
+				CloseHandle(hMapping);
+
+			if (hFile != INVALID_HANDLE_VALUE)
+				CloseHandle(hFile);
+#else
+			if (view)
+				munmap(view, size);
+#endif
+		}
+
+		const char *Data() const { return static_cast<const char*>(view); }
+		size_t Size() const { return size; }
+
+	private:
+#ifdef _WIN32
+		HANDLE hFile = INVALID_HANDLE_VALUE;
+		HANDLE hMapping = nullptr;
+#endif
+		void *view = nullptr;
+		size_t size = 0;
+	};
+}
+
+std::string ConfigCache::GetCachePath(const std::string &configFile) { return configRoot + configFile + 'c'; }
+
+std::string ConfigCache::GetSourcePath(const std::string &configFile) { return configRoot + configFile; }
+
+bool ConfigCache::GetFileStamp(const std::string &configFile, uint64_t &size, int64_t &time) { return getFileStamp(configRoot + configFile, size, time); }
+
+bool ConfigCache::Load(const std::string &configFile, MFD_Data *data, int *readItems)
+{
+	TRACE_ZONE("ConfigCache::Load");
+
+	if (!enabled)
+		return false;
+
+	uint64_t sourceSize;
+	int64_t sourceTime;
+
+	if (!getFileStamp(configRoot + configFile, sourceSize, sourceTime))
+		return false;
+
+	MappedFile cache(GetCachePath(configFile));
+
+	if (cache.Size() < sizeof(CacheHeader))
+		return false;
+
+	const CacheHeader *header = reinterpret_cast<const CacheHeader*>(cache.Data());
+
+	if (header->magic != cacheMagic || header->version != cacheVersion || header->sourceSize != sourceSize || header->sourceTime != sourceTime)
+		return false;
+
+	if (header->cameraCount == 0 || cache.Size() != sizeof(CacheHeader) + header->cameraCount * sizeof(CacheCamera) +
+		header->keyCount * sizeof(CacheKey) + header->labelBytes)
+		return false;
+
+	const CacheCamera *cameras = reinterpret_cast<const CacheCamera*>(header + 1);
+	const CacheKey *keys = reinterpret_cast<const CacheKey*>(cameras + header->cameraCount);
+	const char *labels = reinterpret_cast<const char*>(keys + header->keyCount);
+
+	data->camMap.clear();
+	data->camMap.reserve(header->cameraCount);
+
+	for (uint32_t cameraIndex = 0; cameraIndex < header->cameraCount; cameraIndex++)
+	{
+		const CacheCamera &camera = cameras[cameraIndex];
+
+		if (uint64_t(camera.labelOffset) + camera.labelLength > header->labelBytes || uint64_t(camera.keyOffset) + camera.keyCount > header->keyCount ||
+			uint64_t(camera.targetOffset) + camera.targetLength > header->labelBytes)
+		{
+			data->camMap.clear();
+			return false;
+		}
+
+		InternalData &camData = data->camMap[camera.id];
+
+		camData.label.assign(labels + camera.labelOffset, camera.labelLength);
+
+		camData.pos = _V(camera.pos[0], camera.pos[1], camera.pos[2]);
+		camData.pitchAngle = camera.pitchAngle;
+		camData.yawAngle = camera.yawAngle;
+		camData.rotAngle = camera.rotAngle;
+		camData.fov = camera.fov;
+
+		camData.userPos = _V(camera.userPos[0], camera.userPos[1], camera.userPos[2]);
+		camData.userPitch = camera.userPitch;
+		camData.userYaw = camera.userYaw;
+		camData.userRot = camera.userRot;
+		camData.userFOV = camera.userFOV;
+
+		camData.dir = { camera.dir[0], camera.dir[1], camera.dir[2], camera.dir[3] };
+		camData.rate = camera.rate;
+		camData.scale = camera.scale;
+
+		camData.userControl.selectCamera = (camera.flags & FLAG_SELECT_CAMERA) != 0;
+		camData.userControl.changeFOV = (camera.flags & FLAG_CHANGE_FOV) != 0;
+		camData.userControl.changePos = (camera.flags & FLAG_CHANGE_POS) != 0;
+		camData.userControl.changeDir = (camera.flags & FLAG_CHANGE_DIR) != 0;
+		camData.userControl.changeRot = (camera.flags & FLAG_CHANGE_ROT) != 0;
+		camData.multipleAdj = (camera.flags & FLAG_MULTIPLE_ADJ) != 0;
+
+		// The keys are saved in the order of their times
+		camData.path.Clear();
+		camData.path.SetLoop((camera.flags & FLAG_PATH_LOOP) != 0);
+
+		for (uint32_t keyIndex = camera.keyOffset; keyIndex < camera.keyOffset + camera.keyCount; keyIndex++)
+		{
+			const CacheKey &key = keys[keyIndex];
+			camData.path.AddKey({ key.time, _V(key.pos[0], key.pos[1], key.pos[2]), key.pitchAngle, key.yawAngle, key.rotAngle, key.fov });
+		}
+
+		camData.pathTime = 0;
+
+		// The target is found by name on the first frame, as read from the text
+		camData.targetName.assign(labels + camera.targetOffset, camera.targetLength);
+		camData.targetDock = camera.targetDock;
+		camData.hTarget = nullptr;
+		camData.aimDir = { 0,0,0 };
+	}
+
+	if (readItems)
+		*readItems = int(header->readItems);
+
+	if (header->readItems & MFD_Data::ITEM_ADJ)
+		data->adj = header->adj;
+
+	if (header->readItems & MFD_Data::ITEM_PAGE)
+		data->page = header->page;
+
+	if (header->readItems & MFD_Data::ITEM_INFO)
+		data->camInfo = header->camInfo;
+
+	if (header->readItems & MFD_Data::ITEM_CAM)
+		data->cam = header->cam;
+
+	if (header->readItems & MFD_Data::ITEM_BUDGET)
+		data->frameBudget = header->frameBudget;
+
+	if (header->readItems & MFD_Data::ITEM_MINSCALE)
+		data->minScale = header->minScale;
+
+	if (header->readItems & MFD_Data::ITEM_LAYOUT)
+		data->layout = header->layout;
+
+	if (header->readItems & MFD_Data::ITEM_TRACKTOL)
+		data->trackTolerance = header->trackTolerance;
+
+	if (header->readItems & MFD_Data::ITEM_PERFLOG)
+		data->perfLogInterval = header->perfLogInterval;
+
+	if (header->readItems & MFD_Data::ITEM_COMPACT)
+		data->compactStatus = header->compactStatus != 0;
+
+	if (header->readItems & MFD_Data::ITEM_DELTA)
+		data->deltaStatus = header->deltaStatus != 0;
+
+	if (header->readItems & MFD_Data::ITEM_MAXPARK)
+		data->maxParked = header->maxParked;
+
+	if (header->readItems & MFD_Data::ITEM_RATE)
+		data->defaultRate = header->defaultRate;
+
+	if (header->readItems & MFD_Data::ITEM_SCALE)
+		data->defaultScale = header->defaultScale;
+
+	return true;
+}
+
+bool ConfigCache::Save(const std::string &configFile, const MFD_Data *data, int readItems)
+{
+	TRACE_ZONE("ConfigCache::Save");
+
+	if (!enabled || data->camMap.empty())
+		return false;
+
+	CacheHeader header = {};
+	header.magic = cacheMagic;
+	header.version = cacheVersion;
+
+	if (!getFileStamp(configRoot + configFile, header.sourceSize, header.sourceTime))
+		return false;
+
+	std::vector<CacheCamera> cameras;
+	cameras.reserve(data->camMap.size());
+
+	std::vector<CacheKey> keys;
+
+	// The labels string table, with each label stored once
+	std::string labels;
+	std::unordered_map<std::string, uint32_t> labelOffsets;
+
+	auto intern = [&](const std::string &label)
+	{
+		auto offset = labelOffsets.find(label);
+
+		if (offset == labelOffsets.end())
+		{
+			offset = labelOffsets.emplace(label, uint32_t(labels.size())).first;
+			labels += label;
+		}
+
+		return offset->second;
+	};
+
+	for (const auto &camData : data->camMap)
+	{
+		const InternalData &cam = camData.second;
+
+		CacheCamera camera = { camData.first, intern(cam.label), uint32_t(cam.label.size()), 0, uint32_t(keys.size()), uint32_t(cam.path.GetKeyCount()),
+			intern(cam.targetName), uint32_t(cam.targetName.size()), cam.targetDock, 0,
+			{ cam.pos.x, cam.pos.y, cam.pos.z }, cam.pitchAngle, cam.yawAngle, cam.rotAngle, cam.fov,
+			{ cam.userPos.x, cam.userPos.y, cam.userPos.z }, cam.userPitch, cam.userYaw, cam.userRot, cam.userFOV,
+			{ cam.dir.w, cam.dir.x, cam.dir.y, cam.dir.z }, cam.rate, cam.scale };
+
+		camera.flags = (cam.userControl.selectCamera ? FLAG_SELECT_CAMERA : 0) | (cam.userControl.changeFOV ? FLAG_CHANGE_FOV : 0) |
+		               (cam.userControl.changePos ? FLAG_CHANGE_POS : 0) | (cam.userControl.changeDir ? FLAG_CHANGE_DIR : 0) |
+		               (cam.userControl.changeRot ? FLAG_CHANGE_ROT : 0) | (cam.multipleAdj ? FLAG_MULTIPLE_ADJ : 0) |
+		               (cam.path.GetLoop() ? FLAG_PATH_LOOP : 0);
+
+		for (size_t index = 0; index < cam.path.GetKeyCount(); index++)
+		{
+			CameraMFD::CameraKey key = cam.path.GetKey(index);
+			keys.push_back({ key.time, { key.pos.x, key.pos.y, key.pos.z }, key.pitchAngle, key.yawAngle, key.rotAngle, key.fov });
+		}
+
+		cameras.push_back(camera);
+	}
+
+	header.cameraCount = uint32_t(cameras.size());
+	header.keyCount = uint32_t(keys.size());
+	header.labelBytes = uint32_t(labels.size());
+	header.readItems = uint32_t(readItems);
+	header.adj = data->adj;
+	header.page = data->page;
+	header.camInfo = data->camInfo;
+	header.cam = data->cam;
+	header.layout = data->layout;
+	header.compactStatus = data->compactStatus;
+	header.deltaStatus = data->deltaStatus;
+	header.maxParked = data->maxParked;
+	header.frameBudget = data->frameBudget;
+	header.defaultRate = data->defaultRate;
+	header.defaultScale = data->defaultScale;
+	header.minScale = data->minScale;
+	header.trackTolerance = data->trackTolerance;
+	header.perfLogInterval = data->perfLogInterval;
+
+	// Write into a temporary file, then replace the cache, so a partially written cache is never loaded
+	std::string cachePath = GetCachePath(configFile);
+	// The temporary file is named by the thread, as the configuration watcher thread may save the same cache
+	std::string tempPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	FILE *file = fopen(tempPath.c_str(), "wb");
+
+	if (!file)
+		return false;
+
+	// An empty vector may have no data pointer, which fwrite mustn't be passed
+	auto writeItems = [file](const void *items, size_t size, size_t count) { return count == 0 || fwrite(items, size, count, file) == count; };
+
+	bool written = writeItems(&header, sizeof(header), 1) &&
+	               writeItems(cameras.data(), sizeof(CacheCamera), cameras.size()) &&
+	               writeItems(keys.data(), sizeof(CacheKey), keys.size()) &&
+	               writeItems(labels.data(), 1, labels.size());
+
+	if (fclose(file) != 0 || !written)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+
+	remove(cachePath.c_str());
+
+	return rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
@@ -0,0 +1,50 @@
+// =======================================================================================
+// ConfigCache.h : The compiled binary cache of the vessel configuration files.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include "CameraMFD.h"
+
+#include <atomic>
+
+// The configuration files are compiled into a binary cache beside them (CameraMFD/<class>.cfgc), after they are read as text.
+// The cache holds the MFD data as read from the text: a fixed-layout record per camera, the camera path keys, the labels and target names interned in a string table,
+// and the size and modification time of the text file, so it's rebuilt when the text file changes.
+// Later loads memory-map the cache instead of parsing the text.
+class ConfigCache
+{
+public:
+	static std::atomic<bool> enabled; // Set false to always read the configuration text files
+
+	// Loads the cache of a configuration file (relative to the Orbiter Config folder) into the MFD data.
+	// Only the MFD items flagged in the cache (the MFD_Data::Item flags) are set, and the flags are returned in readItems if it's passed.
+	// Returns false if there is no cache or it's outdated, so the text file should be read instead.
+	static bool Load(const std::string &configFile, MFD_Data *data, int *readItems = nullptr);
+
+	// Saves the MFD data as just read from a configuration file into its cache.
+	// readItems are the MFD_Data::Item flags of the MFD items read from the file. It's called by the configuration watcher thread too.
+	static bool Save(const std::string &configFile, const MFD_Data *data, int readItems);
+
+	static std::string GetCachePath(const std::string &configFile);
+	static std::string GetSourcePath(const std::string &configFile);
+
+	// Gets the size and modification time of a configuration file. Returns false if the file doesn't exist.
+	static bool GetFileStamp(const std::string &configFile, uint64_t &size, int64_t &time);
+};
@@ -0,0 +1,202 @@
+// =======================================================================================
+// ConfigWatcher.cpp : The configuration files watcher, which parses them again when they change.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "ConfigWatcher.h"
+#include "ConfigCache.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	std::string getConfigFile(const std::string &fileName) { return "CameraMFD/" + fileName + ".cfg"; }
+}
+
+ConfigWatcher::ConfigWatcher(Parser parser) : parser(std::move(parser))
+{
+	watcher = std::thread(&ConfigWatcher::work, this);
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_one();
+	watcher.join();
+}
+
+std::shared_ptr<ConfigWatcher::File> ConfigWatcher::Watch(const std::string &fileName, const std::vector<std::string> &sources)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (auto file = find(fileName))
+		return file;
+
+	auto file = std::make_shared<File>();
+	file->name = fileName;
+
+	// The MFD just loaded the files, so they only change after these stamps. The file itself is the first source.
+	std::vector<std::string> names = { fileName };
+
+	for (const std::string &source : sources)
+		if (std::find(names.begin(), names.end(), source) == names.end())
+			names.push_back(source);
+
+	for (const std::string &source : names)
+	{
+		File::Source stamp = { source, false, 0, 0 };
+		stamp.stamped = ConfigCache::GetFileStamp(getConfigFile(source), stamp.size, stamp.time);
+
+		file->sources.push_back(stamp);
+	}
+
+	files.push_back(file);
+
+	return file;
+}
+
+std::shared_ptr<ConfigWatcher::File> ConfigWatcher::Load(const std::string &fileName)
+{
+	std::shared_ptr<File> file;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		file = find(fileName);
+
+		if (file)
+			return file;
+
+		file = std::make_shared<File>();
+		file->name = fileName;
+		file->sources.push_back({ fileName, false, 0, 0 });
+
+		files.push_back(file);
+		loading = true;
+	}
+
+	wake.notify_one();
+
+	return file;
+}
+
+std::shared_ptr<ConfigWatcher::File> ConfigWatcher::find(const std::string &fileName) const
+{
+	for (const auto &file : files)
+		if (file->name == fileName)
+			return file;
+
+	return nullptr;
+}
+
+size_t ConfigWatcher::GetFileCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return files.size();
+}
+
+void ConfigWatcher::work()
+{
+	std::vector<std::shared_ptr<File>> polled;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait_for(lock, std::chrono::duration<double>(interval.load()), [this] { return stopping || loading; });
+
+			if (stopping)
+				return;
+
+			polled = files;
+			loading = false;
+		}
+
+		for (const auto &file : polled)
+		{
+			bool changed = false;
+
+			for (auto &source : file->sources)
+			{
+				uint64_t size;
+				int64_t time;
+
+				// A deleted include changes the file too, but the file itself must exist to be parsed
+				if (!ConfigCache::GetFileStamp(getConfigFile(source.name), size, time))
+				{
+					if (source.stamped && &source != &file->sources.front())
+					{
+						source.stamped = false;
+						changed = true;
+					}
+
+					continue;
+				}
+
+				if (source.stamped && size == source.size && time == source.time)
+					continue;
+
+				source = { source.name, true, size, time };
+				changed = true;
+			}
+
+			if (!changed || !file->sources.front().stamped)
+				continue;
+
+			TRACE_ZONE("ConfigWatcher::parse");
+
+			// A file which is being written may have no cameras yet. It's parsed again when the writing changes its stamp.
+			std::shared_ptr<const ConfigBaseline> snapshot = parser(file->name);
+
+			if (!snapshot)
+				continue;
+
+			// Watch the files it includes now, keeping the stamps taken before parsing
+			std::vector<File::Source> sources;
+
+			for (const std::string &name : snapshot->sources)
+			{
+				auto source = std::find_if(file->sources.begin(), file->sources.end(), [&name](const File::Source &source) { return source.name == name; });
+
+				if (source != file->sources.end())
+					sources.push_back(*source);
+				else
+				{
+					File::Source stamp = { name, false, 0, 0 };
+					stamp.stamped = ConfigCache::GetFileStamp(getConfigFile(name), stamp.size, stamp.time);
+
+					sources.push_back(stamp);
+				}
+			}
+
+			if (!sources.empty())
+				file->sources = std::move(sources);
+
+			std::atomic_store(&file->snapshot, snapshot);
+			file->version.fetch_add(1, std::memory_order_release);
+			reloads++;
+		}
+	}
+}
@@ -0,0 +1,108 @@
+// =======================================================================================
+// ConfigWatcher.h : The configuration files watcher, which parses them again when they change.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ConfigBaseline;
+
+// Loads the configuration files of the MFDs on a background thread, then watches them and parses a changed file again.
+// The thread polls the files size and modification time at an interval, which works the same on every platform.
+// A file is parsed again when it or a file it includes (CCFG and CBASE items) changes.
+// The loaded files are published as immutable snapshots, which the MFDs adopt on their next update.
+// A file is loaded once for all the MFDs, so the MFDs opened after it's loaded adopt it right away.
+class ConfigWatcher
+{
+public:
+	// A watched configuration file. The watcher thread publishes its snapshots, and the simulation thread reads them.
+	class File
+	{
+	public:
+		const std::string &GetName() const { return name; }
+
+		// The count of snapshots published, so the MFDs check for a new snapshot by a single atomic load
+		uint64_t GetVersion() const { return version.load(std::memory_order_acquire); }
+
+		// The last published snapshot, or nullptr if the file isn't loaded yet or didn't change since it was watched
+		std::shared_ptr<const ConfigBaseline> GetSnapshot() const { return std::atomic_load(&snapshot); }
+
+	private:
+		friend class ConfigWatcher;
+
+		std::string name;
+		std::shared_ptr<const ConfigBaseline> snapshot;
+		std::atomic<uint64_t> version{ 0 };
+
+		// A file read to load it, with its stamp when it was last parsed. A file to load has no stamp.
+		struct Source
+		{
+			std::string name;
+			bool stamped;
+			uint64_t size;
+			int64_t time;
+		};
+
+		// The file and the files it includes, used by the watcher thread only once it's watched
+		std::vector<Source> sources;
+	};
+
+	// Loads a configuration file (the name as given to CCFG) into a snapshot, or returns nullptr if it has no cameras. Called by the watcher thread.
+	typedef std::function<std::shared_ptr<const ConfigBaseline>(const std::string &fileName)> Parser;
+
+	static inline std::atomic<double> interval{ 1 }; // The time between the polls of the files, in seconds
+
+	ConfigWatcher(Parser parser);
+
+	// Stops the watcher thread
+	~ConfigWatcher();
+
+	// Watches a configuration file which the MFD loaded, from the current stamps of the files read to load it (the file and its includes).
+	// Returns the same file for the same name.
+	std::shared_ptr<File> Watch(const std::string &fileName, const std::vector<std::string> &sources);
+
+	// Loads a configuration file on the watcher thread, then watches it. Returns the same file for the same name,
+	// so a file which is loaded or being loaded isn't loaded again. If the file doesn't exist, it's loaded once it's created.
+	std::shared_ptr<File> Load(const std::string &fileName);
+
+	size_t GetFileCount() const;
+	size_t GetReloads() const { return reloads.load(); } // The count of changed files parsed
+
+private:
+	Parser parser;
+	std::vector<std::shared_ptr<File>> files;
+	std::atomic<size_t> reloads{ 0 };
+
+	bool stopping = false;
+	bool loading = false; // If there are files to load, which are polled without waiting for the interval
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::thread watcher;
+
+	std::shared_ptr<File> find(const std::string &fileName) const;
+	void work();
+};
@@ -0,0 +1,188 @@
+// =======================================================================================
+// FlatMap.h : A sorted map stored in contiguous arrays.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// A sorted map with the part of the std::map interface used by the MFD.
+// The keys are stored in one contiguous array and the values in a parallel one, so the lookups only touch the keys.
+// The iterators are indices, and the elements are accessed as { first, second } reference pairs.
+// Like the Visual C++ std::map, decrementing begin() gives end().
+// Inserting or erasing invalidates the references and iterators after the changed element.
+template <typename Key, typename Value>
+class FlatMap
+{
+public:
+	// The iterator over the map elements, or over the const map elements if Mapped is const
+	template <typename Map, typename Mapped>
+	class Iterator
+	{
+	public:
+		struct reference
+		{
+			const Key &first;
+			Mapped &second;
+		};
+
+		Iterator(Map *map, size_t index) : map(map), index(index) { }
+
+		reference operator*() const { return { map->keys[index], map->values[index] }; }
+
+		struct pointer
+		{
+			reference ref;
+			reference *operator->() { return &ref; }
+		};
+
+		pointer operator->() const { return { **this }; }
+
+		Iterator &operator++() { index++; return *this; }
+		Iterator &operator--() { index = index == 0 ? map->keys.size() : index - 1; return *this; }
+		Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+		Iterator operator--(int) { Iterator it = *this; --*this; return it; }
+
+		bool operator==(const Iterator &other) const { return index == other.index; }
+		bool operator!=(const Iterator &other) const { return index != other.index; }
+
+		size_t Index() const { return index; }
+
+	private:
+		Map *map;
+		size_t index;
+	};
+
+	typedef Iterator<FlatMap, Value> iterator;
+	typedef Iterator<const FlatMap, const Value> const_iterator;
+	typedef typename iterator::reference reference;
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, keys.size()); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, keys.size()); }
+
+	size_t size() const { return keys.size(); }
+	bool empty() const { return keys.empty(); }
+
+	void clear()
+	{
+		keys.clear();
+		values.clear();
+	}
+
+	void reserve(size_t count)
+	{
+		keys.reserve(count);
+		values.reserve(count);
+	}
+
+	iterator lower_bound(const Key &key) { return iterator(this, lowerIndex(key)); }
+
+	iterator upper_bound(const Key &key)
+	{
+		size_t index = lowerIndex(key);
+
+		if (index < keys.size() && !(key < keys[index]))
+			index++;
+
+		return iterator(this, index);
+	}
+
+	iterator find(const Key &key)
+	{
+		iterator it = lower_bound(key);
+
+		if (it.Index() == keys.size() || keys[it.Index()] != key)
+			return end();
+
+		return it;
+	}
+
+	const_iterator find(const Key &key) const
+	{
+		size_t index = lowerIndex(key);
+
+		if (index == keys.size() || keys[index] != key)
+			return end();
+
+		return const_iterator(this, index);
+	}
+
+	Value &at(const Key &key)
+	{
+		iterator it = find(key);
+
+		if (it == end())
+			throw std::out_of_range("invalid FlatMap key");
+
+		return values[it.Index()];
+	}
+
+	// Returns the value of the key, inserting a default value if the key doesn't exist
+	Value &operator[](const Key &key)
+	{
+		size_t index = lower_bound(key).Index();
+
+		if (index == keys.size() || keys[index] != key)
+		{
+			keys.insert(keys.begin() + index, key);
+			values.insert(values.begin() + index, Value());
+		}
+
+		return values[index];
+	}
+
+	iterator erase(iterator it)
+	{
+		keys.erase(keys.begin() + it.Index());
+		values.erase(values.begin() + it.Index());
+
+		return it;
+	}
+
+	// The largest key. The map must not be empty.
+	const Key &lastKey() const { return keys.back(); }
+
+private:
+	std::vector<Key> keys;
+	std::vector<Value> values;
+
+	// A branchless binary search, as the keys are few enough to be in the cache and the branches are unpredictable
+	size_t lowerIndex(const Key &key) const
+	{
+		if (keys.empty())
+			return 0;
+
+		const Key *base = keys.data();
+		size_t count = keys.size();
+
+		while (count > 1)
+		{
+			size_t half = count / 2;
+			base = base[half] < key ? base + half : base;
+			count -= half;
+		}
+
+		return (base - keys.data()) + (*base < key);
+	}
+};
@@ -0,0 +1,515 @@
+// =======================================================================================
+// FrameCapture.cpp : The asynchronous capture of a render target to image sequences or video.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "FrameCapture.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+namespace
+{
+	// The CRC-32 table of the PNG chunks
+	struct CrcTable
+	{
+		uint32_t entries[256];
+
+		CrcTable()
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+
+				for (int k = 0; k < 8; k++)
+					c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+				entries[n] = c;
+			}
+		}
+	};
+
+	const CrcTable crcTable;
+
+	uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+	{
+		crc = ~crc;
+
+		for (size_t i = 0; i < size; i++)
+			crc = crcTable.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+		return ~crc;
+	}
+
+	void putBE32(std::vector<uint8_t> &out, uint32_t value)
+	{
+		out.insert(out.end(), { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) });
+	}
+
+	// Appends a PNG chunk with its length and CRC
+	void putChunk(std::vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size)
+	{
+		putBE32(out, uint32_t(size));
+
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + size);
+
+		putBE32(out, crc32(&out[start], out.size() - start));
+	}
+}
+
+// ==============================================================
+// Capture
+
+FrameCapture::FrameCapture(const std::string &folder, Format format, DWORD width, DWORD height, double frameRate, size_t ringSize, int workers) :
+	folder(folder), format(format), width(width), height(height), ringSize((std::max)(ringSize, size_t(1))), slots(new Slot[this->ringSize])
+{
+	for (size_t slot = 0; slot < this->ringSize; slot++)
+		slots[slot].pixels.resize(size_t(width) * height * 4);
+
+	std::error_code error;
+	std::filesystem::create_directories(folder, error);
+
+	if (format == FORMAT_Y4M)
+	{
+		video = fopen((folder + "/capture.y4m").c_str(), "wb");
+
+		if (video)
+		{
+			std::string header = Y4MHeader(width, height, frameRate);
+			fwrite(header.data(), 1, header.size(), video);
+		}
+		else
+			failed = true;
+	}
+
+	// Set up the read back into a top-down 32-bit DIB section
+	hStaging = oapiCreateSurfaceEx(width, height, OAPISURFACE_SYSMEM | OAPISURFACE_GDI);
+
+	BITMAPINFO info = {};
+	info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	info.bmiHeader.biWidth = LONG(width);
+	info.bmiHeader.biHeight = -LONG(height);
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+
+	hMemDC = CreateCompatibleDC(nullptr);
+	hBitmap = CreateDIBSection(hMemDC, &info, DIB_RGB_COLORS, reinterpret_cast<void**>(&bitmapBits), nullptr, 0);
+	hOldBitmap = SelectObject(hMemDC, hBitmap);
+
+	runningWorkers = workers;
+
+	for (int worker = 0; worker < workers; worker++)
+		this->workers.emplace_back(&FrameCapture::work, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+	stop();
+
+	for (auto &worker : workers)
+		worker.join();
+
+	if (video)
+		fclose(video);
+}
+
+void FrameCapture::stop()
+{
+	if (stopping.exchange(true))
+		return;
+
+	wake.notify_all();
+
+	SelectObject(hMemDC, hOldBitmap);
+	DeleteObject(hBitmap);
+	DeleteDC(hMemDC);
+
+	oapiDestroySurface(hStaging);
+	bitmapBits = nullptr;
+}
+
+std::vector<std::unique_ptr<FrameCapture>> FrameCapture::finishing;
+
+void FrameCapture::Finish(std::unique_ptr<FrameCapture> capture)
+{
+	if (!capture)
+		return;
+
+	// The read back surfaces are released by the simulation thread
+	capture->stop();
+	finishing.push_back(std::move(capture));
+}
+
+void FrameCapture::DeleteFinished(bool wait)
+{
+	if (wait)
+	{
+		finishing.clear();
+		return;
+	}
+
+	finishing.erase(std::remove_if(finishing.begin(), finishing.end(),
+		[](const std::unique_ptr<FrameCapture> &capture) { return capture->runningWorkers.load(std::memory_order_acquire) == 0; }), finishing.end());
+}
+
+bool FrameCapture::Capture(SURFHANDLE hSurf, DWORD surfWidth, DWORD surfHeight)
+{
+	TRACE_ZONE("FrameCapture::Capture");
+
+	uint64_t frame = head.load(std::memory_order_relaxed);
+	Slot &slot = slots[frame % ringSize];
+
+	// The oldest frame isn't written yet
+	if (slot.ready.load(std::memory_order_acquire) || !bitmapBits)
+	{
+		dropped++;
+		return false;
+	}
+
+	RECT sr = { 0, 0, LONG(surfWidth), LONG(surfHeight) };
+	RECT tr = { 0, 0, LONG(width), LONG(height) };
+	oapiBlt(hStaging, hSurf, &tr, &sr);
+
+	HDC hDC = oapiGetDC(hStaging);
+	BitBlt(hMemDC, 0, 0, int(width), int(height), hDC, 0, 0, SRCCOPY);
+	oapiReleaseDC(hStaging, hDC);
+
+	memcpy(slot.pixels.data(), bitmapBits, slot.pixels.size());
+
+	slot.ready.store(true, std::memory_order_relaxed);
+	head.store(frame + 1, std::memory_order_release);
+
+	maxQueueDepth = (std::max)(maxQueueDepth, size_t(frame + 1 - completed.load(std::memory_order_relaxed)));
+
+	wake.notify_one();
+	return true;
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const
+{
+	uint64_t captured = head.load(std::memory_order_relaxed);
+
+	return { size_t(captured), dropped, written.load(), size_t(captured - completed.load()), maxQueueDepth, failed.load() };
+}
+
+void FrameCapture::work()
+{
+	std::vector<uint8_t> buffer;
+
+	while (true)
+	{
+		uint64_t frame = tail.load(std::memory_order_acquire);
+
+		if (frame < head.load(std::memory_order_acquire))
+		{
+			// Another worker may claim the frame first
+			if (!tail.compare_exchange_weak(frame, frame + 1))
+				continue;
+
+			Slot &slot = slots[frame % ringSize];
+
+			if (write(frame, slot.pixels.data(), buffer))
+				written++;
+			else
+				failed = true;
+
+			slot.ready.store(false, std::memory_order_release);
+			completed++;
+
+			continue;
+		}
+
+		// Stop once the ring is empty
+		if (stopping)
+		{
+			runningWorkers.fetch_sub(1, std::memory_order_release);
+			break;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait_for(lock, std::chrono::milliseconds(10));
+	}
+}
+
+bool FrameCapture::write(uint64_t frame, const uint8_t *pixels, std::vector<uint8_t> &buffer)
+{
+	TRACE_ZONE("FrameCapture::write");
+
+	buffer.clear();
+
+	switch (format)
+	{
+	case FORMAT_PNG:
+		EncodePNG(pixels, width, height, buffer);
+		break;
+
+	case FORMAT_QOI:
+		EncodeQOI(pixels, width, height, buffer);
+		break;
+
+	case FORMAT_Y4M:
+	{
+		EncodeY4MFrame(pixels, width, height, buffer);
+
+		// Wait for the earlier frames to be appended
+		std::unique_lock<std::mutex> lock(videoMutex);
+		videoTurn.wait(lock, [&] { return nextVideoFrame == frame; });
+
+		bool done = video && fwrite(buffer.data(), 1, buffer.size(), video) == buffer.size();
+
+		nextVideoFrame++;
+		videoTurn.notify_all();
+
+		return done;
+	}
+
+	default:
+		return false;
+	}
+
+	char name[32];
+	sprintf_s(name, 32, "/%06llu.%s", (unsigned long long)frame, format == FORMAT_PNG ? "png" : "qoi");
+
+	FILE *file = fopen((folder + name).c_str(), "wb");
+
+	if (!file)
+		return false;
+
+	bool done = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+
+	return fclose(file) == 0 && done;
+}
+
+// ==============================================================
+// Encoders
+
+void FrameCapture::EncodePNG(const uint8_t *pixels, DWORD width, DWORD height, std::vector<uint8_t> &out)
+{
+	static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.insert(out.end(), signature, signature + sizeof(signature));
+
+	// 8-bit RGB, no interlace
+	uint8_t header[13] = { uint8_t(width >> 24), uint8_t(width >> 16), uint8_t(width >> 8), uint8_t(width),
+		uint8_t(height >> 24), uint8_t(height >> 16), uint8_t(height >> 8), uint8_t(height), 8, 2, 0, 0, 0 };
+
+	putChunk(out, "IHDR", header, sizeof(header));
+
+	// The scanlines with no filter, in a zlib stream of stored deflate blocks, as there is no compression library.
+	// The scanlines are PNG-valid and fast to write; QOI is the compressed format.
+	size_t rowSize = size_t(width) * 3 + 1;
+	std::vector<uint8_t> raw(rowSize * height);
+
+	for (DWORD y = 0; y < height; y++)
+	{
+		const uint8_t *px = pixels + size_t(y) * width * 4;
+		uint8_t *row = &raw[rowSize * y];
+
+		*row++ = 0;
+
+		for (DWORD x = 0; x < width; x++, px += 4, row += 3)
+		{
+			row[0] = px[2];
+			row[1] = px[1];
+			row[2] = px[0];
+		}
+	}
+
+	std::vector<uint8_t> idat;
+	idat.reserve(2 + raw.size() + (raw.size() / 0xFFFF + 1) * 5 + 4);
+	idat.insert(idat.end(), { 0x78, 0x01 });
+
+	size_t pos = 0;
+
+	do
+	{
+		uint16_t len = uint16_t((std::min)(raw.size() - pos, size_t(0xFFFF)));
+		bool final = pos + len == raw.size();
+
+		idat.insert(idat.end(), { uint8_t(final ? 1 : 0), uint8_t(len), uint8_t(len >> 8), uint8_t(~len), uint8_t(~len >> 8) });
+		idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+
+		pos += len;
+	} while (pos < raw.size());
+
+	// The Adler-32 sums are reduced every 5552 bytes, the most which can't overflow them
+	uint32_t adlerA = 1, adlerB = 0;
+
+	for (pos = 0; pos < raw.size();)
+	{
+		size_t end = (std::min)(raw.size(), pos + 5552);
+
+		for (; pos < end; pos++)
+		{
+			adlerA += raw[pos];
+			adlerB += adlerA;
+		}
+
+		adlerA %= 65521;
+		adlerB %= 65521;
+	}
+
+	putBE32(idat, (adlerB << 16) | adlerA);
+
+	putChunk(out, "IDAT", idat.data(), idat.size());
+	putChunk(out, "IEND", nullptr, 0);
+}
+
+void FrameCapture::EncodeQOI(const uint8_t *pixels, DWORD width, DWORD height, std::vector<uint8_t> &out)
+{
+	static const uint8_t magic[] = { 'q', 'o', 'i', 'f' };
+	out.insert(out.end(), magic, magic + sizeof(magic));
+
+	putBE32(out, width);
+	putBE32(out, height);
+
+	// RGB, sRGB with linear alpha
+	out.insert(out.end(), { 3, 0 });
+
+	struct Pixel { uint8_t r, g, b, a; };
+
+	Pixel index[64] = {};
+	Pixel prev = { 0, 0, 0, 255 };
+	int run = 0;
+
+	size_t count = size_t(width) * height;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		Pixel px = { pixels[i * 4 + 2], pixels[i * 4 + 1], pixels[i * 4], 255 };
+
+		if (px.r == prev.r && px.g == prev.g && px.b == prev.b)
+		{
+			if (++run == 62 || i == count - 1)
+			{
+				out.push_back(uint8_t(0xC0 | (run - 1)));
+				run = 0;
+			}
+
+			continue;
+		}
+
+		if (run > 0)
+		{
+			out.push_back(uint8_t(0xC0 | (run - 1)));
+			run = 0;
+		}
+
+		int hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+		Pixel &entry = index[hash];
+
+		if (entry.r == px.r && entry.g == px.g && entry.b == px.b && entry.a == px.a)
+			out.push_back(uint8_t(hash));
+		else
+		{
+			entry = px;
+
+			int8_t dr = int8_t(px.r - prev.r);
+			int8_t dg = int8_t(px.g - prev.g);
+			int8_t db = int8_t(px.b - prev.b);
+
+			int8_t drdg = int8_t(dr - dg);
+			int8_t dbdg = int8_t(db - dg);
+
+			if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
+				out.push_back(uint8_t(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+
+			else if (drdg > -9 && drdg < 8 && dg > -33 && dg < 32 && dbdg > -9 && dbdg < 8)
+				out.insert(out.end(), { uint8_t(0x80 | (dg + 32)), uint8_t((drdg + 8) << 4 | (dbdg + 8)) });
+
+			else
+				out.insert(out.end(), { 0xFE, px.r, px.g, px.b });
+		}
+
+		prev = px;
+	}
+
+	out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+}
+
+void FrameCapture::EncodeY4MFrame(const uint8_t *pixels, DWORD width, DWORD height, std::vector<uint8_t> &out)
+{
+	static const char frameHeader[] = "FRAME\n";
+	out.insert(out.end(), frameHeader, frameHeader + sizeof(frameHeader) - 1);
+
+	DWORD chromaWidth = (width + 1) / 2;
+	DWORD chromaHeight = (height + 1) / 2;
+
+	size_t lumaStart = out.size();
+	size_t cbStart = lumaStart + size_t(width) * height;
+	size_t crStart = cbStart + size_t(chromaWidth) * chromaHeight;
+
+	out.resize(crStart + size_t(chromaWidth) * chromaHeight);
+
+	// Full range BT.601 (JPEG) YCbCr in 16-bit fixed point
+	for (DWORD y = 0; y < height; y++)
+	{
+		const uint8_t *row = pixels + size_t(y) * width * 4;
+		uint8_t *luma = &out[lumaStart + size_t(y) * width];
+
+		for (DWORD x = 0; x < width; x++)
+			luma[x] = uint8_t((19595 * row[x * 4 + 2] + 38470 * row[x * 4 + 1] + 7471 * row[x * 4] + 32768) >> 16);
+	}
+
+	// The chroma of each 2x2 block average
+	for (DWORD cy = 0; cy < chromaHeight; cy++)
+	{
+		for (DWORD cx = 0; cx < chromaWidth; cx++)
+		{
+			int r = 0, g = 0, b = 0, count = 0;
+
+			for (DWORD y = cy * 2; y < (std::min)(cy * 2 + 2, height); y++)
+			{
+				for (DWORD x = cx * 2; x < (std::min)(cx * 2 + 2, width); x++)
+				{
+					const uint8_t *px = pixels + (size_t(y) * width + x) * 4;
+
+					b += px[0];
+					g += px[1];
+					r += px[2];
+					count++;
+				}
+			}
+
+			r /= count;
+			g /= count;
+			b /= count;
+
+			// Offset by 128 before the shift, so it rounds the negative values too
+			out[cbStart + size_t(cy) * chromaWidth + cx] = uint8_t(std::clamp((-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32768) >> 16, 0, 255));
+			out[crStart + size_t(cy) * chromaWidth + cx] = uint8_t(std::clamp((32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32768) >> 16, 0, 255));
+		}
+	}
+}
+
+std::string FrameCapture::Y4MHeader(DWORD width, DWORD height, double frameRate)
+{
+	// The frame rate as a fraction, in thousandths
+	long rate = (std::max)(1L, std::lround(frameRate * 1000));
+
+	char header[128];
+	sprintf_s(header, 128, "YUV4MPEG2 W%lu H%lu F%ld:1000 Ip A1:1 C420jpeg\n", (unsigned long)width, (unsigned long)height, rate);
+
+	return header;
+}
@@ -0,0 +1,161 @@
+// =======================================================================================
+// FrameCapture.h : The asynchronous capture of a render target to image sequences or video.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <Orbitersdk.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records a render target to a folder, as a PNG or QOI image sequence or a Y4M video.
+// The surface is read back by the simulation thread into a lock-free ring of preallocated frame buffers,
+// which are encoded and written by worker threads, so capturing never waits for an encoder or the disk.
+// A frame is dropped if the ring is full. A stopped capture is left to its workers to finish writing the ring, so stopping doesn't wait for them either.
+class FrameCapture
+{
+public:
+	enum Format
+	{
+		FORMAT_PNG = 0,
+		FORMAT_QOI,
+		FORMAT_Y4M,
+		FORMAT_COUNT
+	};
+
+	// The capture instrumentation
+	struct Stats
+	{
+		size_t captured;      // The frames read back into the ring
+		size_t dropped;       // The frames dropped as the ring was full
+		size_t written;       // The frames encoded and written
+		size_t queueDepth;    // The frames in the ring, waiting for or being encoded
+		size_t maxQueueDepth; // The most frames in the ring
+		bool failed;          // If a frame couldn't be written
+	};
+
+	static constexpr size_t defaultRingSize = 8;
+	static constexpr int defaultWorkers = 2;
+
+	// Starts capturing frames of the passed size into the folder, which is created if needed.
+	// frameRate is the frame rate of a Y4M video, in frames per second.
+	FrameCapture(const std::string &folder, Format format, DWORD width, DWORD height, double frameRate,
+		size_t ringSize = defaultRingSize, int workers = defaultWorkers);
+
+	// Waits for the frames in the ring to be written, then stops the workers
+	~FrameCapture();
+
+	// Stops capturing and leaves the frames in the ring to the workers, without waiting for them.
+	// The capture is deleted by DeleteFinished once they're written.
+	static void Finish(std::unique_ptr<FrameCapture> capture);
+	// Deletes the finished captures whose frames are all written. If wait is set, waits for all of them, as the session ends.
+	static void DeleteFinished(bool wait = false);
+	static size_t GetFinishingCount() { return finishing.size(); }
+
+	// Reads back the surface of the passed size into the ring, stretched to the capture size.
+	// Returns false if the frame was dropped.
+	bool Capture(SURFHANDLE hSurf, DWORD surfWidth, DWORD surfHeight);
+
+	Stats GetStats() const;
+	Format GetFormat() const { return format; }
+	const std::string &GetFolder() const { return folder; }
+
+	// Constant, for the buttons layouts tables
+	static constexpr const char *FormatName(int format)
+	{
+		switch (format)
+		{
+		case FORMAT_PNG:
+			return "PNG";
+		case FORMAT_QOI:
+			return "QOI";
+		case FORMAT_Y4M:
+			return "Y4M";
+		}
+
+		return "";
+	}
+
+	// The encoders of top-down 32-bit BGRA pixels, as read back from GDI
+	static void EncodePNG(const uint8_t *pixels, DWORD width, DWORD height, std::vector<uint8_t> &out);
+	static void EncodeQOI(const uint8_t *pixels, DWORD width, DWORD height, std::vector<uint8_t> &out);
+	static void EncodeY4MFrame(const uint8_t *pixels, DWORD width, DWORD height, std::vector<uint8_t> &out);
+	static std::string Y4MHeader(DWORD width, DWORD height, double frameRate);
+
+private:
+	// A frame buffer of the ring. It's filled by the simulation thread while it isn't ready, and freed by the worker which wrote it.
+	struct Slot
+	{
+		std::atomic<bool> ready{ false };
+		std::vector<uint8_t> pixels;
+	};
+
+	std::string folder;
+	Format format;
+	DWORD width;
+	DWORD height;
+
+	size_t ringSize;
+	std::unique_ptr<Slot[]> slots;
+
+	// The frames are numbered in capture order. head is the next frame to capture, and only written by the simulation thread.
+	// tail is the next frame to encode, claimed by the workers.
+	std::atomic<uint64_t> head{ 0 };
+	std::atomic<uint64_t> tail{ 0 };
+	std::atomic<uint64_t> completed{ 0 };
+
+	size_t dropped = 0;
+	size_t maxQueueDepth = 0;
+	std::atomic<size_t> written{ 0 };
+	std::atomic<bool> failed{ false };
+
+	// The read back surfaces: a GDI surface the render target is stretched into, and the DIB section it's copied into
+	SURFHANDLE hStaging = nullptr;
+	HDC hMemDC = nullptr;
+	HBITMAP hBitmap = nullptr;
+	HGDIOBJ hOldBitmap = nullptr;
+	uint8_t *bitmapBits = nullptr;
+
+	std::vector<std::thread> workers;
+	std::atomic<int> runningWorkers{ 0 };
+	std::atomic<bool> stopping{ false };
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+
+	// The Y4M frames are appended in capture order
+	FILE *video = nullptr;
+	uint64_t nextVideoFrame = 0;
+	std::mutex videoMutex;
+	std::condition_variable videoTurn;
+
+	// The finished captures, until their workers are done. Only used by the simulation thread.
+	static std::vector<std::unique_ptr<FrameCapture>> finishing;
+
+	// Stops the workers once the ring is empty, and releases the read back surfaces
+	void stop();
+	void work();
+	bool write(uint64_t frame, const uint8_t *pixels, std::vector<uint8_t> &buffer);
+};
@@ -0,0 +1,475 @@
+// =======================================================================================
+// Headless.cpp : Recording stubs of the Orbiter SDK and graphics client API.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Headless.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+// A device context of a surface, or a memory device context with a DIB section
+struct DIBSection
+{
+	int width;
+	int height;
+	std::vector<uint8_t> bits;
+};
+
+struct HDC__
+{
+	Headless::Surface *surface = nullptr;
+	DIBSection *bitmap = nullptr;
+};
+
+namespace Headless
+{
+	Counters counters;
+	Camera lastCamera;
+
+	bool graphicsClient = true;
+	double sysTime = 0;
+	double sysStep = 0;
+	size_t frameCameraSetups = 0; // The gcSetupCustomCamera calls since the last Step
+	uint32_t frameNumber = 0;     // The Step calls, which aren't reset with the counters
+	std::vector<Camera*> cameras; // The custom cameras which weren't deleted
+	std::vector<Vessel*> vessels; // The vessels which weren't deleted
+
+	// The last input box opened, until text is entered into it
+	bool (*inputClbk)(void*, char*, void*) = nullptr;
+	void *inputData = nullptr;
+
+	// An in-memory scenario or configuration file
+	struct Stream
+	{
+		std::vector<std::string> lines;
+		size_t nextLine = 0;
+		std::string lineBuffer;
+		std::string output;
+	};
+
+	void ResetCounters()
+	{
+		counters = Counters();
+		frameCameraSetups = 0;
+	}
+
+	void Step(double dt)
+	{
+		sysStep = dt;
+		sysTime += dt;
+
+		counters.frames++;
+		frameCameraSetups = 0;
+
+		frameNumber++;
+
+		for (const Camera *camera : cameras)
+		{
+			if (camera->on)
+			{
+				counters.cameraRenders++;
+
+				if (camera->hSurf)
+					static_cast<Surface*>(camera->hSurf)->content = frameNumber;
+			}
+		}
+	}
+
+	void SetGraphicsClient(bool enabled) { graphicsClient = enabled; }
+
+	bool SetRootDir(const std::string &dir) { return chdir(dir.c_str()) == 0; }
+
+	FILEHANDLE OpenScenario(const std::string &text)
+	{
+		Stream *stream = new Stream;
+
+		std::istringstream ss(text);
+		std::string line;
+
+		while (std::getline(ss, line))
+			stream->lines.push_back(line);
+
+		return stream;
+	}
+
+	FILEHANDLE CreateScenario() { return new Stream; }
+
+	const std::string &GetScenario(FILEHANDLE scn) { return static_cast<Stream*>(scn)->output; }
+
+	void RewindScenario(FILEHANDLE scn)
+	{
+		Stream *stream = static_cast<Stream*>(scn);
+
+		stream->nextLine = 0;
+		stream->output.clear();
+	}
+
+	void CloseScenario(FILEHANDLE scn) { delete static_cast<Stream*>(scn); }
+
+	Vessel::Vessel(const char *className, bool controlMFD) : VESSEL3(this), name(className), className(className), controlMFD(controlMFD)
+	{
+		vessels.push_back(this);
+	}
+
+	Vessel::~Vessel() { vessels.erase(std::find(vessels.begin(), vessels.end(), this)); }
+
+	char *Vessel::GetName() const { return const_cast<char*>(name.c_str()); }
+
+	void Vessel::Global2Local(const VECTOR3 &glob, VECTOR3 &loc) const { loc = tmul(rotation, glob - globalPos); }
+
+	void Vessel::Local2Global(const VECTOR3 &loc, VECTOR3 &glob) const { glob = mul(rotation, loc) + globalPos; }
+
+	UINT Vessel::DockCount() const { return UINT(docks.size()); }
+
+	DOCKHANDLE Vessel::GetDockHandle(UINT n) const { return n < docks.size() ? const_cast<VECTOR3*>(&docks[n]) : nullptr; }
+
+	void Vessel::GetDockParams(DOCKHANDLE hDock, VECTOR3 &pos, VECTOR3 &dir, VECTOR3 &rot) const
+	{
+		pos = *static_cast<const VECTOR3*>(hDock);
+		dir = _V(0, 0, 1);
+		rot = _V(0, 1, 0);
+	}
+
+	bool EnterInput(const std::string &text)
+	{
+		if (!inputClbk)
+			return false;
+
+		auto clbk = inputClbk;
+		inputClbk = nullptr;
+
+		std::vector<char> buffer(text.begin(), text.end());
+		buffer.push_back('\0');
+
+		return clbk(nullptr, buffer.data(), inputData);
+	}
+
+	const char *Vessel::GetClassNameA() const { return className.c_str(); }
+
+	int Vessel::clbkGeneric(int msgid, int prm, void *context)
+	{
+		genericCalls++;
+		mfdInstance = context;
+
+		return controlMFD ? msgid : 0;
+	}
+
+	void Sketchpad::CopyRect(SURFHANDLE hSrc, const LPRECT src, int tx, int ty) { counters.copyRect++; }
+
+	void Sketchpad::StretchRect(SURFHANDLE hSrc, const LPRECT src, const LPRECT tgt) { counters.stretchRect++; }
+
+	bool Sketchpad::Text(int x, int y, const char *str, int len)
+	{
+		counters.text++;
+		counters.textBytes += len;
+
+		return true;
+	}
+}
+
+using namespace Headless;
+
+// ==============================================================
+// MFD interface
+
+MFD2::MFD2(DWORD w, DWORD h, VESSEL *vessel) : W(w), H(h), cw(w / 35), ch(h / 28), pV(vessel) { }
+
+void MFD2::InvalidateDisplay() { counters.invalidateDisplay++; }
+
+void MFD2::InvalidateButtons() { counters.invalidateButtons++; }
+
+void MFD2::Title(oapi::Sketchpad *skp, const char *title) const { skp->Text(cw / 2, ch / 4, title, int(strlen(title))); }
+
+// ==============================================================
+// API functions
+
+int oapiRegisterMFDMode(MFDMODESPECEX &spec) { return 1; }
+
+bool oapiUnregisterMFDMode(int mode) { return true; }
+
+double oapiGetSimTime() { return sysTime; }
+
+double oapiGetSimStep() { return sysStep; }
+
+double oapiGetSysTime() { return sysTime; }
+
+double oapiGetSysStep() { return sysStep; }
+
+VESSEL *oapiGetVesselInterface(OBJHANDLE hVessel) { return static_cast<Vessel*>(hVessel); }
+
+OBJHANDLE oapiGetVesselByName(char *name)
+{
+	for (Vessel *vessel : vessels)
+	{
+		if (vessel->name == name)
+			return vessel->GetHandle();
+	}
+
+	return nullptr;
+}
+
+OBJHANDLE oapiGetVesselByIndex(int index) { return index >= 0 && size_t(index) < vessels.size() ? vessels[index]->GetHandle() : nullptr; }
+
+DWORD oapiGetVesselCount() { return DWORD(vessels.size()); }
+
+bool oapiIsVessel(OBJHANDLE hVessel) { return std::find(vessels.begin(), vessels.end(), static_cast<Vessel*>(hVessel)) != vessels.end(); }
+
+void oapiGetGlobalPos(OBJHANDLE hObj, VECTOR3 *pos) { *pos = static_cast<Vessel*>(hObj)->globalPos; }
+
+int oapiCockpitMode() { return COCKPIT_VIRTUAL; }
+
+oapi::Font *oapiCreateFont(int height, bool prop, const char *face, FontStyle style, int orientation)
+{
+	counters.createFont++;
+	return new oapi::Font(height, prop, face, style);
+}
+
+void oapiReleaseFont(oapi::Font *font)
+{
+	counters.releaseFont++;
+	delete font;
+}
+
+SURFHANDLE oapiCreateSurfaceEx(int width, int height, DWORD attrib)
+{
+	counters.createSurface++;
+	return new Surface{ width, height, attrib };
+}
+
+bool oapiClearSurface(SURFHANDLE surf, DWORD col)
+{
+	counters.clearSurface++;
+	return surf != nullptr;
+}
+
+bool oapiDestroySurface(SURFHANDLE surf)
+{
+	counters.destroySurface++;
+	delete static_cast<Surface*>(surf);
+
+	return true;
+}
+
+void oapiBlt(SURFHANDLE tgt, SURFHANDLE src, RECT *tgtr, RECT *srcr, DWORD ck, DWORD rotate)
+{
+	counters.blt++;
+	static_cast<Surface*>(tgt)->content = static_cast<Surface*>(src)->content;
+}
+
+HDC oapiGetDC(SURFHANDLE surf) { return new HDC__{ static_cast<Surface*>(surf) }; }
+
+void oapiReleaseDC(SURFHANDLE surf, HDC hDC) { delete hDC; }
+
+// ==============================================================
+// GDI stubs
+
+HDC CreateCompatibleDC(HDC hdc) { return new HDC__; }
+
+HBITMAP CreateDIBSection(HDC hdc, const BITMAPINFO *pbmi, UINT usage, void **ppvBits, HANDLE hSection, DWORD offset)
+{
+	int width = pbmi->bmiHeader.biWidth, height = std::abs(pbmi->bmiHeader.biHeight);
+	DIBSection *bitmap = new DIBSection{ width, height, std::vector<uint8_t>(size_t(width) * height * 4) };
+
+	*ppvBits = bitmap->bits.data();
+	return bitmap;
+}
+
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ h)
+{
+	DIBSection *old = hdc->bitmap;
+	hdc->bitmap = static_cast<DIBSection*>(h);
+
+	return old;
+}
+
+bool DeleteObject(HGDIOBJ ho)
+{
+	delete static_cast<DIBSection*>(ho);
+	return true;
+}
+
+bool DeleteDC(HDC hdc)
+{
+	delete hdc;
+	return true;
+}
+
+bool BitBlt(HDC hdc, int x, int y, int cx, int cy, HDC hdcSrc, int x1, int y1, DWORD rop)
+{
+	if (!hdc->bitmap || !hdcSrc->surface)
+		return false;
+
+	counters.readback++;
+
+	// Fill a gradient pattern which moves with the frame the surface content is from
+	uint32_t content = hdcSrc->surface->content;
+	DIBSection *bitmap = hdc->bitmap;
+
+	for (int row = 0; row < cy && y + row < bitmap->height; row++)
+	{
+		uint8_t *px = &bitmap->bits[(size_t(y + row) * bitmap->width + x) * 4];
+
+		for (int col = 0; col < cx && x + col < bitmap->width; col++, px += 4)
+		{
+			int sx = x1 + col;
+			int sy = y1 + row;
+
+			px[0] = uint8_t(sx + content);
+			px[1] = uint8_t(sy + content * 2);
+			px[2] = uint8_t(((sx / 8) ^ (sy / 8)) * 16);
+			px[3] = 0;
+		}
+	}
+
+	return true;
+}
+
+void oapiOpenInputBox(char *title, bool (*Clbk)(void*, char*, void*), char *buf, int vislen, void *usrdata)
+{
+	inputClbk = Clbk;
+	inputData = usrdata;
+}
+
+FILEHANDLE oapiOpenFile(const char *fname, FileAccessMode mode, PathRoot root)
+{
+	counters.openFile++;
+
+	std::ifstream file(root == CONFIG ? std::string("Config/") + fname : std::string(fname));
+
+	if (!file)
+		return nullptr;
+
+	std::stringstream text;
+	text << file.rdbuf();
+
+	return OpenScenario(text.str());
+}
+
+void oapiCloseFile(FILEHANDLE f, FileAccessMode mode) { CloseScenario(f); }
+
+bool oapiReadScenario_nextline(FILEHANDLE scn, char *&line)
+{
+	Stream *stream = static_cast<Stream*>(scn);
+
+	if (stream->nextLine >= stream->lines.size())
+		return false;
+
+	counters.readLine++;
+
+	// Orbiter strips the leading white spaces and the line end
+	const std::string &text = stream->lines[stream->nextLine++];
+
+	size_t start = text.find_first_not_of(" \t");
+	size_t end = text.find_last_not_of("\r\n");
+
+	if (start == std::string::npos || end == std::string::npos || end < start)
+		stream->lineBuffer.clear();
+	else
+		stream->lineBuffer.assign(text, start, end - start + 1);
+
+	line = &stream->lineBuffer[0];
+
+	return true;
+}
+
+void oapiWriteScenario_string(FILEHANDLE scn, char *item, char *string)
+{
+	counters.writeLine++;
+
+	std::string &output = static_cast<Stream*>(scn)->output;
+
+	output += "  ";
+	output += item;
+	output += ' ';
+	output += string;
+	output += '\n';
+}
+
+void oapiWriteScenario_int(FILEHANDLE scn, char *item, int i)
+{
+	char buffer[32];
+	sprintf_s(buffer, 32, "%d", i);
+
+	oapiWriteScenario_string(scn, item, buffer);
+}
+
+void oapiWriteScenario_float(FILEHANDLE scn, char *item, double d)
+{
+	char buffer[64];
+	sprintf_s(buffer, 64, "%f", d);
+
+	oapiWriteScenario_string(scn, item, buffer);
+}
+
+void oapiWriteScenario_vec(FILEHANDLE scn, char *item, const VECTOR3 &vec)
+{
+	char buffer[128];
+	sprintf_s(buffer, 128, "%f %f %f", vec.x, vec.y, vec.z);
+
+	oapiWriteScenario_string(scn, item, buffer);
+}
+
+// ==============================================================
+// Graphics client functions
+
+bool gcInitialize() { return graphicsClient; }
+
+bool gcEnabled() { return graphicsClient; }
+
+int gcSketchpadVersion(oapi::Sketchpad *pSkp) { return dynamic_cast<Sketchpad2*>(pSkp) ? 2 : 1; }
+
+CAMERAHANDLE gcSetupCustomCamera(CAMERAHANDLE hCam, OBJHANDLE hVessel, const VECTOR3 &vPos, const VECTOR3 &vDir, const VECTOR3 &vUp, double dFov, SURFHANDLE hSurf, DWORD dwFlags)
+{
+	counters.setupCustomCamera++;
+
+	if (++frameCameraSetups > counters.maxFrameCameraSetups)
+		counters.maxFrameCameraSetups = frameCameraSetups;
+
+	Camera *camera = static_cast<Camera*>(hCam);
+
+	if (!camera)
+	{
+		camera = new Camera;
+		cameras.push_back(camera);
+	}
+	*camera = { hVessel, vPos, vDir, vUp, dFov, hSurf, dwFlags, true };
+	lastCamera = *camera;
+
+	return camera;
+}
+
+void gcCustomCameraOnOff(CAMERAHANDLE hCam, bool bOn)
+{
+	counters.customCameraOnOff++;
+	static_cast<Camera*>(hCam)->on = bOn;
+}
+
+int gcDeleteCustomCamera(CAMERAHANDLE hCam)
+{
+	counters.deleteCustomCamera++;
+
+	cameras.erase(std::find(cameras.begin(), cameras.end(), hCam));
+	delete static_cast<Camera*>(hCam);
+
+	return 0;
+}
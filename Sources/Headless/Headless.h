@@ -0,0 +1,160 @@
+// =======================================================================================
+// Headless.h : The recording interface of the headless Orbiter stand-in.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <Sketchpad2.h>
+
+#include <string>
+#include <vector>
+
+namespace Headless
+{
+	// The number of calls made to the recorded SDK functions
+	struct Counters
+	{
+		size_t setupCustomCamera;
+		size_t deleteCustomCamera;
+		size_t customCameraOnOff;
+
+		size_t createSurface;
+		size_t destroySurface;
+		size_t clearSurface;
+
+		size_t createFont;
+		size_t releaseFont;
+
+		size_t blt;
+		size_t readback; // The BitBlt calls from a surface DC
+
+		size_t copyRect;
+		size_t stretchRect;
+		size_t text;
+		size_t textBytes;
+
+		size_t invalidateDisplay;
+		size_t invalidateButtons;
+
+		size_t openFile;
+		size_t readLine;
+		size_t writeLine;
+
+		size_t frames;                // The Step calls
+		size_t maxFrameCameraSetups;  // The most gcSetupCustomCamera calls between two Step calls
+		size_t cameraRenders;         // The custom camera renders, one per camera switched on when a frame ends by Step
+	};
+
+	extern Counters counters;
+	void ResetCounters();
+
+	// The state of a custom camera as last passed to gcSetupCustomCamera
+	struct Camera
+	{
+		OBJHANDLE hVessel;
+		VECTOR3 pos;
+		VECTOR3 dir;
+		VECTOR3 up;
+		double fov;
+		SURFHANDLE hSurf;
+		DWORD flags;
+		bool on;
+	};
+
+	// The last camera passed to gcSetupCustomCamera
+	extern Camera lastCamera;
+
+	// A render surface created by oapiCreateSurfaceEx
+	struct Surface
+	{
+		int width;
+		int height;
+		DWORD attrib;
+		uint32_t content = 0; // The frame last rendered into the surface, or blitted from another surface
+	};
+
+	// A VESSEL3 with a fixed class name. Its handle is the object address, so oapiGetVesselInterface is a cast.
+	// Its name is the class name unless it's changed. It's found by name while it exists.
+	class Vessel : public VESSEL3
+	{
+	public:
+		Vessel(const char *className, bool controlMFD = false);
+		~Vessel();
+
+		const char *GetClassNameA() const override;
+		int clbkGeneric(int msgid = 0, int prm = 0, void *context = nullptr) override;
+
+		char *GetName() const override;
+		void Global2Local(const VECTOR3 &glob, VECTOR3 &loc) const override;
+		void Local2Global(const VECTOR3 &loc, VECTOR3 &glob) const override;
+		UINT DockCount() const override;
+		DOCKHANDLE GetDockHandle(UINT n) const override;
+		void GetDockParams(DOCKHANDLE hDock, VECTOR3 &pos, VECTOR3 &dir, VECTOR3 &rot) const override;
+
+		void *mfdInstance = nullptr; // The last context sent by the MFD
+		size_t genericCalls = 0;
+
+		std::string name;
+		VECTOR3 globalPos = { 0, 0, 0 };
+		MATRIX3 rotation = { 1, 0, 0, 0, 1, 0, 0, 0, 1 }; // The rotation from the local to the global frame
+		std::vector<VECTOR3> docks;                       // The docking ports positions, facing forward
+
+	private:
+		std::string className;
+		bool controlMFD;
+	};
+
+	// A Sketchpad2 which only counts the draw calls
+	class Sketchpad : public Sketchpad2
+	{
+	public:
+		Sketchpad() : Sketchpad2(nullptr) { }
+
+		void CopyRect(SURFHANDLE hSrc, const LPRECT src, int tx, int ty) override;
+		void StretchRect(SURFHANDLE hSrc, const LPRECT src = nullptr, const LPRECT tgt = nullptr) override;
+		bool Text(int x, int y, const char *str, int len) override;
+	};
+
+	// Enters the text into the last input box opened by oapiOpenInputBox, and returns the input box callback result.
+	// Returns false if there is no open input box.
+	bool EnterInput(const std::string &text);
+
+	// Advances the simulation and system time by a frame step (in seconds)
+	void Step(double dt);
+
+	// Enables or disables the graphics client (gcInitialize and gcEnabled). It's enabled by default.
+	void SetGraphicsClient(bool enabled);
+
+	// Sets the working directory, which stands in for the Orbiter root folder (oapiOpenFile opens its Config folder for the CONFIG root)
+	bool SetRootDir(const std::string &dir);
+
+	// Opens an in-memory scenario stream to be read by ReadStatus
+	FILEHANDLE OpenScenario(const std::string &text);
+
+	// Creates an empty in-memory scenario stream to be written by WriteStatus
+	FILEHANDLE CreateScenario();
+
+	// Returns the text written to a scenario stream
+	const std::string &GetScenario(FILEHANDLE scn);
+
+	// Rewinds a scenario stream, and clears its written text
+	void RewindScenario(FILEHANDLE scn);
+
+	void CloseScenario(FILEHANDLE scn);
+}
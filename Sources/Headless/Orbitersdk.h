@@ -0,0 +1,398 @@
+// =======================================================================================
+// Orbitersdk.h : Headless stand-in for the Orbiter SDK, used to build Camera MFD on Linux.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+// Only the part of the SDK used by the MFD is declared here. The functions are implemented
+// in Headless.cpp as recording stubs, so the MFD can be driven and measured without Orbiter.
+
+#pragma once
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// ==============================================================
+// Windows types
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef unsigned int UINT;
+typedef int32_t LONG;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef void *HINSTANCE;
+typedef void *HANDLE;
+typedef void *HWND;
+typedef int BOOL;
+
+typedef struct { LONG left, top, right, bottom; } RECT, *LPRECT;
+
+#define LOWORD(l) (DWORD(l) & 0xFFFF)
+#define HIWORD(l) ((DWORD(l) >> 16) & 0xFFFF)
+
+#define DLLCLBK extern "C"
+
+template <typename A, typename B> inline auto max(A a, B b) -> decltype(a + b) { return a > b ? a : b; }
+template <typename A, typename B> inline auto min(A a, B b) -> decltype(a + b) { return a < b ? a : b; }
+
+inline int sprintf_s(char *buffer, size_t size, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, size, format, args);
+	va_end(args);
+
+	return len;
+}
+
+inline char *_strdup(const char *str) { return strdup(str); }
+
+// ==============================================================
+// GDI, used to read back surfaces. The headless surfaces read back as synthetic pixels.
+
+typedef struct HDC__ *HDC;
+typedef void *HGDIOBJ;
+typedef void *HBITMAP;
+
+typedef struct
+{
+	DWORD biSize;
+	LONG biWidth;
+	LONG biHeight;
+	WORD biPlanes;
+	WORD biBitCount;
+	DWORD biCompression;
+	DWORD biSizeImage;
+	LONG biXPelsPerMeter;
+	LONG biYPelsPerMeter;
+	DWORD biClrUsed;
+	DWORD biClrImportant;
+} BITMAPINFOHEADER;
+
+typedef struct { BYTE rgbBlue, rgbGreen, rgbRed, rgbReserved; } RGBQUAD;
+
+typedef struct
+{
+	BITMAPINFOHEADER bmiHeader;
+	RGBQUAD bmiColors[1];
+} BITMAPINFO;
+
+#define BI_RGB 0
+#define DIB_RGB_COLORS 0
+#define SRCCOPY 0x00CC0020
+
+HDC CreateCompatibleDC(HDC hdc);
+HBITMAP CreateDIBSection(HDC hdc, const BITMAPINFO *pbmi, UINT usage, void **ppvBits, HANDLE hSection, DWORD offset);
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ h);
+bool DeleteObject(HGDIOBJ ho);
+bool DeleteDC(HDC hdc);
+bool BitBlt(HDC hdc, int x, int y, int cx, int cy, HDC hdcSrc, int x1, int y1, DWORD rop);
+
+// ==============================================================
+// Orbiter types
+
+typedef void *OBJHANDLE;
+typedef void *DOCKHANDLE;
+typedef void *SURFHANDLE;
+typedef void *FILEHANDLE;
+
+const double PI = 3.14159265358979;
+const double RAD = PI / 180.0;
+const double DEG = 180.0 / PI;
+
+const int MAXMFD = 12;
+
+union VECTOR3
+{
+	double data[3];
+	struct { double x, y, z; };
+};
+
+union MATRIX3
+{
+	double data[9];
+	struct { double m11, m12, m13, m21, m22, m23, m31, m32, m33; };
+};
+
+inline VECTOR3 _V(double x, double y, double z) { VECTOR3 vec = { x, y, z }; return vec; }
+
+inline VECTOR3 operator+ (const VECTOR3 &a, const VECTOR3 &b) { return _V(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline VECTOR3 operator- (const VECTOR3 &a, const VECTOR3 &b) { return _V(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline VECTOR3 operator* (const VECTOR3 &a, const double f) { return _V(a.x * f, a.y * f, a.z * f); }
+inline VECTOR3 operator/ (const VECTOR3 &a, const double f) { return _V(a.x / f, a.y / f, a.z / f); }
+inline VECTOR3 &operator+= (VECTOR3 &a, const VECTOR3 &b) { a.x += b.x; a.y += b.y; a.z += b.z; return a; }
+inline VECTOR3 &operator-= (VECTOR3 &a, const VECTOR3 &b) { a.x -= b.x; a.y -= b.y; a.z -= b.z; return a; }
+inline VECTOR3 operator- (const VECTOR3 &a) { return _V(-a.x, -a.y, -a.z); }
+
+inline double dotp(const VECTOR3 &a, const VECTOR3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline VECTOR3 crossp(const VECTOR3 &a, const VECTOR3 &b) { return _V(a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y); }
+inline double length(const VECTOR3 &a) { return sqrt(dotp(a, a)); }
+inline void normalise(VECTOR3 &a) { a = a / length(a); }
+inline VECTOR3 unit(const VECTOR3 &a) { return a / length(a); }
+
+inline VECTOR3 mul(const MATRIX3 &A, const VECTOR3 &b)
+{
+	return _V(A.m11 * b.x + A.m12 * b.y + A.m13 * b.z,
+	          A.m21 * b.x + A.m22 * b.y + A.m23 * b.z,
+	          A.m31 * b.x + A.m32 * b.y + A.m33 * b.z);
+}
+
+inline VECTOR3 tmul(const MATRIX3 &A, const VECTOR3 &b)
+{
+	return _V(A.m11 * b.x + A.m21 * b.y + A.m31 * b.z,
+	          A.m12 * b.x + A.m22 * b.y + A.m32 * b.z,
+	          A.m13 * b.x + A.m23 * b.y + A.m33 * b.z);
+}
+
+inline MATRIX3 mul(const MATRIX3 &A, const MATRIX3 &B)
+{
+	MATRIX3 mat = {
+		A.m11 * B.m11 + A.m12 * B.m21 + A.m13 * B.m31, A.m11 * B.m12 + A.m12 * B.m22 + A.m13 * B.m32, A.m11 * B.m13 + A.m12 * B.m23 + A.m13 * B.m33,
+		A.m21 * B.m11 + A.m22 * B.m21 + A.m23 * B.m31, A.m21 * B.m12 + A.m22 * B.m22 + A.m23 * B.m32, A.m21 * B.m13 + A.m22 * B.m23 + A.m23 * B.m33,
+		A.m31 * B.m11 + A.m32 * B.m21 + A.m33 * B.m31, A.m31 * B.m12 + A.m32 * B.m22 + A.m33 * B.m32, A.m31 * B.m13 + A.m32 * B.m23 + A.m33 * B.m33
+	};
+
+	return mat;
+}
+
+enum FileAccessMode { FILE_IN, FILE_OUT, FILE_APP, FILE_IN_ZEROONFAIL };
+enum PathRoot { ROOT, CONFIG, SCENARIOS, TEXTURES, TEXTURES2, MESHES, MODULES };
+enum FontStyle { FONT_NORMAL = 0, FONT_BOLD = 1, FONT_ITALIC = 2, FONT_UNDERLINE = 4 };
+
+#define OAPISURFACE_TEXTURE      0x0001
+#define OAPISURFACE_RENDERTARGET 0x0002
+#define OAPISURFACE_GDI          0x0004
+#define OAPISURFACE_SKETCHPAD    0x0008
+#define OAPISURFACE_MIPMAPS      0x0010
+#define OAPISURFACE_NOMIPMAPS    0x0020
+#define OAPISURFACE_ALPHA        0x0040
+#define OAPISURFACE_NOALPHA      0x0080
+#define OAPISURFACE_UNCOMPRESS   0x0100
+#define OAPISURFACE_SYSMEM       0x0200
+#define OAPISURFACE_RENDER3D     0x0400
+
+#define SURF_NO_CK       0xFFFFFFFF
+#define SURF_NO_ROTATION 0xFFFFFFFF
+
+#define COCKPIT_GENERIC 1
+#define COCKPIT_PANELS  2
+#define COCKPIT_VIRTUAL 3
+
+#define OAPI_MSG_MFD_OPENED 1
+#define OAPI_MSG_MFD_CLOSED 2
+
+#define PANEL_MOUSE_LBDOWN    0x01
+#define PANEL_MOUSE_RBDOWN    0x02
+#define PANEL_MOUSE_LBUP      0x04
+#define PANEL_MOUSE_RBUP      0x08
+#define PANEL_MOUSE_LBPRESSED 0x10
+#define PANEL_MOUSE_RBPRESSED 0x20
+
+#define KEYDOWN(buf, key) (buf[key] & 0x80)
+
+#define OAPI_KEY_ESCAPE 0x01
+#define OAPI_KEY_Q      0x10
+#define OAPI_KEY_W      0x11
+#define OAPI_KEY_E      0x12
+#define OAPI_KEY_R      0x13
+#define OAPI_KEY_T      0x14
+#define OAPI_KEY_Y      0x15
+#define OAPI_KEY_U      0x16
+#define OAPI_KEY_I      0x17
+#define OAPI_KEY_O      0x18
+#define OAPI_KEY_P      0x19
+#define OAPI_KEY_A      0x1E
+#define OAPI_KEY_S      0x1F
+#define OAPI_KEY_D      0x20
+#define OAPI_KEY_F      0x21
+#define OAPI_KEY_G      0x22
+#define OAPI_KEY_H      0x23
+#define OAPI_KEY_J      0x24
+#define OAPI_KEY_K      0x25
+#define OAPI_KEY_L      0x26
+#define OAPI_KEY_Z      0x2C
+#define OAPI_KEY_X      0x2D
+#define OAPI_KEY_C      0x2E
+#define OAPI_KEY_V      0x2F
+#define OAPI_KEY_B      0x30
+#define OAPI_KEY_N      0x31
+#define OAPI_KEY_M      0x32
+
+typedef struct
+{
+	const char *line1, *line2;
+	char selchar;
+} MFDBUTTONMENU;
+
+typedef struct
+{
+	char *name;
+	DWORD key;
+	void *context;
+	int (*msgproc)(UINT, UINT, WPARAM, LPARAM);
+} MFDMODESPECEX;
+
+namespace oapi
+{
+	class Font
+	{
+	public:
+		Font(int height, bool prop, const char *face, FontStyle style) : height(height) { }
+		virtual ~Font() { }
+
+		int height;
+	};
+
+	class Sketchpad
+	{
+	public:
+		enum TAlign_horizontal { LEFT, CENTER, RIGHT };
+		enum TAlign_vertical { TOP, BASELINE, BOTTOM };
+
+		Sketchpad(SURFHANDLE s) : surf(s) { }
+		virtual ~Sketchpad() { }
+
+		virtual Font *SetFont(Font *font) const { return nullptr; }
+		virtual DWORD SetTextColor(DWORD col) { return 0; }
+		virtual bool SetTextAlign(TAlign_horizontal tah = LEFT, TAlign_vertical tav = TOP) { return true; }
+		virtual bool Text(int x, int y, const char *str, int len) { return true; }
+		virtual void Rectangle(int x0, int y0, int x1, int y1) { }
+
+		SURFHANDLE GetSurface() const { return surf; }
+
+	private:
+		SURFHANDLE surf;
+	};
+}
+
+// ==============================================================
+// Vessel interface
+
+class VESSEL
+{
+public:
+	VESSEL(OBJHANDLE hVessel, int fmodel = 1) : hVessel(hVessel) { }
+	virtual ~VESSEL() { }
+
+	OBJHANDLE GetHandle() const { return hVessel; }
+	virtual int Version() const { return 0; }
+	virtual const char *GetClassNameA() const { return nullptr; }
+	const char *GetClassName() const { return GetClassNameA(); }
+
+	// Virtual in the stand-in only, to be implemented by the headless vessel
+	virtual char *GetName() const { return nullptr; }
+	virtual void Global2Local(const VECTOR3 &glob, VECTOR3 &loc) const { loc = glob; }
+	virtual void Local2Global(const VECTOR3 &loc, VECTOR3 &glob) const { glob = loc; }
+	virtual UINT DockCount() const { return 0; }
+	virtual DOCKHANDLE GetDockHandle(UINT n) const { return nullptr; }
+	virtual void GetDockParams(DOCKHANDLE hDock, VECTOR3 &pos, VECTOR3 &dir, VECTOR3 &rot) const { }
+
+private:
+	OBJHANDLE hVessel;
+};
+
+class VESSEL2 : public VESSEL
+{
+public:
+	VESSEL2(OBJHANDLE hVessel, int fmodel = 1) : VESSEL(hVessel, fmodel) { }
+	int Version() const override { return 1; }
+};
+
+class VESSEL3 : public VESSEL2
+{
+public:
+	VESSEL3(OBJHANDLE hVessel, int fmodel = 1) : VESSEL2(hVessel, fmodel) { }
+	int Version() const override { return 2; }
+
+	virtual int clbkGeneric(int msgid = 0, int prm = 0, void *context = nullptr) { return 0; }
+};
+
+// ==============================================================
+// MFD interface
+
+class MFD2
+{
+public:
+	MFD2(DWORD w, DWORD h, VESSEL *vessel);
+	virtual ~MFD2() { }
+
+	virtual bool Update(oapi::Sketchpad *skp) { return false; }
+	virtual char *ButtonLabel(int bt) { return nullptr; }
+	virtual int ButtonMenu(const MFDBUTTONMENU **menu) const { return 0; }
+	virtual bool ConsumeButton(int bt, int event) { return false; }
+	virtual bool ConsumeKeyImmediate(char *kstate) { return false; }
+	virtual bool ConsumeKeyBuffered(DWORD key) { return false; }
+	virtual void ReadStatus(FILEHANDLE scn) { }
+	virtual void WriteStatus(FILEHANDLE scn) const { }
+
+	void InvalidateDisplay();
+	void InvalidateButtons();
+	void Title(oapi::Sketchpad *skp, const char *title) const;
+
+protected:
+	DWORD W, H;
+	DWORD cw, ch;
+	VESSEL *pV;
+};
+
+// ==============================================================
+// API functions
+
+int oapiRegisterMFDMode(MFDMODESPECEX &spec);
+bool oapiUnregisterMFDMode(int mode);
+
+double oapiGetSimTime();
+double oapiGetSimStep();
+double oapiGetSysTime();
+double oapiGetSysStep();
+
+VESSEL *oapiGetVesselInterface(OBJHANDLE hVessel);
+OBJHANDLE oapiGetVesselByName(char *name);
+OBJHANDLE oapiGetVesselByIndex(int index);
+DWORD oapiGetVesselCount();
+bool oapiIsVessel(OBJHANDLE hVessel);
+void oapiGetGlobalPos(OBJHANDLE hObj, VECTOR3 *pos);
+int oapiCockpitMode();
+
+oapi::Font *oapiCreateFont(int height, bool prop, const char *face, FontStyle style = FONT_NORMAL, int orientation = 0);
+void oapiReleaseFont(oapi::Font *font);
+
+SURFHANDLE oapiCreateSurfaceEx(int width, int height, DWORD attrib);
+bool oapiClearSurface(SURFHANDLE surf, DWORD col = 0);
+bool oapiDestroySurface(SURFHANDLE surf);
+void oapiBlt(SURFHANDLE tgt, SURFHANDLE src, RECT *tgtr, RECT *srcr, DWORD ck = SURF_NO_CK, DWORD rotate = SURF_NO_ROTATION);
+HDC oapiGetDC(SURFHANDLE surf);
+void oapiReleaseDC(SURFHANDLE surf, HDC hDC);
+
+void oapiOpenInputBox(char *title, bool (*Clbk)(void*, char*, void*), char *buf = nullptr, int vislen = 20, void *usrdata = nullptr);
+
+FILEHANDLE oapiOpenFile(const char *fname, FileAccessMode mode, PathRoot root = ROOT);
+void oapiCloseFile(FILEHANDLE f, FileAccessMode mode);
+
+bool oapiReadScenario_nextline(FILEHANDLE scn, char *&line);
+void oapiWriteScenario_string(FILEHANDLE scn, char *item, char *string);
+void oapiWriteScenario_int(FILEHANDLE scn, char *item, int i);
+void oapiWriteScenario_float(FILEHANDLE scn, char *item, double d);
+void oapiWriteScenario_vec(FILEHANDLE scn, char *item, const VECTOR3 &vec);
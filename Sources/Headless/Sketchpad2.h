@@ -0,0 +1,32 @@
+// =======================================================================================
+// Sketchpad2.h : Headless stand-in for the D3D9 graphics client Sketchpad2.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <gcAPI.h>
+
+class Sketchpad2 : public oapi::Sketchpad
+{
+public:
+	Sketchpad2(SURFHANDLE s) : oapi::Sketchpad(s) { }
+
+	virtual void CopyRect(SURFHANDLE hSrc, const LPRECT src, int tx, int ty) { }
+	virtual void StretchRect(SURFHANDLE hSrc, const LPRECT src = nullptr, const LPRECT tgt = nullptr) { }
+};
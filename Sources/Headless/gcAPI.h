@@ -0,0 +1,33 @@
+// =======================================================================================
+// gcAPI.h : Headless stand-in for the D3D9 graphics client API.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <Orbitersdk.h>
+
+typedef void *CAMERAHANDLE;
+
+bool gcInitialize();
+bool gcEnabled();
+int gcSketchpadVersion(oapi::Sketchpad *pSkp);
+
+CAMERAHANDLE gcSetupCustomCamera(CAMERAHANDLE hCam, OBJHANDLE hVessel, const VECTOR3 &vPos, const VECTOR3 &vDir, const VECTOR3 &vUp, double dFov, SURFHANDLE hSurf, DWORD dwFlags = 0xFF);
+void gcCustomCameraOnOff(CAMERAHANDLE hCam, bool bOn);
+int gcDeleteCustomCamera(CAMERAHANDLE hCam);
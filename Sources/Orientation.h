@@ -0,0 +1,90 @@
+// =======================================================================================
+// Orientation.h : The quaternion math of the camera orientation.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <Orbitersdk.h>
+
+// The camera orientation as a unit quaternion.
+// The elemental rotations follow the matrices the MFD used before: yaw turns the camera around its Y axis,
+// pitch around its X axis, and rotation (roll) around its Z (view) axis. All angles are in radians.
+struct Quaternion
+{
+	double w, x, y, z;
+};
+
+const Quaternion identityQuaternion = { 1, 0, 0, 0 };
+
+inline Quaternion operator* (const Quaternion &a, const Quaternion &b)
+{
+	return { a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+	         a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+	         a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+	         a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w };
+}
+
+// Normalises a quaternion which is already close to unit length, such as a product of unit quaternions.
+// It's a first order correction, so it avoids the square root and keeps the rounding error from building up.
+inline void renormalise(Quaternion &q)
+{
+	double factor = 1.5 - 0.5 * (q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+
+	q = { q.w * factor, q.x * factor, q.y * factor, q.z * factor };
+}
+
+// The rotation of the matrix { cos, 0, -sin, 0, 1, 0, sin, 0, cos }
+inline Quaternion yawRotation(double angle) { return { cos(angle / 2), 0, -sin(angle / 2), 0 }; }
+
+// The rotation of the matrix { 1, 0, 0, 0, cos, sin, 0, -sin, cos }
+inline Quaternion pitchRotation(double angle) { return { cos(angle / 2), -sin(angle / 2), 0, 0 }; }
+
+// The rotation of the matrix { cos, -sin, 0, sin, cos, 0, 0, 0, 1 }
+inline Quaternion rollRotation(double angle) { return { cos(angle / 2), 0, 0, sin(angle / 2) }; }
+
+// A yaw rotation done while the camera is leveled: the same as pitchRotation(-pitch) * yawRotation(angle) * pitchRotation(pitch),
+// with the half angle sine and cosine of the yaw precomputed.
+inline Quaternion leveledYawRotation(double halfCos, double halfSin, double pitch)
+{
+	return { halfCos, 0, -halfSin * cos(pitch), -halfSin * sin(pitch) };
+}
+
+inline MATRIX3 toMatrix(const Quaternion &q)
+{
+	double xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	double xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	double wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	MATRIX3 mat = {
+		1 - 2 * (yy + zz), 2 * (xy - wz), 2 * (xz + wy),
+		2 * (xy + wz), 1 - 2 * (xx + zz), 2 * (yz - wx),
+		2 * (xz - wy), 2 * (yz + wx), 1 - 2 * (xx + yy)
+	};
+
+	return mat;
+}
+
+// Rotates a vector by the quaternion, the same as mul(toMatrix(q), v)
+inline VECTOR3 mul(const Quaternion &q, const VECTOR3 &v)
+{
+	VECTOR3 u = { q.x, q.y, q.z };
+	VECTOR3 t = crossp(u, v) * 2;
+
+	return v + t * q.w + crossp(u, t);
+}
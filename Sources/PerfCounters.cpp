@@ -0,0 +1,140 @@
+// =======================================================================================
+// PerfCounters.cpp : The runtime counters of the MFD, and their CSV log.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "PerfCounters.h"
+
+#include <algorithm>
+
+PerfCounters &PerfCounters::operator+=(const PerfCounters &other)
+{
+	updates += other.updates;
+	updateTime += other.updateTime;
+	maxUpdateTime = (std::max)(maxUpdateTime, other.maxUpdateTime);
+	cameraSetups += other.cameraSetups;
+	blits += other.blits;
+	configReads += other.configReads;
+	configTime += other.configTime;
+	buttonRebuilds += other.buttonRebuilds;
+	apiCalls += other.apiCalls;
+
+	return *this;
+}
+
+PerfLog::PerfLog(const std::string &path, double interval) : path(path), interval(interval)
+{
+	file = fopen(path.c_str(), "w");
+
+	if (file)
+		fputs("time,vessel,mfd,updates,update_ms,max_update_ms,camera_setups,blits,config_reads,config_ms,button_rebuilds,api_calls\n", file);
+	else
+		failed = true;
+
+	writer = std::thread(&PerfLog::work, this);
+}
+
+PerfLog::~PerfLog()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_one();
+	writer.join();
+
+	if (file)
+		fclose(file);
+}
+
+bool PerfLog::Due(double sysTime)
+{
+	// The first sample is taken right away
+	if (nextSample >= 0 && sysTime < nextSample)
+		return false;
+
+	// Skip the samples missed by a long frame
+	nextSample = nextSample < 0 ? sysTime + interval : (std::max)(nextSample + interval, sysTime);
+
+	return true;
+}
+
+void PerfLog::Write(std::vector<Row> &&rows)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (pending.empty())
+			pending.swap(rows);
+		else
+			pending.insert(pending.end(), rows.begin(), rows.end());
+	}
+
+	samples++;
+	wake.notify_one();
+}
+
+bool PerfLog::Failed() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return failed;
+}
+
+void PerfLog::work()
+{
+	std::vector<Row> rows;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !pending.empty(); });
+
+			if (pending.empty())
+				return;
+
+			rows.swap(pending);
+		}
+
+		bool written = true;
+
+		if (file)
+		{
+			for (const Row &row : rows)
+			{
+				const PerfCounters &counters = row.counters;
+
+				written &= fprintf(file, "%.3f,\"%s\",%d,%zu,%.3f,%.3f,%zu,%zu,%zu,%.3f,%zu,%zu\n", row.time, row.vessel.c_str(), row.mfdIndex,
+					counters.updates, counters.updateTime * 1000, counters.maxUpdateTime * 1000, counters.cameraSetups, counters.blits,
+					counters.configReads, counters.configTime * 1000, counters.buttonRebuilds, counters.apiCalls) > 0;
+			}
+
+			written &= fflush(file) == 0;
+		}
+
+		rows.clear();
+
+		if (!written)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			failed = true;
+		}
+	}
+}
@@ -0,0 +1,108 @@
+// =======================================================================================
+// PerfCounters.h : The runtime counters of the MFD, and their CSV log.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The runtime counters of an MFD data. They are summed over the vessel MFDs and the module by the registry.
+struct PerfCounters
+{
+	size_t updates = 0;          // The MFD updates
+	double updateTime = 0;       // The MFD updates time, in seconds
+	double maxUpdateTime = 0;    // The longest MFD update, in seconds
+	size_t cameraSetups = 0;     // The gcSetupCustomCamera calls, for the current camera and the tiles
+	size_t blits = 0;            // The camera views copied or stretched onto the MFD
+	size_t configReads = 0;      // The configuration files read, from the text or the cache
+	double configTime = 0;       // The configuration files read time, in seconds
+	size_t buttonRebuilds = 0;   // The buttons layout selections
+	size_t apiCalls = 0;         // The API methods calls, including the adds and deletes by the MFD keys
+
+	PerfCounters &operator+=(const PerfCounters &other);
+};
+
+// Times a scope into a counter, in seconds
+class PerfTimer
+{
+public:
+	PerfTimer() : start(std::chrono::steady_clock::now()) { }
+
+	double Elapsed() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
+
+// Writes the counters of the MFDs into a CSV file at an interval. The simulation thread only copies the counters,
+// and a background thread formats and writes them, so the log doesn't stall the simulation on the disk.
+class PerfLog
+{
+public:
+	// A CSV row: the counters of an MFD at a time. The module totals have an empty vessel name and an MFD index of -1.
+	struct Row
+	{
+		double time;
+		std::string vessel;
+		int mfdIndex;
+		PerfCounters counters;
+	};
+
+	static constexpr double defaultInterval = 1;
+
+	// Creates the file and writes the CSV header. interval is the system time between samples, in seconds.
+	PerfLog(const std::string &path, double interval);
+
+	// Writes the queued rows, then stops the writer thread
+	~PerfLog();
+
+	// Returns true if a sample is due at the passed system time, and schedules the next one
+	bool Due(double sysTime);
+
+	// Queues the rows of a sample to be written
+	void Write(std::vector<Row> &&rows);
+
+	const std::string &GetPath() const { return path; }
+	double GetInterval() const { return interval; }
+	size_t GetSamples() const { return samples; }
+	bool Failed() const;
+
+private:
+	std::string path;
+	double interval;
+	double nextSample = -1;
+	size_t samples = 0;
+
+	FILE *file = nullptr;
+	bool failed = false;
+
+	std::vector<Row> pending;
+	bool stopping = false;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::thread writer;
+
+	void work();
+};
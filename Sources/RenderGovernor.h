@@ -0,0 +1,110 @@
+// =======================================================================================
+// RenderGovernor.h : Limits the custom camera render rate.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <cmath>
+
+// Decides on which frames the custom camera renders, to render it at a target rate instead of every frame.
+// If a frame time budget is set, the rate is scaled down while the average frame time is over the budget,
+// and scaled back up once it's under the budget again.
+// If a lowest resolution is set, the render resolution is scaled down before the rate, and scaled back up after it.
+class RenderGovernor
+{
+public:
+	static constexpr double minRate = 1;         // The lowest rate the scaling goes down to, in frames per second
+	static constexpr double scaleDownTime = 1;   // The time to halve the rate over the budget, in seconds
+	static constexpr double scaleUpTime = 2;     // The time to double the rate under the budget, in seconds
+	static constexpr double budgetMargin = 0.8;  // The fraction of the budget under which the rate scales up
+	static constexpr double averageTime = 0.25;  // The time constant of the average frame time, in seconds
+
+	// Advances by a frame at the passed system time and step (in seconds), and returns whether the camera renders in it.
+	// targetRate is the render rate in frames per second, 0 to render every frame.
+	// budget is the frame time budget in seconds, 0 for no budget.
+	// minResolution is the lowest resolution scale over the budget, 1 to keep the full resolution.
+	bool Step(double sysTime, double sysStep, double targetRate, double budget, double minResolution = 1)
+	{
+		if (sysStep > 0)
+			averageStep = averageStep > 0 ? averageStep + (sysStep - averageStep) * std::fmin(1, sysStep / averageTime) : sysStep;
+
+		if (budget > 0 && averageStep > 0)
+		{
+			if (averageStep > budget)
+			{
+				double factor = std::exp2(-sysStep / scaleDownTime);
+
+				if (resolution > minResolution)
+					resolution = std::fmax(minResolution, resolution * factor);
+				else
+					scale *= factor;
+			}
+
+			else if (averageStep < budget * budgetMargin)
+			{
+				double factor = std::exp2(sysStep / scaleUpTime);
+
+				if (scale < 1)
+					scale = std::fmin(1, scale * factor);
+				else
+					resolution = std::fmin(1, resolution * factor);
+			}
+
+			resolution = std::fmax(resolution, std::fmin(1, minResolution));
+		}
+		else
+			scale = resolution = 1;
+
+		double baseRate = targetRate > 0 ? targetRate : (averageStep > 0 ? 1 / averageStep : 0);
+
+		// Render every frame if there is no target rate and no scaling
+		if (baseRate <= 0 || (targetRate <= 0 && scale >= 1))
+		{
+			nextTime = sysTime;
+			return true;
+		}
+
+		// Don't scale further below the lowest rate, so the rate scales up without delay
+		scale = std::fmax(scale, std::fmin(1, minRate / baseRate));
+
+		if (sysTime < nextTime)
+			return false;
+
+		// Keep the render times on the rate period, unless they fell behind
+		double period = 1 / std::fmax(minRate, baseRate * scale);
+		nextTime += period;
+
+		if (nextTime <= sysTime)
+			nextTime = sysTime + period;
+
+		return true;
+	}
+
+	// Returns the current render rate scale, from 0 to 1
+	double GetScale() const { return scale; }
+
+	// Returns the current render resolution scale, from the lowest resolution to 1
+	double GetResolution() const { return resolution; }
+
+private:
+	double averageStep = 0;
+	double scale = 1;
+	double resolution = 1;
+	double nextTime = 0;
+};
@@ -0,0 +1,183 @@
+// =======================================================================================
+// ScenarioTokenizer.h : Splits the scenario and configuration file lines without allocating.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+// Splits a scenario or configuration file line into whitespace-separated tokens, and parses its numbers by std::from_chars.
+// It accepts what the std::istringstream extraction accepted: a number is read as far as operator>> would read it,
+// a malformed number reads as 0, and like a stream, a failed read fails the later reads of the line.
+class ScenarioTokenizer
+{
+public:
+	ScenarioTokenizer(std::string_view line) : line(line) { }
+
+	// Packs a tag of up to 8 characters into an integer, to switch on the tags. Longer tags give 0.
+	static constexpr uint64_t Tag(std::string_view tag)
+	{
+		if (tag.size() > 8)
+			return 0;
+
+		uint64_t value = 0;
+
+		for (char c : tag)
+			value = (value << 8) | uint8_t(c);
+
+		return value;
+	}
+
+	// Returns the next token, or an empty token at the line end
+	std::string_view Next()
+	{
+		if (failed || !skipSpace())
+		{
+			failed = true;
+			return { };
+		}
+
+		size_t start = pos;
+
+		while (pos < line.size() && !isSpace(line[pos]))
+			pos++;
+
+		return line.substr(start, pos - start);
+	}
+
+	// Returns the rest of the line after the separator following the last token, as the label and file name items are read
+	std::string_view Rest()
+	{
+		if (failed || pos >= line.size())
+		{
+			failed = true;
+			return { };
+		}
+
+		std::string_view rest = line.substr(pos + 1);
+		pos = line.size();
+
+		return rest;
+	}
+
+	// Reads the next number. If it fails, the value is set to 0, or kept if the line ended or a previous read failed.
+	bool Read(int &value) { return readNumber(value, false); }
+	bool Read(double &value) { return readNumber(value, true); }
+
+	bool Failed() const { return failed; }
+
+private:
+	std::string_view line;
+	size_t pos = 0;
+	bool failed = false;
+
+	// The C locale white space
+	static bool isSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+	static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+	bool skipSpace()
+	{
+		while (pos < line.size() && isSpace(line[pos]))
+			pos++;
+
+		return pos < line.size();
+	}
+
+	template <typename T>
+	bool readNumber(T &value, bool real)
+	{
+		if (failed || !skipSpace())
+		{
+			failed = true;
+			return false;
+		}
+
+		// Find the characters operator>> takes: a sign, the digits, and for real numbers one point and an exponent
+		size_t start = pos;
+		bool negative = line[pos] == '-';
+		bool digits = false, point = false, exponent = false, negativeExponent = false;
+
+		if (negative || line[pos] == '+')
+			pos++;
+
+		// from_chars doesn't take a plus sign
+		size_t first = negative ? start : pos;
+
+		for (; pos < line.size(); pos++)
+		{
+			char c = line[pos];
+
+			if (isDigit(c))
+				digits = true;
+
+			else if (real && c == '.' && !point && !exponent)
+				point = true;
+
+			else if (real && (c == 'e' || c == 'E') && digits && !exponent)
+			{
+				exponent = true;
+
+				if (pos + 1 < line.size() && (line[pos + 1] == '+' || line[pos + 1] == '-'))
+					negativeExponent = line[++pos] == '-';
+			}
+			else
+				break;
+		}
+
+		const char *end = line.data() + pos;
+		auto result = std::from_chars(line.data() + first, end, value);
+
+		if (result.ptr == end && result.ec == std::errc())
+			return true;
+
+		if (result.ptr == end && result.ec == std::errc::result_out_of_range)
+		{
+			// A real number which is too small reads as 0
+			if (real && (negativeExponent || !hasIntegerDigits(first)))
+			{
+				value = negative ? T(-0.0) : T(0);
+				return true;
+			}
+
+			failed = true;
+			value = negative ? std::numeric_limits<T>::lowest() : (std::numeric_limits<T>::max)();
+
+			return false;
+		}
+
+		failed = true;
+		value = 0;
+
+		return false;
+	}
+
+	// Returns whether the number at the passed position has a non-zero digit before its point
+	bool hasIntegerDigits(size_t first) const
+	{
+		for (size_t index = first; index < pos && line[index] != '.' && line[index] != 'e' && line[index] != 'E'; index++)
+			if (line[index] >= '1' && line[index] <= '9')
+				return true;
+
+		return false;
+	}
+};
@@ -0,0 +1,119 @@
+// =======================================================================================
+// SurfacePool.cpp : The pool of render target surfaces shared by the MFDs.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "SurfacePool.h"
+#include "Trace.h"
+
+SURFHANDLE SurfacePool::Acquire(int width, int height, DWORD attrib)
+{
+	TRACE_ZONE("SurfacePool::Acquire");
+
+	if (enabled)
+	{
+		for (auto &entry : entries)
+		{
+			if (!entry.inUse && entry.width == width && entry.height == height && entry.attrib == attrib)
+			{
+				entry.inUse = true;
+
+				stats.reused++;
+				stats.idle--;
+				stats.inUse++;
+
+				return entry.hSurf;
+			}
+		}
+	}
+
+	SURFHANDLE hSurf = oapiCreateSurfaceEx(width, height, attrib);
+
+	if (!hSurf)
+		return nullptr;
+
+	entries.push_back({ hSurf, width, height, attrib, true, 0 });
+
+	stats.created++;
+	stats.inUse++;
+
+	return hSurf;
+}
+
+void SurfacePool::Release(SURFHANDLE hSurf, double sysTime)
+{
+	for (size_t index = 0; index < entries.size(); index++)
+	{
+		auto &entry = entries[index];
+
+		if (entry.hSurf != hSurf)
+			continue;
+
+		entry.inUse = false;
+		entry.releaseTime = sysTime;
+
+		stats.inUse--;
+		stats.idle++;
+
+		if (!enabled)
+			destroy(index);
+
+		return;
+	}
+
+	// Not tracked since the pool was cleared
+	oapiDestroySurface(hSurf);
+	stats.destroyed++;
+}
+
+void SurfacePool::Trim(double sysTime)
+{
+	for (size_t index = 0; index < entries.size(); )
+	{
+		if (!entries[index].inUse && sysTime - entries[index].releaseTime > idleTimeout)
+			destroy(index);
+		else
+			index++;
+	}
+}
+
+void SurfacePool::Clear()
+{
+	for (size_t index = 0; index < entries.size(); )
+	{
+		if (!entries[index].inUse)
+			destroy(index);
+		else
+			index++;
+	}
+
+	entries.clear();
+	stats.inUse = 0;
+}
+
+void SurfacePool::destroy(size_t index)
+{
+	oapiDestroySurface(entries[index].hSurf);
+
+	entries[index] = entries.back();
+	entries.pop_back();
+
+	stats.destroyed++;
+	stats.idle--;
+}
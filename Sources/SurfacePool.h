@@ -0,0 +1,76 @@
+// =======================================================================================
+// SurfacePool.h : The pool of render target surfaces shared by the MFDs.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <Orbitersdk.h>
+
+#include <vector>
+
+// Hands out render target surfaces by size and attributes, and keeps the released ones for reuse,
+// so reopening or switching MFDs doesn't recreate their surfaces.
+// The surfaces left idle for longer than the idle timeout are destroyed by Trim.
+class SurfacePool
+{
+public:
+	static constexpr double idleTimeout = 30; // In seconds
+
+	// The pool instrumentation
+	struct Stats
+	{
+		size_t created;   // The surfaces created
+		size_t reused;    // The surfaces handed out again, i.e. the creations avoided
+		size_t destroyed; // The surfaces destroyed, when trimmed or cleared
+		size_t inUse;     // The surfaces handed out now
+		size_t idle;      // The surfaces kept for reuse now
+	};
+
+	bool enabled = true; // Set false to create and destroy the surfaces on each request
+
+	// Returns a surface with the passed size and attributes, reusing an idle one if any. The surface content is undefined.
+	SURFHANDLE Acquire(int width, int height, DWORD attrib);
+
+	// Returns a surface to the pool at the passed system time.
+	void Release(SURFHANDLE hSurf, double sysTime);
+
+	// Destroys the surfaces which are idle since before the idle timeout.
+	void Trim(double sysTime);
+
+	// Destroys the idle surfaces, and stops tracking the ones in use, so they're destroyed when released.
+	void Clear();
+
+	const Stats &GetStats() const { return stats; }
+
+private:
+	struct Entry
+	{
+		SURFHANDLE hSurf;
+		int width;
+		int height;
+		DWORD attrib;
+		bool inUse;
+		double releaseTime;
+	};
+
+	std::vector<Entry> entries;
+	Stats stats = { };
+
+	void destroy(size_t index);
+};
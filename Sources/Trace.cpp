@@ -0,0 +1,199 @@
+// =======================================================================================
+// Trace.cpp : Scoped trace zones of the MFD hot paths, written as a Chrome trace.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		const char *name;
+		int64_t begin;
+		int64_t duration;
+	};
+
+	// A single producer, single consumer ring of a thread zones. head is written by the thread, and tail by the flush.
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]> events{ new Event[Trace::bufferSize] };
+		std::atomic<uint64_t> head{ 0 };
+		std::atomic<uint64_t> tail{ 0 };
+		std::atomic<size_t> dropped{ 0 };
+		std::atomic<bool> finished{ false }; // Set when the thread ends, so the buffer is deleted once it's flushed
+		int id;
+	};
+
+	// The buffers of all the threads which recorded a zone. They're kept after their threads end, until they're flushed.
+	struct Buffers
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> list;
+		size_t finishedDropped = 0; // The zones dropped by the deleted buffers
+		int threadCount = 0;
+	};
+
+	// Marks the buffer of its thread as finished when the thread ends
+	struct BufferOwner
+	{
+		ThreadBuffer *buffer = nullptr;
+
+		~BufferOwner()
+		{
+			if (buffer)
+				buffer->finished.store(true, std::memory_order_release);
+		}
+	};
+
+	Buffers &buffers()
+	{
+		static Buffers buffers;
+		return buffers;
+	}
+
+	ThreadBuffer &threadBuffer()
+	{
+		thread_local BufferOwner owner;
+
+		// Registered on the first zone of the thread
+		if (!owner.buffer)
+		{
+			Buffers &all = buffers();
+			std::lock_guard<std::mutex> lock(all.mutex);
+
+			all.list.emplace_back(new ThreadBuffer);
+			owner.buffer = all.list.back().get();
+			owner.buffer->id = ++all.threadCount;
+		}
+
+		return *owner.buffer;
+	}
+}
+
+int64_t Trace::Now()
+{
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::Record(const char *name, int64_t begin)
+{
+	int64_t end = Now();
+	ThreadBuffer &buffer = threadBuffer();
+
+	uint64_t head = buffer.head.load(std::memory_order_relaxed);
+
+	if (head - buffer.tail.load(std::memory_order_acquire) >= bufferSize)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.events[head % bufferSize] = { name, begin, end - begin };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+size_t Trace::Flush(const std::string &path)
+{
+	Buffers &all = buffers();
+	std::lock_guard<std::mutex> lock(all.mutex);
+
+	FILE *file = fopen(path.c_str(), "w");
+	size_t written = 0;
+	bool first = true;
+
+	if (file)
+		fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+
+	for (auto &buffer : all.list)
+	{
+		// Read before the head, so the buffer of a finished thread is empty once it's flushed
+		bool finished = buffer->finished.load(std::memory_order_acquire);
+
+		uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+
+		// The zones are written even if the file can't be opened, to empty the buffers
+		if (file)
+		{
+			fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}}", first ? "" : ",", buffer->id, buffer->id);
+			first = false;
+
+			for (uint64_t index = tail; index < head; index++)
+			{
+				const Event &event = buffer->events[index % bufferSize];
+
+				// In microseconds
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.name, buffer->id,
+					event.begin / 1000.0, event.duration / 1000.0);
+			}
+		}
+
+		written += size_t(head - tail);
+
+		buffer->tail.store(head, std::memory_order_release);
+
+		if (finished)
+		{
+			all.finishedDropped += buffer->dropped.load(std::memory_order_relaxed);
+			buffer.reset();
+		}
+	}
+
+	// The buffers of the finished threads are deleted, so a thread per task doesn't keep a buffer each
+	all.list.erase(std::remove(all.list.begin(), all.list.end(), nullptr), all.list.end());
+
+	if (file)
+	{
+		fputs("\n]}\n", file);
+		fclose(file);
+	}
+
+	return written;
+}
+
+size_t Trace::Dropped()
+{
+	Buffers &all = buffers();
+	std::lock_guard<std::mutex> lock(all.mutex);
+
+	size_t dropped = all.finishedDropped;
+
+	for (auto &buffer : all.list)
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+
+	return dropped;
+}
+
+size_t Trace::BufferCount()
+{
+	Buffers &all = buffers();
+	std::lock_guard<std::mutex> lock(all.mutex);
+
+	return all.list.size();
+}
@@ -0,0 +1,73 @@
+// =======================================================================================
+// Trace.h : Scoped trace zones of the MFD hot paths, written as a Chrome trace.
+// Copyright  2020 Abdullah Radwan. All rights reserved.
+//
+// This file is part of Camera MFD.
+//
+// Camera MFD is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Camera MFD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Camera MFD. If not, see <https://www.gnu.org/licenses/>.
+//
+// =======================================================================================
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+// The MFD hot paths are marked by TRACE_ZONE, which records the time the enclosing scope takes.
+// The zones are recorded only if the MFD is built with CAMERAMFD_TRACE defined (the CAMERAMFD_TRACE CMake option), otherwise TRACE_ZONE compiles to nothing.
+// Each thread records into its own ring buffer, which only it writes, so recording a zone doesn't lock or allocate.
+// Flush writes the zones of all the threads as a Chrome trace JSON file, which can be opened by chrome://tracing or Perfetto.
+namespace Trace
+{
+	// The system time in nanoseconds, since the first call
+	int64_t Now();
+
+	// Records a zone of the calling thread, from the passed begin time until now. The name must be a literal, as only its pointer is kept.
+	void Record(const char *name, int64_t begin);
+
+	// Writes the zones recorded since the last flush into a Chrome trace file, and empties the buffers.
+	// Returns the count of zones written.
+	size_t Flush(const std::string &path);
+
+	// Returns the count of zones dropped as a thread buffer was full
+	size_t Dropped();
+
+	// Returns the count of the thread buffers. The buffer of a thread is deleted by the first flush after the thread ends.
+	size_t BufferCount();
+
+	// The zones a thread buffer holds between the flushes
+	constexpr size_t bufferSize = 1 << 16;
+
+	// Records the time from its construction to its destruction
+	class Zone
+	{
+	public:
+		explicit Zone(const char *name) : name(name), begin(Now()) { }
+		~Zone() { Record(name, begin); }
+
+		Zone(const Zone&) = delete;
+		Zone &operator=(const Zone&) = delete;
+
+	private:
+		const char *name;
+		int64_t begin;
+	};
+}
+
+#ifdef CAMERAMFD_TRACE
+#define TRACE_CONCAT_(first, second) first##second
+#define TRACE_CONCAT(first, second) TRACE_CONCAT_(first, second)
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#define TRACE_ZONE(name)
+#endif